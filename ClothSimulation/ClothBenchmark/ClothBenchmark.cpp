@@ -0,0 +1,692 @@
+#include <chrono>
+#include <string>
+#include <optional>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#include "source/Simulation/cloth_solver.hpp"
+#include "source/Simulation/cloth_snapshot.hpp"
+#include "source/Simulation/bake_writer.hpp"
+#include "source/Simulation/bake_player.hpp"
+#include "source/Simulation/gltf_exporter.hpp"
+#include "source/Simulation/mesh_normals.hpp"
+#include "source/Common/handle.hpp"
+#include "source/Common/mesh.hpp"
+#include "source/Common/cloth_data.hpp"
+
+// Headless cloth stepping, no window and no OpenGL context required
+// Usage: ClothBenchmark [--grid X Y] [--size X Y] [--stiffness S] [--mass M] [--dt DT] [--adaptive-dt] [--steps N] [--warmup N]
+//        [--threads N] [--simd Scalar|SSE|AVX2] [--integrator Explicit|Implicit|Xpbd] [--cg-iterations N] [--xpbd-iterations N]
+//        [--xpbd-mode GaussSeidel|Jacobi] [--cloths N] [--presorted-springs] [--point-order Grid|Morton|Hilbert]
+//        [--self-collision THICKNESS] [--sphere X Y Z R] [--plane Y] [--mesh-sphere X Y Z R SEGMENTS] [--bake PATH] [--bake-quantized]
+//        [--gltf PATH] [--check-rebuild]
+
+struct BenchmarkOptions
+{
+	glm::ivec2 gridSize = { 100, 100 };
+	glm::vec2 meshSize  = { 20.0f, 20.0f };
+	Float32 stiffness   = 100.0f;
+	Float32 clothMass   = 100.0f;
+	Float32 deltaTime   = 0.001f;
+	bool adaptiveTimeStep = false; // Steps are split into substeps of estimated stable length
+	Int32 steps		    = 1000;
+	Int32 warmupSteps   = 10;
+	Int32 threadsCount  = WorkerPool::s_get_hardware_threads_count();
+	ESimdLevel simdLevel = ClothKernels::s_get_supported_level();
+	EIntegrator integrator = EIntegrator::Explicit;
+	Int32 linearIterations = 50;
+	Int32 constraintIterations = 10;
+	EXpbdMode xpbdMode = EXpbdMode::GaussSeidel;
+	Int32 clothsCount = 1; // Each of gridSize, stepped together
+	bool presortedSprings = false;
+	EPointOrder pointOrder = EPointOrder::Grid;
+	Float32 collisionThickness = 0.0f; // Zero disables self-collision
+	std::vector<ColliderShape> colliderShapes;
+	glm::vec4 meshSphere = { 0.0f, 0.0f, 0.0f, 0.0f }; // Center and radius of triangulated sphere collider
+	Int32 meshSphereSegments = 0;					   // Zero disables mesh collider, sphere has 2 * SEGMENTS^2 triangles
+	std::string bakePath; // Empty disables recording, otherwise every step is baked frame
+	bool isBakeQuantized = false;
+	std::string gltfPath; // Empty disables export, otherwise every step is animation frame
+	bool checkRebuild = false; // Only verifies that cloth rebuilt with other spring order steps same as fresh one
+};
+
+// Every heap allocation of process is counted, steady state steps are expected to make none
+std::atomic<Int64> gAllocationsCount = 0;
+
+void* allocate(std::size_t size, std::size_t alignment)
+{
+	gAllocationsCount.fetch_add(1, std::memory_order_relaxed);
+	size = glm::max(size, std::size_t(1));
+#ifdef _WIN32
+	void *pointer = _aligned_malloc(size, alignment);
+#else
+	void *pointer = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	if (!pointer)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void deallocate(void* pointer)
+{
+#ifdef _WIN32
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+	return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, glm::max(std::size_t(alignment), std::size_t(__STDCPP_DEFAULT_NEW_ALIGNMENT__)));
+}
+
+void operator delete(void* pointer) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	deallocate(pointer);
+}
+
+bool parse_options(Int32 argc, char** argv, BenchmarkOptions& options);
+void print_usage();
+bool is_finite(const std::vector<Mesh>& meshes);
+Float64 get_simulated_cache_misses(const ClothData& clothData);
+void add_mesh_sphere(StaticColliders& colliders, const glm::vec4& sphere, Int32 segments);
+bool is_xpbd_rebuild_consistent(const BenchmarkOptions& options);
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	bool isParsed = false;
+	try
+	{
+		isParsed = parse_options(argc, argv, options);
+	} catch (const std::logic_error& error) {
+		// std::stoi and std::stof throw on values that aren't numbers or don't fit
+		SPDLOG_ERROR("Argument is not a valid number ({}).", error.what());
+		print_usage();
+	}
+	if (!isParsed)
+	{
+		return 2;
+	}
+
+	if (options.checkRebuild)
+	{
+		if (!is_xpbd_rebuild_consistent(options))
+		{
+			SPDLOG_ERROR("Cloth rebuilt with other spring order doesn't step same as freshly built one.");
+			return 1;
+		}
+		SPDLOG_INFO("XPBD Jacobi steps of cloth rebuilt with other spring order match freshly built one.");
+		return 0;
+	}
+
+	ClothSolver solver;
+	solver.settings.deltaTime	 = options.deltaTime;
+	solver.settings.adaptiveTimeStep = options.adaptiveTimeStep;
+	solver.settings.threadsCount = options.threadsCount;
+	solver.settings.simdLevel	 = options.simdLevel;
+	solver.settings.integrator	 = options.integrator;
+	solver.settings.linearIterations = options.linearIterations;
+	solver.settings.constraintIterations = options.constraintIterations;
+	solver.settings.xpbdMode = options.xpbdMode;
+	solver.settings.presortedSprings = options.presortedSprings;
+	solver.settings.pointOrder = options.pointOrder;
+	solver.settings.selfCollision = options.collisionThickness > 0.0f;
+	solver.settings.collisionThickness = options.collisionThickness;
+	solver.colliders.shapes = options.colliderShapes;
+
+	std::vector<ClothData> cloths(options.clothsCount);
+	std::vector<Mesh> meshes(options.clothsCount);
+	std::vector<Mesh*> meshPointers;
+
+	const auto buildBegin = std::chrono::high_resolution_clock::now();
+	for (Int32 i = 0; i < options.clothsCount; ++i)
+	{
+		const glm::vec3 origin = { 1.5f * options.meshSize.x * Float32(i), 0.0f, 0.0f };
+		solver.build_cloth(cloths[i], meshes[i], options.gridSize, options.meshSize, options.clothMass, options.stiffness, origin);
+		meshPointers.emplace_back(&meshes[i]);
+	}
+	const auto buildEnd = std::chrono::high_resolution_clock::now();
+
+	// Same as reset after changed mass or stiffness, memory of first build is reused
+	const Int64 rebuildAllocationsBegin = gAllocationsCount.load();
+	for (Int32 i = 0; i < options.clothsCount; ++i)
+	{
+		const glm::vec3 origin = { 1.5f * options.meshSize.x * Float32(i), 0.0f, 0.0f };
+		solver.build_cloth(cloths[i], meshes[i], options.gridSize, options.meshSize, options.clothMass, options.stiffness, origin);
+	}
+	const auto rebuildEnd = std::chrono::high_resolution_clock::now();
+	const Int64 rebuildAllocations = gAllocationsCount.load() - rebuildAllocationsBegin;
+
+	if (options.meshSphereSegments > 0)
+	{
+		add_mesh_sphere(solver.colliders, options.meshSphere, options.meshSphereSegments);
+	}
+	const auto collidersBegin = std::chrono::high_resolution_clock::now();
+	solver.colliders.prepare();
+	const auto collidersEnd = std::chrono::high_resolution_clock::now();
+
+	const ClothData &clothData = cloths[0];
+	const Int64 massPointsCount = Int64(meshes[0].positions.size()) * options.clothsCount;
+	const Int64 springsCount    = Int64(clothData.restLengths.size()) * options.clothsCount;
+
+	for (Int32 i = 0; i < options.warmupSteps; ++i)
+	{
+		solver.step(cloths, meshPointers);
+	}
+
+	Int64 solverIterations = 0;
+	Int64 collisionCandidates = 0;
+	Int64 collisionContacts = 0;
+	Int64 colliderContacts = 0;
+	Int64 adaptiveSubsteps = 0;
+	Float32 adaptiveDeltaTime = options.deltaTime;
+	BakeWriter bakeWriter;
+	if (!options.bakePath.empty() && !bakeWriter.open(options.bakePath, meshPointers, options.isBakeQuantized))
+	{
+		return 1;
+	}
+	GltfExporter gltfExporter;
+	if (!options.gltfPath.empty() && !gltfExporter.open(options.gltfPath, meshPointers))
+	{
+		return 1;
+	}
+	// Normals, encoding and export of recorded frames are timed and counted apart from solver steps
+	Float64 recordingNs = 0.0;
+	Int64 recordingAllocations = 0;
+	const Int64 stepsAllocationsBegin = gAllocationsCount.load();
+	const auto stepsBegin = std::chrono::high_resolution_clock::now();
+	for (Int32 i = 0; i < options.steps; ++i)
+	{
+		solver.step(cloths, meshPointers);
+		solverIterations += solver.get_statistics().solverIterations;
+		collisionCandidates += solver.get_statistics().collisionCandidates;
+		collisionContacts += solver.get_statistics().collisionContacts;
+		colliderContacts += solver.get_statistics().colliderContacts;
+		adaptiveSubsteps += solver.get_statistics().adaptiveSubsteps;
+		adaptiveDeltaTime = glm::min(adaptiveDeltaTime, solver.get_statistics().adaptiveDeltaTime);
+		if (bakeWriter.is_open() || gltfExporter.is_open())
+		{
+			const Int64 frameAllocationsBegin = gAllocationsCount.load();
+			const auto frameBegin = std::chrono::high_resolution_clock::now();
+			for (Int32 j = 0; j < options.clothsCount; ++j)
+			{
+				solver.update_normals(cloths[j], meshes[j]);
+			}
+			bakeWriter.add_frame(Float32(i + 1) * options.deltaTime, meshPointers);
+			gltfExporter.add_frame(Float32(i + 1) * options.deltaTime, meshPointers);
+			const auto frameEnd = std::chrono::high_resolution_clock::now();
+			recordingNs += Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(frameEnd - frameBegin).count());
+			recordingAllocations += gAllocationsCount.load() - frameAllocationsBegin;
+		}
+	}
+	const auto stepsEnd = std::chrono::high_resolution_clock::now();
+	const Int64 stepsAllocations = gAllocationsCount.load() - stepsAllocationsBegin - recordingAllocations;
+	const BakeWriter::Statistics bakeStatistics = bakeWriter.get_statistics();
+	const bool isBakeWritten = bakeWriter.close();
+	const bool isGltfWritten = gltfExporter.close();
+	const auto recordingCloseEnd = std::chrono::high_resolution_clock::now();
+
+	// Playback decodes every recorded frame from mapped file
+	BakePlayer bakePlayer;
+	const auto playbackBegin = std::chrono::high_resolution_clock::now();
+	if (isBakeWritten && !options.bakePath.empty() && bakePlayer.open(options.bakePath))
+	{
+		std::vector<Mesh> decodedMeshes(options.clothsCount);
+		std::vector<Mesh*> decodedPointers;
+		for (Mesh &mesh : decodedMeshes)
+		{
+			decodedPointers.emplace_back(&mesh);
+		}
+		for (Int64 frame = 0; frame < bakePlayer.get_frames_count(); ++frame)
+		{
+			bakePlayer.decode_frame(frame, decodedPointers);
+		}
+	}
+	const auto playbackEnd = std::chrono::high_resolution_clock::now();
+
+	// Reset of simulation manager is restore of snapshot captured after build
+	ClothSnapshot snapshot;
+	const auto captureBegin = std::chrono::high_resolution_clock::now();
+	snapshot.capture(cloths, meshPointers);
+	const auto captureEnd = std::chrono::high_resolution_clock::now();
+	snapshot.restore(cloths, meshPointers);
+	const auto restoreEnd = std::chrono::high_resolution_clock::now();
+
+	// Normals of final state, grid gather used by simulation and generic triangle adjacency one
+	constexpr Int32 NORMALS_REPEATS = 20;
+	WorkerPool normalsPool;
+	normalsPool.startup(options.threadsCount);
+	MeshNormals meshNormals;
+	meshNormals.build(meshes[0]);
+	const auto gridNormalsBegin = std::chrono::high_resolution_clock::now();
+	for (Int32 i = 0; i < NORMALS_REPEATS; ++i)
+	{
+		MeshNormals::s_update_grid(normalsPool, meshes[0], options.gridSize);
+	}
+	const auto gridNormalsEnd = std::chrono::high_resolution_clock::now();
+	for (Int32 i = 0; i < NORMALS_REPEATS; ++i)
+	{
+		meshNormals.update(normalsPool, meshes[0]);
+	}
+	const auto adjacencyNormalsEnd = std::chrono::high_resolution_clock::now();
+
+	const Float64 buildNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(buildEnd - buildBegin).count());
+	const Float64 rebuildNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(rebuildEnd - buildEnd).count());
+	const Float64 collidersNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(collidersEnd - collidersBegin).count());
+	const Float64 totalNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(stepsEnd - stepsBegin).count()) - recordingNs;
+	const Float64 recordingCloseNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(recordingCloseEnd - stepsEnd).count());
+	const Float64 stepsCount = Float64(options.steps);
+	const Float64 captureNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(captureEnd - captureBegin).count());
+	const Float64 restoreNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(restoreEnd - captureEnd).count());
+	const Float64 gridNormalsNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(gridNormalsEnd - gridNormalsBegin).count());
+	const Float64 adjacencyNormalsNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(adjacencyNormalsEnd - gridNormalsEnd).count());
+	const Float64 playbackNs = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(playbackEnd - playbackBegin).count());
+
+	SPDLOG_INFO("{} cloths of grid {}x{}, {} mass points, {} springs, stiffness {}, mass {}, dt {}",
+				options.clothsCount, options.gridSize.x, options.gridSize.y, massPointsCount, springsCount,
+				options.stiffness, options.clothMass, options.deltaTime);
+	SPDLOG_INFO("Threads:                {}, spring batches: {}, SIMD: {}", options.threadsCount,
+				clothData.springBatchOffsets.size() - 1, magic_enum::enum_name(options.simdLevel));
+	SPDLOG_INFO("Build time:             {:.3f} ms, rebuild {:.3f} ms with {} allocations", buildNs * 1.0e-6,
+				rebuildNs * 1.0e-6, rebuildAllocations);
+	SPDLOG_INFO("Point order:            {}, simulated cache misses/spring: {:.3f}", magic_enum::enum_name(options.pointOrder),
+				get_simulated_cache_misses(clothData));
+	SPDLOG_INFO("Integrator:             {}", magic_enum::enum_name(options.integrator));
+	if (options.adaptiveTimeStep)
+	{
+		SPDLOG_INFO("Adaptive substeps/step: {:.2f}, shortest dt {:.6f}", Float64(adaptiveSubsteps) / Float64(options.steps),
+					adaptiveDeltaTime);
+	}
+	SPDLOG_INFO("Cloths on all threads:  {}, on single thread: {}", solver.get_statistics().sharedCloths,
+				solver.get_statistics().spreadCloths);
+	SPDLOG_INFO("Steps:                  {}", options.steps);
+	SPDLOG_INFO("Allocations/step:       {:.2f}", Float64(stepsAllocations) / stepsCount);
+	if (options.integrator != EIntegrator::Explicit)
+	{
+		SPDLOG_INFO("Solver iterations/step: {:.2f}", Float64(solverIterations) / stepsCount);
+	}
+	if (options.collisionThickness > 0.0f)
+	{
+		SPDLOG_INFO("Collision pairs/step:   {:.1f} candidates, {:.1f} contacts", Float64(collisionCandidates) / stepsCount,
+					Float64(collisionContacts) / stepsCount);
+	}
+	if (!solver.colliders.is_empty())
+	{
+		SPDLOG_INFO("Colliders:              {} shapes, {} triangles, hierarchy build {:.3f} ms", options.colliderShapes.size(),
+					solver.colliders.get_triangles_count(), collidersNs * 1.0e-6);
+		SPDLOG_INFO("Collider contacts/step: {:.1f}", Float64(colliderContacts) / stepsCount);
+	}
+	SPDLOG_INFO("Normals of cloth:       grid {:.3f} ms, adjacency {:.3f} ms", gridNormalsNs * 1.0e-6 / NORMALS_REPEATS,
+				adjacencyNormalsNs * 1.0e-6 / NORMALS_REPEATS);
+	SPDLOG_INFO("Snapshot:               {:.2f} MB, capture {:.3f} ms, restore {:.3f} ms",
+				Float64(snapshot.get_size()) / (1024.0 * 1024.0), captureNs * 1.0e-6, restoreNs * 1.0e-6);
+	if (!options.bakePath.empty())
+	{
+		SPDLOG_INFO("Bake:                   {} frames, {:.2f} MB, {} writer stalls{}", bakeStatistics.frames,
+					Float64(bakeStatistics.bytes) / (1024.0 * 1024.0), bakeStatistics.stalls, isBakeWritten ? "" : ", write failed");
+		if (bakePlayer.is_open())
+		{
+			SPDLOG_INFO("Playback decode/frame:  {:.3f} ms", playbackNs * 1.0e-6 / Float64(bakePlayer.get_frames_count()));
+		}
+	}
+	if (!options.gltfPath.empty())
+	{
+		SPDLOG_INFO("glTF export:            {} frames, {:.2f} MB{}", gltfExporter.get_frames_count(),
+					Float64(gltfExporter.get_bytes()) / (1024.0 * 1024.0), isGltfWritten ? "" : ", write failed");
+	}
+	if (!options.bakePath.empty() || !options.gltfPath.empty())
+	{
+		SPDLOG_INFO("Recording/frame:        {:.3f} ms, {:.2f} allocations, close {:.3f} ms", recordingNs * 1.0e-6 / stepsCount,
+					Float64(recordingAllocations) / stepsCount, recordingCloseNs * 1.0e-6);
+	}
+	SPDLOG_INFO("Total time:             {:.3f} ms of solver steps", totalNs * 1.0e-6);
+	SPDLOG_INFO("Steps per second:       {:.2f}", stepsCount / (totalNs * 1.0e-9));
+	SPDLOG_INFO("ns per mass-point-step: {:.3f}", totalNs / (stepsCount * Float64(massPointsCount)));
+	SPDLOG_INFO("ns per spring-step:     {:.3f}", totalNs / (stepsCount * Float64(springsCount)));
+
+	// Unstable mass points are moved back by solver, so meshes stay finite and only its count shows divergence
+	const Int64 instabilities = solver.get_statistics().totalInstabilities;
+	if (instabilities > 0 || !is_finite(meshes))
+	{
+		SPDLOG_ERROR("Simulation diverged, {} mass points had non-finite positions or velocities.", instabilities);
+		return 1;
+	}
+
+	return 0;
+}
+
+bool parse_options(Int32 argc, char** argv, BenchmarkOptions& options)
+{
+	for (Int32 i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		const Int32 valuesLeft = argc - i - 1;
+
+		if (argument == "--grid" && valuesLeft >= 2)
+		{
+			options.gridSize = { std::stoi(argv[i + 1]), std::stoi(argv[i + 2]) };
+			i += 2;
+		}
+		else if (argument == "--size" && valuesLeft >= 2)
+		{
+			options.meshSize = { std::stof(argv[i + 1]), std::stof(argv[i + 2]) };
+			i += 2;
+		}
+		else if (argument == "--stiffness" && valuesLeft >= 1)
+		{
+			options.stiffness = std::stof(argv[++i]);
+		}
+		else if (argument == "--mass" && valuesLeft >= 1)
+		{
+			options.clothMass = std::stof(argv[++i]);
+		}
+		else if (argument == "--dt" && valuesLeft >= 1)
+		{
+			options.deltaTime = std::stof(argv[++i]);
+		}
+		else if (argument == "--adaptive-dt")
+		{
+			options.adaptiveTimeStep = true;
+		}
+		else if (argument == "--steps" && valuesLeft >= 1)
+		{
+			options.steps = std::stoi(argv[++i]);
+		}
+		else if (argument == "--warmup" && valuesLeft >= 1)
+		{
+			options.warmupSteps = std::stoi(argv[++i]);
+		}
+		else if (argument == "--threads" && valuesLeft >= 1)
+		{
+			options.threadsCount = std::stoi(argv[++i]);
+		}
+		else if (argument == "--simd" && valuesLeft >= 1)
+		{
+			const std::optional<ESimdLevel> simdLevel = magic_enum::enum_cast<ESimdLevel>(argv[++i]);
+			if (!simdLevel.has_value() || simdLevel.value() > ClothKernels::s_get_supported_level())
+			{
+				SPDLOG_ERROR("SIMD level {} is unknown or not supported by this cpu.", argv[i]);
+				return false;
+			}
+			options.simdLevel = simdLevel.value();
+		}
+		else if (argument == "--integrator" && valuesLeft >= 1)
+		{
+			const std::optional<EIntegrator> integrator = magic_enum::enum_cast<EIntegrator>(argv[++i]);
+			if (!integrator.has_value())
+			{
+				SPDLOG_ERROR("Unknown integrator {}.", argv[i]);
+				return false;
+			}
+			options.integrator = integrator.value();
+		}
+		else if (argument == "--cg-iterations" && valuesLeft >= 1)
+		{
+			options.linearIterations = std::stoi(argv[++i]);
+		}
+		else if (argument == "--xpbd-iterations" && valuesLeft >= 1)
+		{
+			options.constraintIterations = std::stoi(argv[++i]);
+		}
+		else if (argument == "--xpbd-mode" && valuesLeft >= 1)
+		{
+			const std::optional<EXpbdMode> xpbdMode = magic_enum::enum_cast<EXpbdMode>(argv[++i]);
+			if (!xpbdMode.has_value())
+			{
+				SPDLOG_ERROR("Unknown XPBD mode {}.", argv[i]);
+				return false;
+			}
+			options.xpbdMode = xpbdMode.value();
+		}
+		else if (argument == "--cloths" && valuesLeft >= 1)
+		{
+			options.clothsCount = std::stoi(argv[++i]);
+		}
+		else if (argument == "--presorted-springs")
+		{
+			options.presortedSprings = true;
+		}
+		else if (argument == "--point-order" && valuesLeft >= 1)
+		{
+			const std::optional<EPointOrder> pointOrder = magic_enum::enum_cast<EPointOrder>(argv[++i]);
+			if (!pointOrder.has_value())
+			{
+				SPDLOG_ERROR("Unknown point order {}.", argv[i]);
+				return false;
+			}
+			options.pointOrder = pointOrder.value();
+		}
+		else if (argument == "--self-collision" && valuesLeft >= 1)
+		{
+			options.collisionThickness = std::stof(argv[++i]);
+		}
+		else if (argument == "--sphere" && valuesLeft >= 4)
+		{
+			ColliderShape shape;
+			shape.shape	   = EColliderShape::Sphere;
+			shape.position = { std::stof(argv[i + 1]), std::stof(argv[i + 2]), std::stof(argv[i + 3]) };
+			shape.radius   = std::stof(argv[i + 4]);
+			options.colliderShapes.emplace_back(shape);
+			i += 4;
+		}
+		else if (argument == "--plane" && valuesLeft >= 1)
+		{
+			ColliderShape shape;
+			shape.shape		= EColliderShape::Plane;
+			shape.position	= { 0.0f, std::stof(argv[++i]), 0.0f };
+			shape.direction = { 0.0f, 1.0f, 0.0f };
+			options.colliderShapes.emplace_back(shape);
+		}
+		else if (argument == "--mesh-sphere" && valuesLeft >= 5)
+		{
+			options.meshSphere = { std::stof(argv[i + 1]), std::stof(argv[i + 2]), std::stof(argv[i + 3]), std::stof(argv[i + 4]) };
+			options.meshSphereSegments = std::stoi(argv[i + 5]);
+			i += 5;
+			if (options.meshSphereSegments <= 0)
+			{
+				SPDLOG_ERROR("Mesh sphere has to have positive segments count.");
+				return false;
+			}
+		}
+		else if (argument == "--bake" && valuesLeft >= 1)
+		{
+			options.bakePath = argv[++i];
+		}
+		else if (argument == "--bake-quantized")
+		{
+			options.isBakeQuantized = true;
+		}
+		else if (argument == "--gltf" && valuesLeft >= 1)
+		{
+			options.gltfPath = argv[++i];
+		}
+		else if (argument == "--check-rebuild")
+		{
+			options.checkRebuild = true;
+		} else {
+			SPDLOG_ERROR("Unknown or incomplete argument: {}", argument);
+			print_usage();
+			return false;
+		}
+	}
+
+	if (options.gridSize.x < 3 || options.gridSize.y < 3 || options.steps <= 0 || options.threadsCount <= 0
+		|| options.clothsCount <= 0)
+	{
+		SPDLOG_ERROR("Grid size has to be at least 3x3, steps, threads and cloths count positive.");
+		return false;
+	}
+	if (!(options.deltaTime > 0.0f && options.stiffness > 0.0f && options.clothMass > 0.0f && options.meshSize.x > 0.0f
+		  && options.meshSize.y > 0.0f))
+	{
+		SPDLOG_ERROR("Time step, stiffness, mass and mesh size have to be positive.");
+		return false;
+	}
+
+	return true;
+}
+
+void print_usage()
+{
+	SPDLOG_INFO("Usage: ClothBenchmark [--grid X Y] [--size X Y] [--stiffness S] [--mass M] [--dt DT] [--adaptive-dt] [--steps N] [--warmup N] [--threads N] [--simd Scalar|SSE|AVX2] "
+				"[--integrator Explicit|Implicit|Xpbd] [--cg-iterations N] [--xpbd-iterations N] [--xpbd-mode GaussSeidel|Jacobi] [--cloths N] [--presorted-springs] "
+				"[--point-order Grid|Morton|Hilbert] [--self-collision THICKNESS] "
+				"[--sphere X Y Z R] [--plane Y] [--mesh-sphere X Y Z R SEGMENTS] [--bake PATH] [--bake-quantized] [--gltf PATH] [--check-rebuild]");
+}
+
+// Rebuild with presorted springs keeps points and springs counts of greedy coloring, only their order changes
+bool is_xpbd_rebuild_consistent(const BenchmarkOptions& options)
+{
+	const glm::ivec2 GRID_SIZE	= { 16, 16 };
+	constexpr Int32 STEPS		= 10;
+	constexpr Float32 TOLERANCE = 1.0e-5f;
+
+	ClothSolver rebuiltSolver, freshSolver;
+	for (ClothSolver *solver : { &rebuiltSolver, &freshSolver })
+	{
+		solver->settings.deltaTime = options.deltaTime;
+		solver->settings.threadsCount = options.threadsCount;
+		solver->settings.simdLevel = options.simdLevel;
+		solver->settings.integrator = EIntegrator::Xpbd;
+		solver->settings.constraintIterations = options.constraintIterations;
+		solver->settings.xpbdMode = EXpbdMode::Jacobi;
+	}
+	std::vector<ClothData> rebuiltCloths(1), freshCloths(1);
+	Mesh rebuiltMesh, freshMesh;
+	const std::vector<Mesh*> rebuiltMeshes = { &rebuiltMesh };
+	const std::vector<Mesh*> freshMeshes = { &freshMesh };
+
+	rebuiltSolver.settings.presortedSprings = false;
+	rebuiltSolver.build_cloth(rebuiltCloths[0], rebuiltMesh, GRID_SIZE, options.meshSize, options.clothMass, options.stiffness);
+	rebuiltSolver.step(rebuiltCloths, rebuiltMeshes);
+	rebuiltSolver.settings.presortedSprings = true;
+	rebuiltSolver.build_cloth(rebuiltCloths[0], rebuiltMesh, GRID_SIZE, options.meshSize, options.clothMass, options.stiffness);
+	rebuiltSolver.reset_state();
+
+	freshSolver.settings.presortedSprings = true;
+	freshSolver.build_cloth(freshCloths[0], freshMesh, GRID_SIZE, options.meshSize, options.clothMass, options.stiffness);
+
+	for (Int32 i = 0; i < STEPS; ++i)
+	{
+		rebuiltSolver.step(rebuiltCloths, rebuiltMeshes);
+		freshSolver.step(freshCloths, freshMeshes);
+	}
+
+	for (Int32 i = 0; i < freshMesh.positions.size(); ++i)
+	{
+		const glm::vec3 difference = glm::abs(rebuiltMesh.positions[i] - freshMesh.positions[i]);
+		if (glm::max(difference.x, glm::max(difference.y, difference.z)) > TOLERANCE)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool is_finite(const std::vector<Mesh>& meshes)
+{
+	for (const Mesh& mesh : meshes)
+	{
+		for (const glm::vec3& position : mesh.positions)
+		{
+			if (!std::isfinite(position.x) || !std::isfinite(position.y) || !std::isfinite(position.z))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Spring pass reads both mass points of every spring in solver order. Hardware counters aren't available everywhere,
+// so their reads of one mass point array go through model of 32 KB 8-way LRU cache with 64 byte lines
+Float64 get_simulated_cache_misses(const ClothData& clothData)
+{
+	constexpr Int32 LINE_VALUES = 64 / sizeof(Float32);
+	constexpr Int32 WAYS		= 8;
+	constexpr Int32 SETS		= 32 * 1024 / 64 / WAYS;
+	std::vector<Int64> lines(SETS * WAYS, -1); // Every set from most to least recently used
+	Int64 misses = 0;
+	const auto read = [&](Int32 index)
+	{
+		const Int64 line = index / LINE_VALUES;
+		Int64 *set = lines.data() + (line % SETS) * WAYS;
+		Int32 way = 0;
+		while (way < WAYS && set[way] != line)
+		{
+			way++;
+		}
+		if (way == WAYS)
+		{
+			misses++;
+			way = WAYS - 1;
+		}
+		for (; way > 0; --way)
+		{
+			set[way] = set[way - 1];
+		}
+		set[0] = line;
+	};
+
+	const Int32 springsCount = Int32(clothData.springIndexesA.size());
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		read(clothData.springIndexesA[i]);
+		read(clothData.springIndexesB[i]);
+	}
+	return Float64(misses) / Float64(glm::max(springsCount, 1));
+}
+
+void add_mesh_sphere(StaticColliders& colliders, const glm::vec4& sphere, Int32 segments)
+{
+	// Latitude-longitude sphere, poles are degenerate triangles that colliders skip
+	std::vector<glm::vec3> positions;
+	std::vector<UInt32> indexes;
+	for (Int32 y = 0; y <= segments; ++y)
+	{
+		const Float32 latitude = glm::pi<Float32>() * (0.5f - Float32(y) / Float32(segments));
+		for (Int32 x = 0; x <= segments; ++x)
+		{
+			const Float32 longitude = glm::two_pi<Float32>() * Float32(x) / Float32(segments);
+			positions.emplace_back(glm::cos(latitude) * glm::cos(longitude), glm::sin(latitude), -glm::cos(latitude) * glm::sin(longitude));
+		}
+	}
+	for (Int32 y = 0; y < segments; ++y)
+	{
+		for (Int32 x = 0; x < segments; ++x)
+		{
+			const UInt32 topLeft = UInt32(y * (segments + 1) + x);
+			const UInt32 bottomLeft = topLeft + UInt32(segments + 1);
+			indexes.insert(indexes.end(), { topLeft, bottomLeft, topLeft + 1, topLeft + 1, bottomLeft, bottomLeft + 1 });
+		}
+	}
+
+	const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(sphere)), glm::vec3(sphere.w));
+	colliders.add_mesh(positions, indexes, transform);
+}
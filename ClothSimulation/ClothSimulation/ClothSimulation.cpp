@@ -49,7 +49,7 @@ int main()
 
 		inputManager.process_input();
 		displayManager.update();
-		simulationManager.update();
+		simulationManager.update(deltaTimeMs);
 		renderManager.update(camera);
 	}
 
@@ -1,8 +1,18 @@
 #version 460 core
 out vec4 color;
 
+layout (std140) uniform Frame
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+};
+// Bit 0 of texturesMask is set when material has albedo texture
+layout (std140) uniform Material
+{
+	vec4 materialColor;
+	uint texturesMask;
+};
 uniform sampler2D Albedo;
-uniform vec3 cameraPosition;
 
 in vec3 worldNormal;  
 in vec3 worldPosition;  
@@ -12,7 +22,7 @@ void main()
 {
 	const vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
 	const vec3 lightPosition = vec3(10.0f, 50.0f, 10.0f);
-	vec4 objectColor = vec4(texture(Albedo, uvsFragment));
+	vec4 objectColor = (texturesMask & 1u) != 0u ? texture(Albedo, uvsFragment) * materialColor : materialColor;
 	if (objectColor.w < 0.1f)
 	{
 		discard;
@@ -29,7 +39,7 @@ void main()
 	
     // specular
     float specularStrength = 0.3;
-    vec3 viewDirection = normalize(cameraPosition - worldPosition);
+    vec3 viewDirection = normalize(cameraPosition.xyz - worldPosition);
     vec3 reflectDirection = reflect(-lightDirection, normal);  
     float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), 32);
     vec3 specular = specularStrength * spec * lightColor;  
@@ -0,0 +1,9 @@
+#version 460 core
+out vec4 color;
+
+in vec3 springColor;
+
+void main()
+{
+	color = vec4(springColor, 1.0f);
+}
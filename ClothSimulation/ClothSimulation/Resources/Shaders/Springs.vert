@@ -0,0 +1,17 @@
+#version 460 core
+layout (location = 0) in vec3 position;
+
+layout (std140) uniform Frame
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+};
+uniform mat4 model;
+
+out vec3 localPosition;
+
+void main()
+{
+	localPosition = position;
+	gl_Position = viewProjection * model * vec4(position, 1.0f);
+}
@@ -3,7 +3,11 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uvs;
 
-uniform mat4 viewProjection;
+layout (std140) uniform Frame
+{
+	mat4 viewProjection;
+	vec4 cameraPosition;
+};
 uniform mat4 model;
 
 out vec3 worldPosition;
@@ -0,0 +1,45 @@
+#pragma once
+#include <new>
+
+/** Allocator for arrays that are read with aligned SIMD loads */
+template<typename Type, UInt64 Alignment = 64>
+struct AlignedAllocator
+{
+	using value_type = Type;
+
+	template<typename OtherType>
+	struct rebind
+	{
+		using other = AlignedAllocator<OtherType, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+
+	template<typename OtherType>
+	AlignedAllocator(const AlignedAllocator<OtherType, Alignment>&) {}
+
+	Type* allocate(UInt64 count)
+	{
+		return static_cast<Type*>(::operator new(count * sizeof(Type), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(Type* pointer, UInt64)
+	{
+		::operator delete(pointer, std::align_val_t(Alignment));
+	}
+
+	template<typename OtherType>
+	inline bool operator==(const AlignedAllocator<OtherType, Alignment>&) const
+	{
+		return true;
+	}
+
+	template<typename OtherType>
+	inline bool operator!=(const AlignedAllocator<OtherType, Alignment>&) const
+	{
+		return false;
+	}
+};
+
+template<typename Type>
+using AlignedVector = std::vector<Type, AlignedAllocator<Type>>;
@@ -0,0 +1,128 @@
+#pragma once
+#include <new>
+#include <type_traits>
+
+/** Array inside of arena block, it never grows and its values start uninitialized */
+template<typename Type>
+class ArenaArray
+{
+public:
+	ArenaArray() = default;
+	ArenaArray(Type* pointer, UInt64 count) : pointer(pointer), count(count) {}
+
+	Type* data()			 { return pointer; }
+	const Type* data() const { return pointer; }
+	UInt64 size() const		 { return count; }
+	bool empty() const		 { return count == 0; }
+
+	Type& operator[](UInt64 index)			   { return pointer[index]; }
+	const Type& operator[](UInt64 index) const { return pointer[index]; }
+
+	Type* begin()			  { return pointer; }
+	Type* end()				  { return pointer + count; }
+	const Type* begin() const { return pointer; }
+	const Type* end() const	  { return pointer + count; }
+
+private:
+	Type *pointer = nullptr;
+	UInt64 count  = 0;
+};
+
+/**
+ * Linear allocator over one aligned block. Owner sums sizes of all arrays, resets arena to that size and takes arrays
+ * one after another. Block is kept by later resets that fit into it, so rebuilding same data doesn't touch heap
+ */
+class Arena
+{
+public:
+	static constexpr Int64 ALIGNMENT = 64; // Every array starts at cache line, SIMD loads of it are aligned
+
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	Arena(Arena&& other) noexcept
+		: block(other.block), capacity(other.capacity), used(other.used)
+	{
+		other.block	   = nullptr;
+		other.capacity = 0;
+		other.used	   = 0;
+	}
+
+	Arena& operator=(Arena&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			block	 = other.block;
+			capacity = other.capacity;
+			used	 = other.used;
+			other.block	   = nullptr;
+			other.capacity = 0;
+			other.used	   = 0;
+		}
+		return *this;
+	}
+
+	~Arena()
+	{
+		release();
+	}
+
+	// Bytes taken by array of count values, including padding to next array
+	template<typename Type>
+	static constexpr Int64 s_get_size(Int64 count)
+	{
+		return (count * Int64(sizeof(Type)) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+
+	// Arrays taken before become invalid, block is allocated again only when it is smaller than size
+	void reset(Int64 size)
+	{
+		used = 0;
+		if (size <= capacity)
+		{
+			return;
+		}
+		release();
+		block	 = static_cast<UInt8*>(::operator new(size, std::align_val_t(ALIGNMENT)));
+		capacity = size;
+	}
+
+	// Empty array when arena wasn't reset to size that fits it
+	template<typename Type>
+	ArenaArray<Type> take(Int64 count)
+	{
+		static_assert(std::is_trivially_copyable_v<Type>, "Arena never constructs nor destroys values");
+		const Int64 size = s_get_size<Type>(count);
+		if (used + size > capacity)
+		{
+			SPDLOG_ERROR("Arena of {} bytes has no space for {} more.", capacity, size);
+			return ArenaArray<Type>();
+		}
+		Type *pointer = reinterpret_cast<Type*>(block + used);
+		used += size;
+		return ArenaArray<Type>(pointer, UInt64(count));
+	}
+
+	Int64 get_capacity() const
+	{
+		return capacity;
+	}
+
+private:
+	UInt8 *block   = nullptr;
+	Int64 capacity = 0;
+	Int64 used	   = 0;
+
+	void release()
+	{
+		if (block)
+		{
+			::operator delete(block, std::align_val_t(ALIGNMENT));
+		}
+		block	 = nullptr;
+		capacity = 0;
+		used	 = 0;
+	}
+};
@@ -1,21 +1,95 @@
 #pragma once
-template<typename Type>
-struct Handle;
+#include "arena.hpp"
+#include "handle.hpp"
+
 struct Mesh;
+struct Model;
+
+// Mass point arrays are padded to multiple of this with pinned, massless points
+constexpr Int32 SIMD_WIDTH = 8;
+// Springs are colored by bits of 64 bit mask
+constexpr Int32 MAX_SPRING_BATCHES = 64;
+
+// Springs connect grid neighbours, type follows from distance of their mass points
+enum class ESpringType : Int8
+{
+	Structural,	// Horizontal and vertical neighbours
+	Shear,		// Diagonal neighbours
+	Flexion		// Second neighbours along rows and columns
+};
+
+// Order of mass points in cloth arrays, mesh vertices always stay row by row
+enum class EPointOrder : Int8
+{
+	Grid,	// Row by row, same as mesh
+	Morton,	// Z-order curve over grid
+	Hilbert	// Hilbert curve over grid, most neighbours along it are grid neighbours
+};
 
 struct ClothData //Something like cloth component that require mesh
 {
-	// Mass points data
-	std::vector<glm::vec3>	velocities;
-	std::vector<glm::vec3>	accelerations;
-	std::vector<Float32>	masses;
-	std::vector<bool>		simulatedFlags;  // True means it is simulated, False it's attached
+	// All arrays below are parts of this block, it is sized once by build and reused by rebuild of same grid
+	Arena					arena;
+
+	// Mass points data, structure of arrays padded to SIMD_WIDTH
+	Int32					massPointsCount = 0;
+	ArenaArray<Float32>		positionsX, positionsY, positionsZ;
+	ArenaArray<Float32>		velocitiesX, velocitiesY, velocitiesZ;
+	ArenaArray<Float32>		masses;
+	ArenaArray<Float32>		inverseMasses;	 // Zero for attached and padding points
+	ArenaArray<UInt8>		simulatedFlags;  // 1 means it is simulated, 0 it's attached
 	glm::ivec2				gridSize;
 
 	// Springs data
-	std::vector<Float32>    restLengths;
-	std::vector<Float32>    stiffnesses;
-	std::vector<glm::ivec2> springAttachments;
+	ArenaArray<Float32>		restLengths;
+	ArenaArray<Float32>		stiffnesses;
+	ArenaArray<Int32>		springIndexesA;
+	ArenaArray<Int32>		springIndexesB;
+	// Springs are sorted by color, springs in batch [offsets[i], offsets[i + 1]) don't share mass points
+	ArenaArray<Int32>		springBatchOffsets;
+
+	// Extremes of build used by stability estimate of adaptive time step
+	Float32					minRestLength  = 0.0f;
+	Float32					maxStiffness   = 0.0f;
+	Float32					maxInverseMass = 0.0f;
+
+	// Mesh vertex of every mass point and mass point of every vertex, both empty in grid order
+	EPointOrder				pointOrder = EPointOrder::Grid;
+	ArenaArray<Int32>		pointVertices;
+	ArenaArray<Int32>		vertexPoints;
 
 	Handle<Mesh>			simulatedMesh;
+	Handle<Model>			simulatedModel;
+
+	Int32 get_padded_count() const
+	{
+		return Int32(positionsX.size());
+	}
+
+	glm::vec3 get_position(Int32 index) const
+	{
+		return { positionsX[index], positionsY[index], positionsZ[index] };
+	}
+
+	Int32 get_mesh_vertex(Int32 point) const
+	{
+		return pointVertices.empty() ? point : pointVertices[point];
+	}
+
+	Int32 get_mass_point(Int32 vertex) const
+	{
+		return vertexPoints.empty() ? vertex : vertexPoints[vertex];
+	}
+
+	ESpringType get_spring_type(Int32 spring) const
+	{
+		const Int32 indexA = get_mesh_vertex(springIndexesA[spring]), indexB = get_mesh_vertex(springIndexesB[spring]);
+		const Int32 distanceX = glm::abs(indexA % gridSize.x - indexB % gridSize.x);
+		const Int32 distanceY = glm::abs(indexA / gridSize.x - indexB / gridSize.x);
+		if (distanceX + distanceY == 1)
+		{
+			return ESpringType::Structural;
+		}
+		return distanceX == 1 && distanceY == 1 ? ESpringType::Shear : ESpringType::Flexion;
+	}
 };
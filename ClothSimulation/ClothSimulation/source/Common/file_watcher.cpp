@@ -0,0 +1,162 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// How often watching thread checks whether it should stop
+	constexpr Int32 STOP_CHECK_MS = 100;
+
+#ifdef _WIN32
+	void scan_write_times(const std::string& directoryPath, std::unordered_map<std::string, Int64>& writeTimes)
+	{
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directoryPath, error))
+		{
+			if (entry.is_regular_file(error))
+			{
+				writeTimes[entry.path().filename().string()] = entry.last_write_time(error).time_since_epoch().count();
+			}
+		}
+	}
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+	stop();
+}
+
+bool FileWatcher::start(const std::string& directoryPath)
+{
+	stop();
+	this->directoryPath = directoryPath;
+#ifdef _WIN32
+	notification = FindFirstChangeNotificationA(directoryPath.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (notification == INVALID_HANDLE_VALUE)
+	{
+		notification = nullptr;
+		SPDLOG_ERROR("Failed to watch directory: {}", directoryPath);
+		return false;
+	}
+	scan_write_times(directoryPath, writeTimes);
+#else
+	inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// Editors often save into temporary file and rename it, so moved in files count as written too
+	if (inotify < 0 || inotify_add_watch(inotify, directoryPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		SPDLOG_ERROR("Failed to watch directory: {}", directoryPath);
+		stop();
+		return false;
+	}
+#endif
+	shouldStop = false;
+	watchingThread = std::thread(&FileWatcher::watch_loop, this);
+	return true;
+}
+
+void FileWatcher::stop()
+{
+	shouldStop = true;
+	if (watchingThread.joinable())
+	{
+		watchingThread.join();
+	}
+#ifdef _WIN32
+	if (notification)
+	{
+		FindCloseChangeNotification(notification);
+		notification = nullptr;
+	}
+	writeTimes.clear();
+#else
+	if (inotify >= 0)
+	{
+		::close(inotify);
+		inotify = -1;
+	}
+#endif
+	std::lock_guard lock(mutex);
+	changes.clear();
+}
+
+std::vector<std::string> FileWatcher::take_changes()
+{
+	std::vector<std::string> takenChanges;
+	std::lock_guard lock(mutex);
+	takenChanges.swap(changes);
+	return takenChanges;
+}
+
+void FileWatcher::watch_loop()
+{
+#ifdef _WIN32
+	std::unordered_map<std::string, Int64> currentTimes;
+	while (!shouldStop)
+	{
+		if (WaitForSingleObject(notification, STOP_CHECK_MS) != WAIT_OBJECT_0)
+		{
+			continue;
+		}
+		currentTimes.clear();
+		scan_write_times(directoryPath, currentTimes);
+		for (const auto& [fileName, writeTime] : currentTimes)
+		{
+			const auto found = writeTimes.find(fileName);
+			if (found == writeTimes.end() || found->second != writeTime)
+			{
+				add_change(fileName);
+			}
+		}
+		writeTimes.swap(currentTimes);
+		FindNextChangeNotification(notification);
+	}
+#else
+	alignas(inotify_event) char buffer[4096];
+	pollfd descriptor = { inotify, POLLIN, 0 };
+	while (!shouldStop)
+	{
+		if (poll(&descriptor, 1, STOP_CHECK_MS) <= 0)
+		{
+			continue;
+		}
+		Int64 length;
+		while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+		{
+			for (Int64 offset = 0; offset < length;)
+			{
+				const inotify_event *event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				if (event->len > 0)
+				{
+					add_change(event->name);
+				}
+				offset += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+#endif
+}
+
+void FileWatcher::add_change(const std::string& fileName)
+{
+	std::lock_guard lock(mutex);
+	if (std::find(changes.begin(), changes.end(), fileName) == changes.end())
+	{
+		changes.push_back(fileName);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+/**
+ * Watches files of one directory on background thread, inotify on Linux and change notifications on Windows.
+ * Names of written files are collected until owner takes them, so checking for changes never blocks frame
+ */
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	FileWatcher(FileWatcher&) = delete;
+	~FileWatcher();
+
+	// Restarts watcher if it was already watching
+	bool start(const std::string& directoryPath);
+	void stop();
+
+	// File names without directory, each at most once, written since last call
+	std::vector<std::string> take_changes();
+
+private:
+	std::string directoryPath;
+	std::thread watchingThread;
+	std::atomic<bool> shouldStop = false;
+	std::mutex mutex;
+	std::vector<std::string> changes;
+#ifdef _WIN32
+	void* notification = nullptr;
+	std::unordered_map<std::string, Int64> writeTimes; // Notification doesn't tell which file changed
+#else
+	Int32 inotify = -1;
+#endif
+
+	void watch_loop();
+	void add_change(const std::string& fileName);
+};
@@ -4,15 +4,16 @@ template<typename Type>
 struct Handle
 {
 	Int32 id;
+	UInt32 generation = 0; // Of registry slot when handle was made, handle is stale after slot is reused
 
 	static const Handle<Type> sNone;
 	inline bool operator==(const Handle<Type>& other) const
 	{
-		return id == other.id;
+		return id == other.id && generation == other.generation;
 	}
 
 	inline bool operator!=(const Handle<Type>& other) const
 	{
-		return id != other.id;
+		return !(*this == other);
 	}
 };
@@ -0,0 +1,124 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& filePath)
+{
+	close();
+#ifdef _WIN32
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = nullptr;
+		SPDLOG_ERROR("Failed to open file for mapping: {}", filePath);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		SPDLOG_ERROR("Failed to map empty file: {}", filePath);
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		SPDLOG_ERROR("Failed to map file: {}", filePath);
+		close();
+		return false;
+	}
+	data = static_cast<const UInt8*>(view);
+	size = Int64(fileSize.QuadPart);
+#else
+	const int descriptor = ::open(filePath.c_str(), O_RDONLY);
+	if (descriptor < 0)
+	{
+		SPDLOG_ERROR("Failed to open file for mapping: {}", filePath);
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(descriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		SPDLOG_ERROR("Failed to map empty file: {}", filePath);
+		::close(descriptor);
+		return false;
+	}
+
+	// Mapping holds its own reference to file, descriptor isn't needed after this
+	void* view = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+	::close(descriptor);
+	if (view == MAP_FAILED)
+	{
+		SPDLOG_ERROR("Failed to map file: {}", filePath);
+		return false;
+	}
+	data = static_cast<const UInt8*>(view);
+	size = Int64(fileStatus.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle)
+	{
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = nullptr;
+	fileHandle	  = nullptr;
+#else
+	if (data)
+	{
+		munmap(const_cast<UInt8*>(data), size_t(size));
+	}
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+const UInt8* MappedFile::get_data() const
+{
+	return data;
+}
+
+Int64 MappedFile::get_size() const
+{
+	return size;
+}
+
+bool MappedFile::is_open() const
+{
+	return data != nullptr;
+}
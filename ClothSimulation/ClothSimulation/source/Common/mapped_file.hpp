@@ -0,0 +1,25 @@
+#pragma once
+
+/** Read only view of whole file mapped into memory, pages are loaded by system when they are touched */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile&) = delete;
+	~MappedFile();
+
+	bool open(const std::string& filePath);
+	void close();
+
+	const UInt8* get_data() const;
+	Int64 get_size() const;
+	bool is_open() const;
+
+private:
+	const UInt8* data = nullptr;
+	Int64 size = 0;
+#ifdef _WIN32
+	void* fileHandle	= nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,282 @@
+#pragma once
+#include <memory>
+
+#include "handle.hpp"
+
+// Resource name hashed at compile time for literals, so lookups by constant names don't build or hash strings
+struct ResourceName
+{
+	UInt32 hash;
+
+	consteval ResourceName(const char* name) : hash(s_hash(name)) {}
+	ResourceName(const std::string& name) : hash(s_hash(name.c_str())) {}
+
+	// FNV-1a
+	static constexpr UInt32 s_hash(const char* name)
+	{
+		UInt32 hash = 2166136261U;
+		for (; *name != '\0'; ++name)
+		{
+			hash = (hash ^ UInt8(*name)) * 16777619U;
+		}
+		return hash;
+	}
+};
+
+/**
+ * Named resources in slots that never move, so references stay valid while others are added. Names are found in flat
+ * open addressing table of their hashes. Slot of removed resource is reused with next generation, handles to removed
+ * one are then rejected instead of reaching new resource
+ */
+template<typename Type>
+class ResourceRegistry
+{
+public:
+	static constexpr Int32 CHUNK_SIZE = 64;
+
+	// Returns none if name is taken, or if other name has same hash
+	Handle<Type> add(const std::string& name, const Type& resource = Type())
+	{
+		const UInt32 hash = ResourceName::s_hash(name.c_str());
+		const Int32 entry = find_entry(hash);
+		if (entry >= 0)
+		{
+			const std::string &existingName = get_slot(table[entry].slot).name;
+			if (existingName != name)
+			{
+				SPDLOG_ERROR("Resource name {} has same hash as {}.", name, existingName);
+			}
+			return Handle<Type>::sNone;
+		}
+
+		Int32 index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		} else {
+			if (slotsCount % CHUNK_SIZE == 0)
+			{
+				chunks.emplace_back(std::make_unique<Slot[]>(CHUNK_SIZE));
+			}
+			index = slotsCount++;
+		}
+		Slot &slot	  = get_slot(index);
+		slot.resource = resource;
+		slot.name	  = name;
+		slot.hash	  = hash;
+		slot.isAlive  = true;
+		insert_entry(hash, index);
+		++count;
+		return Handle<Type>{ index, slot.generation };
+	}
+
+	// Resource is reset and its handles become invalid
+	void remove(Handle<Type> handle)
+	{
+		if (!is_valid(handle))
+		{
+			return;
+		}
+		Slot &slot = get_slot(handle.id);
+		table[find_entry(slot.hash)].slot = REMOVED_ENTRY;
+		slot.resource = Type();
+		slot.name.clear();
+		slot.isAlive = false;
+		++slot.generation;
+		freeSlots.push_back(handle.id);
+		--count;
+	}
+
+	// Returns none when name isn't registered
+	Handle<Type> find(ResourceName name) const
+	{
+		const Int32 entry = find_entry(name.hash);
+		if (entry < 0)
+		{
+			return Handle<Type>::sNone;
+		}
+		const Int32 index = table[entry].slot;
+		return Handle<Type>{ index, get_slot(index).generation };
+	}
+
+	bool is_valid(Handle<Type> handle) const
+	{
+		if (handle.id < 0 || handle.id >= slotsCount)
+		{
+			return false;
+		}
+		const Slot &slot = get_slot(handle.id);
+		return slot.isAlive && slot.generation == handle.generation;
+	}
+
+	// Null for invalid handle
+	Type* get(Handle<Type> handle)
+	{
+		return is_valid(handle) ? &get_slot(handle.id).resource : nullptr;
+	}
+
+	const Type* get(Handle<Type> handle) const
+	{
+		return is_valid(handle) ? &get_slot(handle.id).resource : nullptr;
+	}
+
+	// Returned by owners in place of missing resources, registry must not be empty
+	Type& get_first()
+	{
+		return get_slot(0).resource;
+	}
+
+	// Function is called with handle and resource of every registered resource in order of slots
+	template<typename Function>
+	void for_each(Function&& function)
+	{
+		for (Int32 i = 0; i < slotsCount; ++i)
+		{
+			Slot &slot = get_slot(i);
+			if (slot.isAlive)
+			{
+				function(Handle<Type>{ i, slot.generation }, slot.resource);
+			}
+		}
+	}
+
+	template<typename Function>
+	void for_each(Function&& function) const
+	{
+		for (Int32 i = 0; i < slotsCount; ++i)
+		{
+			const Slot &slot = get_slot(i);
+			if (slot.isAlive)
+			{
+				function(Handle<Type>{ i, slot.generation }, slot.resource);
+			}
+		}
+	}
+
+	Int32 get_count() const
+	{
+		return count;
+	}
+
+	// Generations restart, so handles made before clear may be accepted by resources added after it
+	void clear()
+	{
+		chunks.clear();
+		freeSlots.clear();
+		table.clear();
+		slotsCount	= 0;
+		usedEntries = 0;
+		count		= 0;
+	}
+
+private:
+	static constexpr Int32 EMPTY_ENTRY	 = -1;
+	static constexpr Int32 REMOVED_ENTRY = -2; // Keeps probing going past removed names
+
+	struct Slot
+	{
+		Type resource;
+		std::string name;
+		UInt32 hash		  = 0;
+		UInt32 generation = 0;
+		bool isAlive	  = false;
+	};
+
+	struct Entry
+	{
+		UInt32 hash = 0;
+		Int32 slot	= EMPTY_ENTRY;
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> chunks;
+	std::vector<Int32> freeSlots;
+	std::vector<Entry> table; // Size is power of two, linear probing
+	Int32 slotsCount  = 0;
+	Int32 usedEntries = 0; // Registered and removed entries, table grows when they fill half of it
+	Int32 count		  = 0;
+
+	Slot& get_slot(Int32 index)
+	{
+		return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+	}
+
+	const Slot& get_slot(Int32 index) const
+	{
+		return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+	}
+
+	// Index of entry with hash, -1 if there is none
+	Int32 find_entry(UInt32 hash) const
+	{
+		if (table.empty())
+		{
+			return -1;
+		}
+		const UInt32 mask = UInt32(table.size()) - 1;
+		for (UInt32 i = hash & mask;; i = (i + 1) & mask)
+		{
+			const Entry &entry = table[i];
+			if (entry.slot == EMPTY_ENTRY)
+			{
+				return -1;
+			}
+			if (entry.slot >= 0 && entry.hash == hash)
+			{
+				return Int32(i);
+			}
+		}
+	}
+
+	void insert_entry(UInt32 hash, Int32 slot)
+	{
+		if (2 * (usedEntries + 1) > Int32(table.size()))
+		{
+			rebuild_table();
+		}
+		const UInt32 mask = UInt32(table.size()) - 1;
+		UInt32 i = hash & mask;
+		while (table[i].slot >= 0)
+		{
+			i = (i + 1) & mask;
+		}
+		if (table[i].slot == EMPTY_ENTRY)
+		{
+			++usedEntries;
+		}
+		table[i] = Entry{ hash, slot };
+	}
+
+	// Removed entries are dropped, so table doesn't grow when they filled it
+	void rebuild_table()
+	{
+		std::vector<Entry> oldTable = std::move(table);
+		Int32 registeredCount = 0;
+		for (const Entry &entry : oldTable)
+		{
+			registeredCount += entry.slot >= 0;
+		}
+		Int32 size = 16;
+		while (4 * (registeredCount + 1) > size)
+		{
+			size *= 2;
+		}
+		table.assign(size, Entry());
+		usedEntries = 0;
+		const UInt32 mask = UInt32(size) - 1;
+		for (const Entry &entry : oldTable)
+		{
+			if (entry.slot < 0)
+			{
+				continue;
+			}
+			UInt32 i = entry.hash & mask;
+			while (table[i].slot != EMPTY_ENTRY)
+			{
+				i = (i + 1) & mask;
+			}
+			table[i] = entry;
+			++usedEntries;
+		}
+	}
+};
@@ -2,17 +2,20 @@
 
 #include <fstream>
 #include <sstream>
+#include <filesystem>
 #include <glad/glad.h>
 
-void Shader::create(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath)
+bool Shader::create(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath)
 {
     this->vertexPath = vertexPath;
     this->fragmentPath = fragmentPath;
+    this->geometryPath = geometryPath;
     std::string vShaderCode, fShaderCode, gShaderCode;
     std::ifstream vShaderFile, fShaderFile, gShaderFile;
 
     vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
     // Replace exception with something prettier
     try
@@ -32,7 +35,6 @@ void Shader::create(const std::string& vertexPath, const std::string& fragmentPa
 
         if (!geometryPath.empty())
         {
-            this->geometryPath = geometryPath;
             gShaderFile.open(geometryPath);
             gShaderStream << gShaderFile.rdbuf();
             gShaderFile.close();
@@ -43,60 +45,18 @@ void Shader::create(const std::string& vertexPath, const std::string& fragmentPa
     catch (std::ifstream::failure& e)
     {
         SPDLOG_ERROR("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: {}", e.what());
-        return;
-    }
-    const char *vertexShaderCode, *fragmentShaderCode, *geometryShaderCode;
-
-    vertexShaderCode = vShaderCode.c_str();
-    fragmentShaderCode = fShaderCode.c_str();
-    if (!geometryPath.empty())
-    {
-        geometryShaderCode = gShaderCode.c_str();
+        return false;
     }
-    UInt32 vertex, fragment, geometry;
-
-    // Vertex Shader  
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexShaderCode, NULL);
-    glCompileShader(vertex);
-    check_compile_errors(vertex, EShaderType::Vertex);
-
-    // Fragment Shader  
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentShaderCode, NULL);
-    glCompileShader(fragment);
-    check_compile_errors(fragment, EShaderType::Fragment);
 
+    std::vector<Source> sources = { { EShaderType::Vertex, std::move(vShaderCode) }, { EShaderType::Fragment, std::move(fShaderCode) } };
     if (!geometryPath.empty())
     {
-        // Geometry Shader  
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &geometryShaderCode, NULL);
-        glCompileShader(geometry);
-        check_compile_errors(geometry, EShaderType::Geometry);
-    }
-
-    // Program Object  
-    id = glCreateProgram();
-    glAttachShader(id, vertex);
-    glAttachShader(id, fragment);
-    if (!geometryPath.empty())
-    {
-        glAttachShader(id, geometry);
-    }
-    glLinkProgram(id);
-    check_compile_errors(id, EShaderType::None);
-
-    // Deleting shaders
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (!geometryPath.empty())
-    {
-        glDeleteShader(geometry);
+        sources.push_back({ EShaderType::Geometry, std::move(gShaderCode) });
     }
+    return link(sources);
 }
 
-void Shader::create(const std::string& computePath)
+bool Shader::create(const std::string& computePath)
 {
     this->computePath = computePath;
     std::string computeShaderCode;
@@ -114,36 +74,163 @@ void Shader::create(const std::string& computePath)
     catch (std::ifstream::failure& e)
     {
         SPDLOG_ERROR("ERROR::COMPUTE::SHADER::FILE_NOT_SUCCESFULLY_READ: {}", e.what());
+        return false;
     }
-    const char* cShaderCode = computeShaderCode.c_str();
-    UInt32 compute;
-    
-    compute = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(compute, 1, &cShaderCode, NULL);
-    glCompileShader(compute);
-    check_compile_errors(compute, EShaderType::Compute);
-
+    return link({ { EShaderType::Compute, std::move(computeShaderCode) } });
+}
 
-    id = glCreateProgram();
-    glAttachShader(id, compute);
-    glLinkProgram(id);
-    check_compile_errors(id, EShaderType::None);
+bool Shader::reload()
+{
+    if (computePath.empty())
+    {
+        return create(vertexPath, fragmentPath, geometryPath);
+    }
+    return create(computePath);
+}
 
-    glDeleteShader(compute);
+bool Shader::has_source(const std::string& fileName) const
+{
+    for (const std::string* path : { &vertexPath, &fragmentPath, &geometryPath, &computePath })
+    {
+        if (!path->empty() && std::filesystem::path(*path).filename() == fileName)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
-void Shader::reload()
+bool Shader::link(const std::vector<Source>& sources)
 {
+    // Binary is valid only for same driver, so its strings are hashed with sources
+    std::string binaryPath;
+    const bool isCached = !sBinaryCachePath.empty() && GLAD_GL_VERSION_4_1;
+    if (isCached)
+    {
+        UInt64 hash = 14695981039346656037ULL;
+        const auto hash_bytes = [&hash](const void* data, Int64 size)
+        {
+            for (Int64 i = 0; i < size; ++i)
+            {
+                hash = (hash ^ static_cast<const UInt8*>(data)[i]) * 1099511628211ULL;
+            }
+        };
+        for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const char* driverString = reinterpret_cast<const char*>(glGetString(name));
+            hash_bytes(driverString, driverString ? std::strlen(driverString) : 0);
+        }
+        for (const Source& source : sources)
+        {
+            hash_bytes(&source.type, sizeof(source.type));
+            hash_bytes(source.code.data(), source.code.size());
+        }
+        binaryPath = fmt::format("{}{:016x}.bin", sBinaryCachePath, hash);
+    }
+
+    UInt32 program = glCreateProgram();
+    if (!isCached || !load_binary(program, binaryPath))
+    {
+        std::vector<UInt32> shaders;
+        for (const Source& source : sources)
+        {
+            GLenum type = GL_VERTEX_SHADER;
+            switch (source.type)
+            {
+                case EShaderType::Geometry:
+                    type = GL_GEOMETRY_SHADER;
+                break;
+                case EShaderType::Fragment:
+                    type = GL_FRAGMENT_SHADER;
+                break;
+                case EShaderType::Compute:
+                    type = GL_COMPUTE_SHADER;
+                break;
+                default:
+                break;
+            }
+            const char *code = source.code.c_str();
+            const UInt32 shader = glCreateShader(type);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            check_compile_errors(shader, source.type);
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+
+        if (isCached)
+        {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program);
+        const bool isLinked = check_compile_errors(program, EShaderType::None);
+
+        // Deleting shaders
+        for (const UInt32 shader : shaders)
+        {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        if (!isLinked)
+        {
+            glDeleteProgram(program);
+            return false;
+        }
+        if (isCached)
+        {
+            save_binary(program, binaryPath);
+        }
+    }
+
     shutdown();
-    if (!geometryPath.empty())
+    id = program;
+    cache_uniform_locations();
+    return true;
+}
+
+bool Shader::load_binary(UInt32 programId, const std::string& binaryPath)
+{
+    std::ifstream file(binaryPath, std::ios::binary | std::ios::ate);
+    if (!file)
     {
-        create(vertexPath, fragmentPath);
+        return false;
     }
-    else if (computePath.empty())
+    const Int64 fileSize = file.tellg();
+    GLenum format = 0;
+    std::vector<char> binary(glm::max(fileSize - Int64(sizeof(format)), Int64(0)));
+    file.seekg(0);
+    if (binary.empty() || !file.read(reinterpret_cast<char*>(&format), sizeof(format)) || !file.read(binary.data(), binary.size()))
     {
-        create(vertexPath, fragmentPath, geometryPath);
-    } else {
-        create(computePath);
+        return false;
+    }
+
+    // Driver may reject binary of its older version, program is then compiled again and binary replaced
+    glProgramBinary(programId, format, binary.data(), GLsizei(binary.size()));
+    Int32 success = 0;
+    glGetProgramiv(programId, GL_LINK_STATUS, &success);
+    return success;
+}
+
+void Shader::save_binary(UInt32 programId, const std::string& binaryPath)
+{
+    Int32 size = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+    {
+        return;
+    }
+    GLenum format = 0;
+    std::vector<char> binary(size);
+    glGetProgramBinary(programId, size, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(sBinaryCachePath, error);
+    std::ofstream file(binaryPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(binary.data(), binary.size());
+    if (!file)
+    {
+        SPDLOG_WARN("Failed to write program binary: {}", binaryPath);
     }
 }
 
@@ -156,54 +243,54 @@ void Shader::use()
     }
 }
 
-void Shader::set_bool(const std::string& name, bool value)
+void Shader::set_bool(UniformName name, bool value)
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), (Int32)value);
+    glUniform1i(get_location(name), (Int32)value);
 }
 
-void Shader::set_int(const std::string& name, Int32 value)
+void Shader::set_int(UniformName name, Int32 value)
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1i(get_location(name), value);
 }
 
-void Shader::set_float(const std::string& name, Float32 value)
+void Shader::set_float(UniformName name, Float32 value)
 {
-    glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1f(get_location(name), value);
 }
 
-void Shader::set_vec2(const std::string& name, Float32 x, Float32 y)
+void Shader::set_vec2(UniformName name, Float32 x, Float32 y)
 {
-    glUniform2f(glGetUniformLocation(id, name.c_str()), x, y);
+    glUniform2f(get_location(name), x, y);
 }
 
-void Shader::set_vec2(const std::string& name, const glm::vec2& vector)
+void Shader::set_vec2(UniformName name, const glm::vec2& vector)
 {
-    glUniform2f(glGetUniformLocation(id, name.c_str()), vector.x, vector.y);
+    glUniform2f(get_location(name), vector.x, vector.y);
 }
 
-void Shader::set_vec3(const std::string& name, Float32 x, Float32 y, Float32 z)
+void Shader::set_vec3(UniformName name, Float32 x, Float32 y, Float32 z)
 {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+    glUniform3f(get_location(name), x, y, z);
 }
 
-void Shader::set_vec3(const std::string& name, const glm::vec3& vector)
+void Shader::set_vec3(UniformName name, const glm::vec3& vector)
 {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), vector.x, vector.y, vector.z);
+    glUniform3f(get_location(name), vector.x, vector.y, vector.z);
 }
 
-void Shader::set_vec4(const std::string& name, Float32 x, Float32 y, Float32 z, Float32 w)
+void Shader::set_vec4(UniformName name, Float32 x, Float32 y, Float32 z, Float32 w)
 {
-    glUniform4f(glGetUniformLocation(id, name.c_str()), x, y, z, w);
+    glUniform4f(get_location(name), x, y, z, w);
 }
 
-void Shader::set_vec4(const std::string& name, const glm::vec4& vector)
+void Shader::set_vec4(UniformName name, const glm::vec4& vector)
 {
-    glUniform4f(glGetUniformLocation(id, name.c_str()), vector.x, vector.y, vector.z, vector.w);
+    glUniform4f(get_location(name), vector.x, vector.y, vector.z, vector.w);
 }
 
-void Shader::set_mat4(const std::string& name, const glm::mat4& value)
+void Shader::set_mat4(UniformName name, const glm::mat4& value)
 {
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &value[0][0]);
+    glUniformMatrix4fv(get_location(name), 1, GL_FALSE, &value[0][0]);
 }
 
 void Shader::set_block(const std::string& name, UInt32 number)
@@ -218,7 +305,44 @@ void Shader::s_bind_uniform_buffer(UInt32 uniformBufferObject, UInt32 offset, UI
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-void Shader::check_compile_errors(UInt32 shaderId, EShaderType shaderType)
+void Shader::cache_uniform_locations()
+{
+    uniformLocations.clear();
+    Int32 uniformsCount = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniformsCount);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength, '\0');
+    for (Int32 i = 0; i < uniformsCount; ++i)
+    {
+        Int32 length = 0, size = 0;
+        GLenum type;
+        glGetActiveUniform(id, i, maxLength, &length, &size, &type, name.data());
+        name.resize(length);
+        // Uniforms of blocks have no location
+        const Int32 location = glGetUniformLocation(id, name.c_str());
+        if (location >= 0)
+        {
+            if (name.ends_with("[0]"))
+            {
+                name.resize(name.size() - 3);
+            }
+            const auto [found, isInserted] = uniformLocations.try_emplace(UniformName::s_hash(name.c_str()), location);
+            if (!isInserted)
+            {
+                SPDLOG_ERROR("Uniform {} has same hash as other uniform of shader {}.", name, vertexPath.empty() ? computePath : vertexPath);
+            }
+        }
+        name.resize(maxLength);
+    }
+}
+
+Int32 Shader::get_location(UniformName name) const
+{
+    const auto found = uniformLocations.find(name.hash);
+    return found != uniformLocations.end() ? found->second : -1;
+}
+
+bool Shader::check_compile_errors(UInt32 shaderId, EShaderType shaderType)
 {
     Int32 success;
     char infoLog[1024];
@@ -263,6 +387,7 @@ void Shader::check_compile_errors(UInt32 shaderId, EShaderType shaderType)
             SPDLOG_ERROR("ERROR::PROGRAM_LINKING_ERROR::{}\n{}", name, infoLog);
         }
     }
+    return success;
 }
 
 void Shader::shutdown()
@@ -270,6 +395,11 @@ void Shader::shutdown()
     if (id != 0)
     {
         glDeleteProgram(id);
+        if (sActiveShaderId == id)
+        {
+            sActiveShaderId = 0U;
+        }
         id = 0;
+        uniformLocations.clear();
     }
 }
\ No newline at end of file
@@ -9,36 +9,74 @@ enum class EShaderType : Int8
     Compute
 };
 
+// Uniform name hashed at compile time, setters find location by hash without building strings or asking driver
+struct UniformName
+{
+    UInt32 hash;
+
+    consteval UniformName(const char* name) : hash(s_hash(name)) {}
+
+    // FNV-1a
+    static constexpr UInt32 s_hash(const char* name)
+    {
+        UInt32 hash = 2166136261U;
+        for (; *name != '\0'; ++name)
+        {
+            hash = (hash ^ UInt8(*name)) * 16777619U;
+        }
+        return hash;
+    }
+};
+
 class Shader
 {
 public:
-    // Read shaders from disk and create them
-    void create(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath = "");
-    void create(const std::string& computePath);
-    void reload();
+    // Read shaders from disk and create them, program is loaded from binary cache when sources didn't change.
+    // On failure previous program is kept
+    bool create(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath = "");
+    bool create(const std::string& computePath);
+    // Uniform locations are cached again, but values and block bindings of old program are lost
+    bool reload();
+    // File name without directory matches any source of shader
+    bool has_source(const std::string& fileName) const;
 
     void use();
 
-    // Setters for uniforms
-    void set_bool (const std::string& name, bool value);
-    void set_int  (const std::string& name, Int32 value);
-    void set_float(const std::string& name, Float32 value);
-    void set_vec2 (const std::string& name, Float32 x, Float32 y);
-    void set_vec2 (const std::string& name, const glm::vec2& vector);
-    void set_vec3 (const std::string& name, Float32 x, Float32 y, Float32 z);
-    void set_vec3 (const std::string& name, const glm::vec3& vector);
-    void set_vec4 (const std::string& name, Float32 x, Float32 y, Float32 z, Float32 w);
-    void set_vec4 (const std::string& name, const glm::vec4& vector);
-    void set_mat4 (const std::string& name, const glm::mat4& value);
+    // Setters for uniforms, locations are cached after every link. Missing uniforms are ignored like location -1
+    void set_bool (UniformName name, bool value);
+    void set_int  (UniformName name, Int32 value);
+    void set_float(UniformName name, Float32 value);
+    void set_vec2 (UniformName name, Float32 x, Float32 y);
+    void set_vec2 (UniformName name, const glm::vec2& vector);
+    void set_vec3 (UniformName name, Float32 x, Float32 y, Float32 z);
+    void set_vec3 (UniformName name, const glm::vec3& vector);
+    void set_vec4 (UniformName name, Float32 x, Float32 y, Float32 z, Float32 w);
+    void set_vec4 (UniformName name, const glm::vec4& vector);
+    void set_mat4 (UniformName name, const glm::mat4& value);
     void set_block(const std::string& name, UInt32 number);
 
     static void s_bind_uniform_buffer(UInt32 uniformBufferObject, UInt32 offset, UInt32 size, Float32* data);
     void shutdown();
 
+    // Directory of program binaries named by hash of sources and driver, empty disables cache
+    static inline std::string sBinaryCachePath = "ShaderCache/";
+
 private:
+    struct Source
+    {
+        EShaderType type;
+        std::string code;
+    };
+
     std::string vertexPath, geometryPath, fragmentPath, computePath;
     UInt32 id = 0U;
-    void check_compile_errors(UInt32 shaderId, EShaderType shaderType);
+    std::unordered_map<UInt32, Int32> uniformLocations; // By hash of name, arrays also by name without [0]
+    bool link(const std::vector<Source>& sources);
+    bool load_binary(UInt32 programId, const std::string& binaryPath);
+    void save_binary(UInt32 programId, const std::string& binaryPath);
+    bool check_compile_errors(UInt32 shaderId, EShaderType shaderType);
+    void cache_uniform_locations();
+    Int32 get_location(UniformName name) const;
 
     static inline UInt32 sActiveShaderId = 0U;
 };
@@ -22,7 +22,6 @@ enum class ETextureType : Int8
 struct Texture 
 {
 	glm::ivec2 size;
-	UInt8* data;
 	Int32 channels;
 	UInt32 gpuId{0};
 	ETextureType type = ETextureType::None;
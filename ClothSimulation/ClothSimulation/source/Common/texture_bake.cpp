@@ -0,0 +1,373 @@
+#include "texture_bake.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	Int64 get_level_bytes(ETextureFormat format, const glm::ivec2& size)
+	{
+		const Int64 blocks = Int64((size.x + 3) / 4) * ((size.y + 3) / 4);
+		switch (format)
+		{
+			case ETextureFormat::RGB8:
+				return Int64(size.x) * size.y * 3;
+			case ETextureFormat::BC1:
+				return blocks * 8;
+			case ETextureFormat::BC3:
+				return blocks * 16;
+			default:
+				return Int64(size.x) * size.y * 4;
+		}
+	}
+
+	glm::ivec2 get_next_level_size(const glm::ivec2& size)
+	{
+		return glm::max(size / 2, glm::ivec2(1));
+	}
+
+	// Box filter of 2x2 pixels, last row or column is repeated for odd sizes
+	void downsample(const std::vector<UInt8>& source, const glm::ivec2& size, Int32 channels, std::vector<UInt8>& output)
+	{
+		const glm::ivec2 outputSize = get_next_level_size(size);
+		output.resize(Int64(outputSize.x) * outputSize.y * channels);
+		for (Int32 y = 0; y < outputSize.y; ++y)
+		{
+			const Int32 y0 = glm::min(2 * y, size.y - 1), y1 = glm::min(2 * y + 1, size.y - 1);
+			for (Int32 x = 0; x < outputSize.x; ++x)
+			{
+				const Int32 x0 = glm::min(2 * x, size.x - 1), x1 = glm::min(2 * x + 1, size.x - 1);
+				for (Int32 c = 0; c < channels; ++c)
+				{
+					const Int32 sum = source[(Int64(y0) * size.x + x0) * channels + c] + source[(Int64(y0) * size.x + x1) * channels + c]
+									+ source[(Int64(y1) * size.x + x0) * channels + c] + source[(Int64(y1) * size.x + x1) * channels + c];
+					output[(Int64(y) * outputSize.x + x) * channels + c] = UInt8((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	UInt16 to_565(const glm::ivec3& color)
+	{
+		return UInt16(((color.x * 31 + 127) / 255) << 11 | ((color.y * 63 + 127) / 255) << 5 | ((color.z * 31 + 127) / 255));
+	}
+
+	glm::ivec3 from_565(UInt16 color)
+	{
+		const Int32 r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 1) };
+	}
+
+	// Endpoints are corners of inset bounding box, diagonal follows correlation of channels with the widest one
+	void encode_color_block(const glm::ivec4 pixels[16], UInt8* output)
+	{
+		glm::ivec3 minColor(255), maxColor(0), sum(0);
+		for (Int32 i = 0; i < 16; ++i)
+		{
+			minColor = glm::min(minColor, glm::ivec3(pixels[i]));
+			maxColor = glm::max(maxColor, glm::ivec3(pixels[i]));
+			sum		+= glm::ivec3(pixels[i]);
+		}
+		const glm::ivec3 inset = (maxColor - minColor) / 16;
+		minColor += inset;
+		maxColor -= inset;
+
+		const glm::ivec3 range = maxColor - minColor;
+		const Int32 axis = range.x >= range.y && range.x >= range.z ? 0 : (range.y >= range.z ? 1 : 2);
+		for (Int32 c = 0; c < 3; ++c)
+		{
+			Int64 covariance = 0;
+			for (Int32 i = 0; i < 16; ++i)
+			{
+				covariance += Int64(16 * pixels[i][axis] - sum[axis]) * (16 * pixels[i][c] - sum[c]);
+			}
+			if (covariance < 0)
+			{
+				std::swap(minColor[c], maxColor[c]);
+			}
+		}
+
+		UInt16 endpoints[2] = { to_565(maxColor), to_565(minColor) };
+		// First endpoint has to be greater, otherwise block is in three colour mode
+		if (endpoints[0] < endpoints[1])
+		{
+			std::swap(endpoints[0], endpoints[1]);
+		}
+		const glm::ivec3 color0 = from_565(endpoints[0]), color1 = from_565(endpoints[1]);
+		const glm::ivec3 palette[4] = { color0, color1, (2 * color0 + color1) / 3, (color0 + 2 * color1) / 3 };
+
+		UInt32 indexes = 0;
+		if (endpoints[0] != endpoints[1])
+		{
+			for (Int32 i = 0; i < 16; ++i)
+			{
+				Int32 bestIndex = 0, bestDistance = INT32_MAX;
+				for (Int32 j = 0; j < 4; ++j)
+				{
+					const glm::ivec3 difference = glm::ivec3(pixels[i]) - palette[j];
+					const Int32 distance = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex	 = j;
+					}
+				}
+				indexes |= UInt32(bestIndex) << (2 * i);
+			}
+		}
+		std::memcpy(output, endpoints, sizeof(endpoints));
+		std::memcpy(output + 4, &indexes, sizeof(indexes));
+	}
+
+	// Eight alpha levels between maximum and minimum of block
+	void encode_alpha_block(const glm::ivec4 pixels[16], UInt8* output)
+	{
+		Int32 minAlpha = 255, maxAlpha = 0;
+		for (Int32 i = 0; i < 16; ++i)
+		{
+			minAlpha = glm::min(minAlpha, pixels[i].w);
+			maxAlpha = glm::max(maxAlpha, pixels[i].w);
+		}
+		Int32 palette[8] = { maxAlpha, minAlpha };
+		for (Int32 i = 1; i < 7; ++i)
+		{
+			palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+		}
+
+		UInt64 indexes = 0;
+		if (maxAlpha != minAlpha)
+		{
+			for (Int32 i = 0; i < 16; ++i)
+			{
+				Int32 bestIndex = 0, bestDistance = INT32_MAX;
+				for (Int32 j = 0; j < 8; ++j)
+				{
+					const Int32 distance = glm::abs(pixels[i].w - palette[j]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex	 = j;
+					}
+				}
+				indexes |= UInt64(bestIndex) << (3 * i);
+			}
+		}
+		output[0] = UInt8(maxAlpha);
+		output[1] = UInt8(minAlpha);
+		for (Int32 i = 0; i < 6; ++i)
+		{
+			output[2 + i] = UInt8(indexes >> (8 * i));
+		}
+	}
+
+	void compress_level(const std::vector<UInt8>& pixels, const glm::ivec2& size, Int32 channels, ETextureFormat format, UInt8* output)
+	{
+		glm::ivec4 block[16];
+		for (Int32 blockY = 0; blockY < size.y; blockY += 4)
+		{
+			for (Int32 blockX = 0; blockX < size.x; blockX += 4)
+			{
+				// Pixels past edge repeat the last ones, they are never sampled
+				for (Int32 i = 0; i < 16; ++i)
+				{
+					const Int32 x = glm::min(blockX + i % 4, size.x - 1), y = glm::min(blockY + i / 4, size.y - 1);
+					const UInt8 *pixel = pixels.data() + (Int64(y) * size.x + x) * channels;
+					block[i] = { pixel[0], pixel[1], pixel[2], channels == 4 ? pixel[3] : 255 };
+				}
+				if (format == ETextureFormat::BC3)
+				{
+					encode_alpha_block(block, output);
+					output += 8;
+				}
+				encode_color_block(block, output);
+				output += 8;
+			}
+		}
+	}
+}
+
+bool TextureBake::open(const std::string& bakePath, UInt64 sourceHash)
+{
+	memory.clear();
+	file.close();
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(bakePath, error) || !file.open(bakePath))
+	{
+		return false;
+	}
+
+	bool isValid = file.get_size() >= Int64(sizeof(TextureBakeHeader));
+	if (isValid)
+	{
+		std::memcpy(&header, file.get_data(), sizeof(header));
+		isValid = header.magic == TEXTURE_BAKE_MAGIC && header.version == TEXTURE_BAKE_VERSION && header.sourceHash == sourceHash
+				  && header.levelsCount > 0 && header.levelsCount <= MAX_TEXTURE_LEVELS && header.size.x > 0 && header.size.y > 0;
+		for (Int32 i = 0; i < header.levelsCount && isValid; ++i)
+		{
+			isValid = header.levelSizes[i] == ::get_level_bytes(header.format, get_level_size(i)) && header.levelOffsets[i] >= Int64(sizeof(header))
+					  && header.levelOffsets[i] <= file.get_size() - header.levelSizes[i];
+		}
+	}
+	if (!isValid)
+	{
+		file.close();
+		header = TextureBakeHeader();
+	}
+	return isValid;
+}
+
+void TextureBake::bake(const UInt8* pixels, const glm::ivec2& size, Int32 channels, UInt64 sourceHash, bool isCompressed)
+{
+	file.close();
+	const Int32 bakedChannels = channels == 2 || channels == 4 ? 4 : 3;
+	header			  = TextureBakeHeader();
+	header.sourceHash = sourceHash;
+	header.size		  = size;
+	if (isCompressed)
+	{
+		header.format = bakedChannels == 4 ? ETextureFormat::BC3 : ETextureFormat::BC1;
+	} else {
+		header.format = bakedChannels == 4 ? ETextureFormat::RGBA8 : ETextureFormat::RGB8;
+	}
+
+	std::vector<UInt8> level(Int64(size.x) * size.y * bakedChannels);
+	for (Int64 i = 0; i < Int64(size.x) * size.y; ++i)
+	{
+		const UInt8 *pixel = pixels + i * channels;
+		UInt8 *bakedPixel  = level.data() + i * bakedChannels;
+		bakedPixel[0] = pixel[0];
+		bakedPixel[1] = channels >= 3 ? pixel[1] : pixel[0];
+		bakedPixel[2] = channels >= 3 ? pixel[2] : pixel[0];
+		if (bakedChannels == 4)
+		{
+			bakedPixel[3] = pixel[channels - 1];
+		}
+	}
+
+	// Levels until 1x1, offsets are known before any level is built
+	Int64 offset = sizeof(TextureBakeHeader);
+	for (glm::ivec2 levelSize = size; header.levelsCount < MAX_TEXTURE_LEVELS; levelSize = get_next_level_size(levelSize))
+	{
+		header.levelOffsets[header.levelsCount] = offset;
+		header.levelSizes[header.levelsCount]	= ::get_level_bytes(header.format, levelSize);
+		offset += header.levelSizes[header.levelsCount];
+		header.levelsCount++;
+		if (levelSize == glm::ivec2(1))
+		{
+			break;
+		}
+	}
+	memory.assign(offset, 0);
+	std::memcpy(memory.data(), &header, sizeof(header));
+
+	std::vector<UInt8> nextLevel;
+	for (Int32 i = 0; i < header.levelsCount; ++i)
+	{
+		const glm::ivec2 levelSize = get_level_size(i);
+		UInt8 *output = memory.data() + header.levelOffsets[i];
+		if (isCompressed)
+		{
+			compress_level(level, levelSize, bakedChannels, header.format, output);
+		} else {
+			std::memcpy(output, level.data(), level.size());
+		}
+		if (i + 1 < header.levelsCount)
+		{
+			downsample(level, levelSize, bakedChannels, nextLevel);
+			level.swap(nextLevel);
+		}
+	}
+}
+
+bool TextureBake::write(const std::string& bakePath) const
+{
+	// Written under temporary name, so other process never maps half written bake
+	const std::string temporaryPath = bakePath + ".tmp";
+	{
+		std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+		output.write(reinterpret_cast<const char*>(get_file_data()), get_bytes() + Int64(sizeof(TextureBakeHeader)));
+		if (!output)
+		{
+			SPDLOG_WARN("Failed to write texture bake: {}", bakePath);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, bakePath, error);
+	if (error)
+	{
+		SPDLOG_WARN("Failed to write texture bake: {}", bakePath);
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+ETextureFormat TextureBake::get_format() const
+{
+	return header.format;
+}
+
+Int32 TextureBake::get_levels_count() const
+{
+	return header.levelsCount;
+}
+
+glm::ivec2 TextureBake::get_level_size(Int32 level) const
+{
+	return glm::max(glm::ivec2(header.size.x >> level, header.size.y >> level), glm::ivec2(1));
+}
+
+const UInt8* TextureBake::get_level_data(Int32 level) const
+{
+	return get_file_data() + header.levelOffsets[level];
+}
+
+Int64 TextureBake::get_level_bytes(Int32 level) const
+{
+	return header.levelSizes[level];
+}
+
+Int64 TextureBake::get_bytes() const
+{
+	Int64 bytes = 0;
+	for (Int32 i = 0; i < header.levelsCount; ++i)
+	{
+		bytes += header.levelSizes[i];
+	}
+	return bytes;
+}
+
+UInt64 TextureBake::s_hash_file(const std::string& filePath)
+{
+	MappedFile source;
+	if (!source.open(filePath))
+	{
+		return 0;
+	}
+	// FNV-1a over 8 bytes at once, only equality of hashes matters
+	UInt64 hash = 14695981039346656037ULL;
+	const Int64 wordsCount = source.get_size() / 8;
+	for (Int64 i = 0; i < wordsCount; ++i)
+	{
+		UInt64 word;
+		std::memcpy(&word, source.get_data() + 8 * i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ULL;
+	}
+	for (Int64 i = 8 * wordsCount; i < source.get_size(); ++i)
+	{
+		hash = (hash ^ source.get_data()[i]) * 1099511628211ULL;
+	}
+	hash = (hash ^ UInt64(source.get_size())) * 1099511628211ULL;
+	return hash != 0 ? hash : 1;
+}
+
+std::string TextureBake::s_get_bake_path(const std::string& sourcePath)
+{
+	return sourcePath + ".ctex";
+}
+
+const UInt8* TextureBake::get_file_data() const
+{
+	return memory.empty() ? file.get_data() : memory.data();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "mapped_file.hpp"
+
+// Layout of baked texture levels, compressed formats are S3TC blocks of 4x4 pixels
+enum class ETextureFormat : Int8
+{
+	RGB8,
+	RGBA8,
+	BC1, // 8 bytes per block, opaque
+	BC3	 // 16 bytes per block, BC1 colour and interpolated alpha
+};
+
+/**
+ * Baked texture file: header, then every mip level down to 1x1 in format OpenGL uploads without conversion. Rows are
+ * in same order as in source image, like decoded images were uploaded. Bake is valid while hash of source file matches
+ */
+constexpr UInt32 TEXTURE_BAKE_MAGIC	  = 0x58455443; // "CTEX"
+constexpr UInt32 TEXTURE_BAKE_VERSION = 1;
+constexpr Int32 MAX_TEXTURE_LEVELS	  = 16;
+
+struct TextureBakeHeader
+{
+	UInt32 magic	   = TEXTURE_BAKE_MAGIC;
+	UInt32 version	   = TEXTURE_BAKE_VERSION;
+	UInt64 sourceHash  = 0;
+	glm::ivec2 size	   = { 0, 0 };
+	ETextureFormat format = ETextureFormat::RGBA8;
+	UInt8 padding[3]   = {};
+	Int32 levelsCount  = 0;
+	Int64 levelOffsets[MAX_TEXTURE_LEVELS] = {}; // From start of file
+	Int64 levelSizes[MAX_TEXTURE_LEVELS]   = {};
+};
+
+/** Texture with whole mip chain ready for upload, read from memory mapped bake file or baked from decoded image */
+class TextureBake
+{
+public:
+	TextureBake() = default;
+	TextureBake(TextureBake&) = delete;
+
+	// Maps bake file, fails without error if it doesn't exist or was baked from other source
+	bool open(const std::string& bakePath, UInt64 sourceHash);
+	// Image of 1 to 4 channels, one and two channel images are expanded to RGB and RGBA
+	void bake(const UInt8* pixels, const glm::ivec2& size, Int32 channels, UInt64 sourceHash, bool isCompressed);
+	bool write(const std::string& bakePath) const;
+
+	ETextureFormat get_format() const;
+	Int32 get_levels_count() const;
+	glm::ivec2 get_level_size(Int32 level) const;
+	const UInt8* get_level_data(Int32 level) const;
+	Int64 get_level_bytes(Int32 level) const;
+	// All levels, they are stored one after another
+	Int64 get_bytes() const;
+
+	// Zero if file can't be read
+	static UInt64 s_hash_file(const std::string& filePath);
+	static std::string s_get_bake_path(const std::string& sourcePath);
+
+private:
+	TextureBakeHeader header;
+	MappedFile file;
+	std::vector<UInt8> memory; // Whole file when texture was baked instead of opened
+
+	const UInt8* get_file_data() const;
+};
@@ -0,0 +1,124 @@
+#include "texture_loader.hpp"
+
+#include <stb_image.h>
+
+TextureLoader::~TextureLoader()
+{
+	shutdown();
+}
+
+void TextureLoader::startup(Int32 threadsCount)
+{
+	shutdown();
+	shouldStop = false;
+	threads.reserve(glm::max(threadsCount, 1));
+	for (Int32 i = 0; i < glm::max(threadsCount, 1); ++i)
+	{
+		threads.emplace_back(&TextureLoader::decode_loop, this);
+	}
+}
+
+void TextureLoader::shutdown()
+{
+	{
+		std::lock_guard lock(mutex);
+		shouldStop = true;
+		queued.clear();
+	}
+	condition.notify_all();
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	threads.clear();
+
+	decoded.clear();
+	pendingCount = 0;
+}
+
+void TextureLoader::load(Handle<Texture> texture, const std::string& filePath, bool isCompressed)
+{
+	{
+		std::lock_guard lock(mutex);
+		Image &image	   = queued.emplace_back();
+		image.texture	   = texture;
+		image.filePath	   = filePath;
+		image.isCompressed = isCompressed;
+		pendingCount++;
+	}
+	condition.notify_one();
+}
+
+bool TextureLoader::take_image(Image& image)
+{
+	std::lock_guard lock(mutex);
+	if (decoded.empty())
+	{
+		return false;
+	}
+	image = std::move(decoded.front());
+	decoded.pop_front();
+	pendingCount--;
+	return true;
+}
+
+Int32 TextureLoader::get_pending_count() const
+{
+	std::lock_guard lock(mutex);
+	return pendingCount;
+}
+
+void TextureLoader::decode_loop()
+{
+	while (true)
+	{
+		Image image;
+		{
+			std::unique_lock lock(mutex);
+			condition.wait(lock, [this]() { return shouldStop || !queued.empty(); });
+			if (shouldStop)
+			{
+				return;
+			}
+			image = std::move(queued.front());
+			queued.pop_front();
+		}
+
+		image.bake = s_load_bake(image.filePath, image.isCompressed);
+
+		std::lock_guard lock(mutex);
+		if (shouldStop)
+		{
+			return;
+		}
+		decoded.push_back(std::move(image));
+	}
+}
+
+std::unique_ptr<TextureBake> TextureLoader::s_load_bake(const std::string& filePath, bool isCompressed)
+{
+	const UInt64 sourceHash = TextureBake::s_hash_file(filePath);
+	if (sourceHash == 0)
+	{
+		return nullptr;
+	}
+	const std::string bakePath = TextureBake::s_get_bake_path(filePath);
+	auto bake = std::make_unique<TextureBake>();
+	if (bake->open(bakePath, sourceHash) && (bake->get_format() == ETextureFormat::BC1 || bake->get_format() == ETextureFormat::BC3) == isCompressed)
+	{
+		return bake;
+	}
+
+	glm::ivec2 size;
+	Int32 channels;
+	UInt8 *pixels = stbi_load(filePath.c_str(), &size.x, &size.y, &channels, 0);
+	if (!pixels)
+	{
+		return nullptr;
+	}
+	bake->bake(pixels, size, channels, sourceHash, isCompressed);
+	stbi_image_free(pixels);
+	// Texture is usable from memory even if bake can't be saved, e.g. in read only directory
+	bake->write(bakePath);
+	return bake;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
+#include "handle.hpp"
+#include "texture_bake.hpp"
+
+struct Texture;
+
+/**
+ * Loads image files on background threads, decoded images wait until owner takes them on its thread. Image is read
+ * from bake next to it when its source didn't change, otherwise it is decoded and bake is written for next time
+ */
+class TextureLoader
+{
+public:
+	struct Image
+	{
+		Handle<Texture> texture = Handle<Texture>::sNone;
+		std::string filePath;
+		bool isCompressed = false;
+		std::unique_ptr<TextureBake> bake; // Null when loading failed
+	};
+
+	TextureLoader() = default;
+	TextureLoader(TextureLoader&) = delete;
+	~TextureLoader();
+
+	// Restarts loader if it was already running, queued and decoded images are dropped
+	void startup(Int32 threadsCount);
+	void shutdown();
+
+	// Compressed images are baked in BC1 or BC3
+	void load(Handle<Texture> texture, const std::string& filePath, bool isCompressed);
+	// Takes image decoded first, returns false if none is decoded yet. Never waits for decoding
+	bool take_image(Image& image);
+	// Queued, decoding and decoded images that weren't taken yet
+	Int32 get_pending_count() const;
+
+private:
+	std::vector<std::thread> threads;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Image> queued;
+	std::deque<Image> decoded;
+	Int32 pendingCount = 0;
+	bool shouldStop	   = false;
+
+	void decode_loop();
+	static std::unique_ptr<TextureBake> s_load_bake(const std::string& filePath, bool isCompressed);
+};
@@ -0,0 +1,132 @@
+#include "worker_pool.hpp"
+
+// How many times idle thread checks for new work before it goes to sleep
+constexpr Int32 SPIN_COUNT = 4096;
+
+WorkerPool::~WorkerPool()
+{
+	shutdown();
+}
+
+void WorkerPool::startup(Int32 threadsCount)
+{
+	shutdown();
+	this->threadsCount = glm::max(threadsCount, 1);
+	shouldStop = false;
+
+	workers.reserve(this->threadsCount - 1);
+	for (Int32 i = 1; i < this->threadsCount; ++i)
+	{
+		workers.emplace_back(&WorkerPool::worker_loop, this, i);
+	}
+}
+
+Int32 WorkerPool::get_threads_count() const
+{
+	return threadsCount;
+}
+
+Int32 WorkerPool::s_get_hardware_threads_count()
+{
+	return glm::max(Int32(std::thread::hardware_concurrency()), 1);
+}
+
+void WorkerPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shouldStop = true;
+	}
+	wakeUpCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	threadsCount = 1;
+}
+
+void WorkerPool::dispatch(Int32 count, Int32 minChunkSize, const void* function, Invoker functionInvoker)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	const Int32 minChunk = glm::max(minChunkSize, 1);
+	if (workers.empty() || count <= minChunk)
+	{
+		functionInvoker(function, 0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task	  = function;
+		invoker	  = functionInvoker;
+		taskCount = count;
+		// Few chunks per thread, so faster threads can take over work of slower ones
+		chunkSize = glm::max(count / (threadsCount * 4), minChunk);
+		nextChunk.store(0, std::memory_order_relaxed);
+		activeWorkers.store(Int32(workers.size()), std::memory_order_relaxed);
+		generation.fetch_add(1, std::memory_order_release);
+	}
+	wakeUpCondition.notify_all();
+
+	run_chunks(0);
+
+	for (Int32 i = 0; i < SPIN_COUNT && activeWorkers.load(std::memory_order_acquire) != 0; ++i)
+	{
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finishedCondition.wait(lock, [this]() { return activeWorkers.load(std::memory_order_acquire) == 0; });
+}
+
+void WorkerPool::run_chunks(Int32 threadIndex)
+{
+	while (true)
+	{
+		const Int32 begin = nextChunk.fetch_add(chunkSize, std::memory_order_relaxed);
+		if (begin >= taskCount)
+		{
+			return;
+		}
+		invoker(task, begin, glm::min(begin + chunkSize, taskCount), threadIndex);
+	}
+}
+
+void WorkerPool::worker_loop(Int32 threadIndex)
+{
+	UInt64 seenGeneration = 0;
+	while (true)
+	{
+		for (Int32 i = 0; i < SPIN_COUNT && generation.load(std::memory_order_acquire) == seenGeneration; ++i)
+		{
+			std::this_thread::yield();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUpCondition.wait(lock, [&]()
+			{
+				return shouldStop || generation.load(std::memory_order_acquire) != seenGeneration;
+			});
+			if (shouldStop)
+			{
+				return;
+			}
+			seenGeneration = generation.load(std::memory_order_acquire);
+		}
+
+		run_chunks(threadIndex);
+
+		if (activeWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finishedCondition.notify_one();
+		}
+	}
+}
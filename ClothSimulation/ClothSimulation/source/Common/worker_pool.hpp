@@ -0,0 +1,54 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/** Persistent threads that split index ranges between them, calling thread works as worker 0 */
+class WorkerPool
+{
+public:
+	WorkerPool() = default;
+	WorkerPool(WorkerPool&) = delete;
+	~WorkerPool();
+
+	// Count of threads includes calling thread, restarts pool if it was already running
+	void startup(Int32 threadsCount);
+
+	// Calls function(begin, end, threadIndex) for chunks of [0, count) and waits until all chunks are done
+	template<typename Function>
+	void parallel_for(Int32 count, Int32 minChunkSize, const Function& function)
+	{
+		dispatch(count, minChunkSize, &function, [](const void* function, Int32 begin, Int32 end, Int32 threadIndex)
+		{
+			(*static_cast<const Function*>(function))(begin, end, threadIndex);
+		});
+	}
+
+	Int32 get_threads_count() const;
+	static Int32 s_get_hardware_threads_count();
+
+	void shutdown();
+
+private:
+	using Invoker = void(*)(const void* function, Int32 begin, Int32 end, Int32 threadIndex);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeUpCondition;
+	std::condition_variable finishedCondition;
+
+	const void* task = nullptr;
+	Invoker invoker  = nullptr;
+	Int32 taskCount  = 0;
+	Int32 chunkSize  = 1;
+	std::atomic<Int32>  nextChunk{ 0 };
+	std::atomic<Int32>  activeWorkers{ 0 };
+	std::atomic<UInt64> generation{ 0 };
+	bool shouldStop	   = false;
+	Int32 threadsCount = 1;
+
+	void dispatch(Int32 count, Int32 minChunkSize, const void* function, Invoker functionInvoker);
+	void run_chunks(Int32 threadIndex);
+	void worker_loop(Int32 threadIndex);
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+/**
+ * Baked cloth animation file: header, vertex count of every cloth, then frames of equal size, so frame i is found
+ * without index. Frame is its header followed by positions and normals of cloth 0, then of cloth 1 and so on.
+ * Raw frames store vec3s exactly like OpenGL buffers of meshes expect them, quantized ones store positions as
+ * 16 bit fractions of frame bounds and normals octahedral encoded in two 16 bit values
+ */
+constexpr UInt32 BAKE_MAGIC	  = 0x4B424C43; // "CLBK"
+constexpr UInt32 BAKE_VERSION = 1;
+constexpr UInt32 BAKE_FLAG_QUANTIZED = 1 << 0;
+// Data of every frame starts at multiple of it, raw frames can be read from mapped file as vec3 arrays
+constexpr Int64 BAKE_ALIGNMENT = 64;
+
+struct BakeHeader
+{
+	UInt32 magic	   = BAKE_MAGIC;
+	UInt32 version	   = BAKE_VERSION;
+	UInt32 flags	   = 0;
+	Int32 clothsCount  = 0;
+	Int64 framesCount  = 0; // Written when recording ends
+	Int64 frameSize	   = 0; // Bytes, multiple of BAKE_ALIGNMENT
+	Int64 framesOffset = 0; // First frame, vertex counts of cloths are between header and it
+	UInt8 reserved[24] = {};
+};
+static_assert(sizeof(BakeHeader) == BAKE_ALIGNMENT);
+
+struct BakeFrameHeader
+{
+	Float32 time = 0.0f; // Seconds since recording started
+	Float32 padding = 0.0f;
+	glm::vec3 boundsMin	 = glm::vec3(0.0f);
+	glm::vec3 boundsSize = glm::vec3(0.0f); // Quantized positions are fractions of it
+};
+static_assert(sizeof(BakeFrameHeader) == 32);
+
+struct QuantizedVertex
+{
+	UInt16 position[3];
+	Int16 normal[2];
+};
+static_assert(sizeof(QuantizedVertex) == 10);
+
+inline Int64 get_bake_vertex_size(UInt32 flags)
+{
+	return (flags & BAKE_FLAG_QUANTIZED) ? Int64(sizeof(QuantizedVertex)) : Int64(2 * sizeof(glm::vec3));
+}
+
+inline Int64 align_bake_size(Int64 size)
+{
+	return (size + BAKE_ALIGNMENT - 1) / BAKE_ALIGNMENT * BAKE_ALIGNMENT;
+}
+
+// Octahedral normal encoding, Cigolle et al. - Survey of Efficient Representations for Independent Unit Vectors
+inline void encode_normal(const glm::vec3& normal, Int16 encoded[2])
+{
+	const Float32 length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+	glm::vec2 octahedral = length > 0.0f ? glm::vec2(normal.x, normal.y) / length : glm::vec2(0.0f);
+	if (normal.z < 0.0f)
+	{
+		const glm::vec2 folded = glm::vec2(1.0f) - glm::abs(glm::vec2(octahedral.y, octahedral.x));
+		octahedral = { octahedral.x >= 0.0f ? folded.x : -folded.x, octahedral.y >= 0.0f ? folded.y : -folded.y };
+	}
+	encoded[0] = Int16(glm::round(glm::clamp(octahedral.x, -1.0f, 1.0f) * 32767.0f));
+	encoded[1] = Int16(glm::round(glm::clamp(octahedral.y, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline glm::vec3 decode_normal(const Int16 encoded[2])
+{
+	glm::vec3 normal(Float32(encoded[0]) / 32767.0f, Float32(encoded[1]) / 32767.0f, 0.0f);
+	normal.z = 1.0f - glm::abs(normal.x) - glm::abs(normal.y);
+	const Float32 fold = glm::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	const Float32 length = glm::length(normal);
+	return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
@@ -0,0 +1,166 @@
+#include "bake_player.hpp"
+
+#include <algorithm>
+
+#include "../Common/mesh.hpp"
+
+bool BakePlayer::open(const std::string& filePath)
+{
+	close();
+	if (!file.open(filePath))
+	{
+		return false;
+	}
+
+	const Int64 fileSize = file.get_size();
+	if (fileSize < Int64(sizeof(BakeHeader)))
+	{
+		SPDLOG_ERROR("File is too small for bake: {}", filePath);
+		close();
+		return false;
+	}
+	std::memcpy(&header, file.get_data(), sizeof(header));
+	if (header.magic != BAKE_MAGIC || header.version != BAKE_VERSION)
+	{
+		SPDLOG_ERROR("File is not bake of supported version: {}", filePath);
+		close();
+		return false;
+	}
+
+	// Every size is checked against file, so corrupted or unfinished file can't make reads go past mapping
+	const Int64 countsEnd = Int64(sizeof(BakeHeader)) + Int64(header.clothsCount) * Int64(sizeof(Int64));
+	bool isValid = header.clothsCount > 0 && countsEnd <= header.framesOffset && header.framesOffset % BAKE_ALIGNMENT == 0
+				   && header.frameSize > 0 && header.frameSize % BAKE_ALIGNMENT == 0 && header.framesCount >= 0
+				   && header.framesOffset <= fileSize
+				   && header.framesCount <= (fileSize - header.framesOffset) / header.frameSize;
+	Int64 verticesCount = 0;
+	if (isValid)
+	{
+		vertexOffsets.resize(header.clothsCount + 1);
+		vertexOffsets[0] = 0;
+		for (Int32 i = 0; i < header.clothsCount && isValid; ++i)
+		{
+			Int64 count = 0;
+			std::memcpy(&count, file.get_data() + sizeof(BakeHeader) + i * sizeof(Int64), sizeof(Int64));
+			isValid = count >= 0 && count <= header.frameSize - verticesCount;
+			verticesCount += count;
+			vertexOffsets[i + 1] = verticesCount;
+		}
+		isValid = isValid && Int64(sizeof(BakeFrameHeader)) + verticesCount * get_bake_vertex_size(header.flags) <= header.frameSize;
+	}
+	if (!isValid || header.framesCount == 0)
+	{
+		SPDLOG_ERROR("Bake file is corrupted or has no frames: {}", filePath);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void BakePlayer::close()
+{
+	file.close();
+	header = BakeHeader();
+	vertexOffsets.clear();
+}
+
+bool BakePlayer::is_open() const
+{
+	return file.is_open();
+}
+
+bool BakePlayer::is_quantized() const
+{
+	return header.flags & BAKE_FLAG_QUANTIZED;
+}
+
+Int32 BakePlayer::get_cloths_count() const
+{
+	return header.clothsCount;
+}
+
+Int64 BakePlayer::get_vertices_count(Int32 cloth) const
+{
+	return vertexOffsets[cloth + 1] - vertexOffsets[cloth];
+}
+
+Int64 BakePlayer::get_frames_count() const
+{
+	return header.framesCount;
+}
+
+Float32 BakePlayer::get_frame_time(Int64 frame) const
+{
+	return get_frame_header(frame).time;
+}
+
+Int64 BakePlayer::find_frame(Float32 time) const
+{
+	// Frame times only grow, so binary search over frame headers touches few pages of mapping
+	Int64 first = 0, last = header.framesCount;
+	while (first < last)
+	{
+		const Int64 middle = first + (last - first) / 2;
+		if (get_frame_time(middle) <= time)
+		{
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	return glm::max(first - 1, Int64(0));
+}
+
+const glm::vec3* BakePlayer::get_positions(Int64 frame, Int32 cloth) const
+{
+	return reinterpret_cast<const glm::vec3*>(get_frame_vertices(frame)) + 2 * vertexOffsets[cloth];
+}
+
+const glm::vec3* BakePlayer::get_normals(Int64 frame, Int32 cloth) const
+{
+	return get_positions(frame, cloth) + get_vertices_count(cloth);
+}
+
+void BakePlayer::decode_frame(Int64 frame, const std::vector<Mesh*>& meshes) const
+{
+	const Int32 clothsCount = glm::min(Int32(meshes.size()), header.clothsCount);
+	if (!is_quantized())
+	{
+		for (Int32 i = 0; i < clothsCount; ++i)
+		{
+			const Int64 size = get_vertices_count(i) * sizeof(glm::vec3);
+			meshes[i]->positions.resize(get_vertices_count(i));
+			meshes[i]->normals.resize(get_vertices_count(i));
+			std::memcpy(meshes[i]->positions.data(), get_positions(frame, i), size);
+			std::memcpy(meshes[i]->normals.data(), get_normals(frame, i), size);
+		}
+		return;
+	}
+
+	const BakeFrameHeader &frameHeader = get_frame_header(frame);
+	const glm::vec3 scale = frameHeader.boundsSize / 65535.0f;
+	const QuantizedVertex *vertices = reinterpret_cast<const QuantizedVertex*>(get_frame_vertices(frame));
+	for (Int32 i = 0; i < clothsCount; ++i)
+	{
+		Mesh &mesh = *meshes[i];
+		mesh.positions.resize(get_vertices_count(i));
+		mesh.normals.resize(get_vertices_count(i));
+		const QuantizedVertex *quantized = vertices + vertexOffsets[i];
+		for (Int64 j = 0; j < Int64(mesh.positions.size()); ++j, ++quantized)
+		{
+			const glm::vec3 fraction(quantized->position[0], quantized->position[1], quantized->position[2]);
+			mesh.positions[j] = frameHeader.boundsMin + fraction * scale;
+			mesh.normals[j]	  = decode_normal(quantized->normal);
+		}
+	}
+}
+
+const BakeFrameHeader& BakePlayer::get_frame_header(Int64 frame) const
+{
+	return *reinterpret_cast<const BakeFrameHeader*>(file.get_data() + header.framesOffset + frame * header.frameSize);
+}
+
+const UInt8* BakePlayer::get_frame_vertices(Int64 frame) const
+{
+	return file.get_data() + header.framesOffset + frame * header.frameSize + sizeof(BakeFrameHeader);
+}
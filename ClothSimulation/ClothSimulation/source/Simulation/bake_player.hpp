@@ -0,0 +1,36 @@
+#pragma once
+#include "../Common/mapped_file.hpp"
+#include "bake_format.hpp"
+
+struct Mesh;
+
+/** Reads frames of bake file straight from memory mapped file, solver isn't needed for playback */
+class BakePlayer
+{
+public:
+	bool open(const std::string& filePath);
+	void close();
+
+	bool is_open() const;
+	bool is_quantized() const;
+	Int32 get_cloths_count() const;
+	Int64 get_vertices_count(Int32 cloth) const;
+	Int64 get_frames_count() const;
+	Float32 get_frame_time(Int64 frame) const;
+	// Last frame recorded at or before time, first frame for earlier times
+	Int64 find_frame(Float32 time) const;
+
+	// Raw files only, arrays of get_vertices_count(cloth) vec3s inside of mapped file
+	const glm::vec3* get_positions(Int64 frame, Int32 cloth) const;
+	const glm::vec3* get_normals(Int64 frame, Int32 cloth) const;
+	// Any file, writes positions and normals of frame into meshes of matching layout
+	void decode_frame(Int64 frame, const std::vector<Mesh*>& meshes) const;
+
+private:
+	MappedFile file;
+	BakeHeader header;
+	std::vector<Int64> vertexOffsets; // Vertices of cloth i are [vertexOffsets[i], vertexOffsets[i + 1]) in every frame
+
+	const BakeFrameHeader& get_frame_header(Int64 frame) const;
+	const UInt8* get_frame_vertices(Int64 frame) const;
+};
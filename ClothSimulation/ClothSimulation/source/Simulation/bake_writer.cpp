@@ -0,0 +1,232 @@
+#include "bake_writer.hpp"
+
+#include "../Common/mesh.hpp"
+
+BakeWriter::~BakeWriter()
+{
+	close();
+}
+
+bool BakeWriter::open(const std::string& filePath, const std::vector<Mesh*>& meshes, bool isQuantized, Int32 framesPerChunk)
+{
+	close();
+	if (meshes.empty())
+	{
+		SPDLOG_ERROR("Nothing to bake, there are no meshes.");
+		return false;
+	}
+
+	header = BakeHeader();
+	header.flags	   = isQuantized ? BAKE_FLAG_QUANTIZED : 0;
+	header.clothsCount = Int32(meshes.size());
+	vertexCounts.clear();
+	Int64 verticesCount = 0;
+	for (const Mesh *mesh : meshes)
+	{
+		vertexCounts.emplace_back(Int64(mesh->positions.size()));
+		verticesCount += vertexCounts.back();
+	}
+	header.frameSize	= align_bake_size(Int64(sizeof(BakeFrameHeader)) + verticesCount * get_bake_vertex_size(header.flags));
+	header.framesOffset = align_bake_size(Int64(sizeof(BakeHeader)) + Int64(vertexCounts.size() * sizeof(Int64)));
+
+	file.open(filePath, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		SPDLOG_ERROR("Failed to open bake file for writing: {}", filePath);
+		return false;
+	}
+	const std::vector<UInt8> padding(header.framesOffset - sizeof(BakeHeader) - vertexCounts.size() * sizeof(Int64), 0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(vertexCounts.data()), vertexCounts.size() * sizeof(Int64));
+	file.write(reinterpret_cast<const char*>(padding.data()), padding.size());
+
+	this->framesPerChunk = glm::max(framesPerChunk, 1);
+	for (Chunk &chunk : chunks)
+	{
+		chunk.data.assign(this->framesPerChunk * header.frameSize, 0);
+		chunk.framesCount = 0;
+	}
+	fillingChunk = 0;
+	pendingChunk = nullptr;
+	shouldStop	 = false;
+	isFailed	 = !file;
+	statistics	 = Statistics();
+	statistics.bytes = header.framesOffset;
+	isOpen = true;
+
+	writingThread = std::thread(&BakeWriter::writer_loop, this);
+	return true;
+}
+
+void BakeWriter::add_frame(Float32 time, const std::vector<Mesh*>& meshes)
+{
+	if (!is_open())
+	{
+		return;
+	}
+	if (meshes.size() != vertexCounts.size())
+	{
+		SPDLOG_ERROR("Baked frame has {} meshes, recording has {}.", meshes.size(), vertexCounts.size());
+		return;
+	}
+	for (Int32 i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i]->positions.size() != vertexCounts[i] || meshes[i]->normals.size() != vertexCounts[i])
+		{
+			SPDLOG_ERROR("Baked mesh {} changed its vertex count.", i);
+			return;
+		}
+	}
+
+	if (statistics.frames == 0)
+	{
+		firstTime = time;
+	}
+	Chunk &chunk = chunks[fillingChunk];
+	encode_frame(chunk.data.data() + chunk.framesCount * header.frameSize, time - firstTime, meshes);
+	chunk.framesCount++;
+	statistics.frames++;
+	if (chunk.framesCount == framesPerChunk)
+	{
+		submit_chunk();
+	}
+}
+
+bool BakeWriter::close()
+{
+	if (!is_open())
+	{
+		return true;
+	}
+
+	if (chunks[fillingChunk].framesCount > 0)
+	{
+		submit_chunk();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shouldStop = true;
+	}
+	condition.notify_all();
+	writingThread.join();
+	isOpen = false;
+
+	header.framesCount = statistics.frames;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	const bool isWritten = !isFailed && bool(file);
+	file.close();
+	if (!isWritten)
+	{
+		SPDLOG_ERROR("Failed to write bake file, recording is incomplete.");
+	}
+
+	for (Chunk &chunk : chunks)
+	{
+		chunk.data.clear();
+		chunk.data.shrink_to_fit();
+	}
+	return isWritten;
+}
+
+bool BakeWriter::is_open() const
+{
+	return isOpen;
+}
+
+const BakeWriter::Statistics& BakeWriter::get_statistics() const
+{
+	return statistics;
+}
+
+void BakeWriter::encode_frame(UInt8* frame, Float32 time, const std::vector<Mesh*>& meshes) const
+{
+	BakeFrameHeader frameHeader;
+	frameHeader.time = time;
+	glm::vec3 boundsMin(std::numeric_limits<Float32>::max()), boundsMax(-std::numeric_limits<Float32>::max());
+	for (const Mesh *mesh : meshes)
+	{
+		for (const glm::vec3 &position : mesh->positions)
+		{
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+	}
+	frameHeader.boundsMin  = boundsMin;
+	frameHeader.boundsSize = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+	std::memcpy(frame, &frameHeader, sizeof(frameHeader));
+
+	UInt8 *vertices = frame + sizeof(BakeFrameHeader);
+	if (!(header.flags & BAKE_FLAG_QUANTIZED))
+	{
+		for (const Mesh *mesh : meshes)
+		{
+			const Int64 size = Int64(mesh->positions.size() * sizeof(glm::vec3));
+			std::memcpy(vertices, mesh->positions.data(), size);
+			std::memcpy(vertices + size, mesh->normals.data(), size);
+			vertices += 2 * size;
+		}
+		return;
+	}
+
+	// Flat axes keep zero size, their positions are all stored as zero fraction
+	glm::vec3 scale(0.0f);
+	for (Int32 c = 0; c < 3; ++c)
+	{
+		scale[c] = frameHeader.boundsSize[c] > 0.0f ? 65535.0f / frameHeader.boundsSize[c] : 0.0f;
+	}
+	QuantizedVertex *quantized = reinterpret_cast<QuantizedVertex*>(vertices);
+	for (const Mesh *mesh : meshes)
+	{
+		for (Int64 i = 0; i < Int64(mesh->positions.size()); ++i, ++quantized)
+		{
+			const glm::vec3 fraction = glm::clamp((mesh->positions[i] - boundsMin) * scale, glm::vec3(0.0f), glm::vec3(65535.0f));
+			quantized->position[0] = UInt16(fraction.x + 0.5f);
+			quantized->position[1] = UInt16(fraction.y + 0.5f);
+			quantized->position[2] = UInt16(fraction.z + 0.5f);
+			encode_normal(mesh->normals[i], quantized->normal);
+		}
+	}
+}
+
+void BakeWriter::submit_chunk()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (pendingChunk)
+		{
+			statistics.stalls++;
+			condition.wait(lock, [this]() { return pendingChunk == nullptr; });
+		}
+		pendingChunk = &chunks[fillingChunk];
+	}
+	condition.notify_all();
+	statistics.bytes += chunks[fillingChunk].framesCount * header.frameSize;
+
+	// Other chunk was written before writer became idle, so it is free to fill
+	fillingChunk = 1 - fillingChunk;
+	chunks[fillingChunk].framesCount = 0;
+}
+
+void BakeWriter::writer_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		condition.wait(lock, [this]() { return pendingChunk != nullptr || shouldStop; });
+		if (!pendingChunk)
+		{
+			return;
+		}
+
+		const Chunk *chunk = pendingChunk;
+		lock.unlock();
+		file.write(reinterpret_cast<const char*>(chunk->data.data()), chunk->framesCount * header.frameSize);
+		const bool isWritten = bool(file);
+		lock.lock();
+
+		isFailed	|= !isWritten;
+		pendingChunk = nullptr;
+		condition.notify_all();
+	}
+}
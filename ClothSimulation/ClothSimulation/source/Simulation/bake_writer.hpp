@@ -0,0 +1,67 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+
+#include "bake_format.hpp"
+
+struct Mesh;
+
+/**
+ * Records mesh positions and normals into bake file. Frames are encoded into one of two chunks while background thread
+ * writes the other, so calling thread waits only when disk is slower than simulation for whole chunk
+ */
+class BakeWriter
+{
+public:
+	struct Statistics
+	{
+		Int64 frames = 0;
+		Int64 bytes	 = 0;
+		Int64 stalls = 0; // Times add_frame waited for writing thread
+	};
+
+	BakeWriter() = default;
+	BakeWriter(BakeWriter&) = delete;
+	~BakeWriter();
+
+	// Layout of meshes is fixed for whole recording, every frame must have same vertex counts. Frame times are stored
+	// relative to time of first frame
+	bool open(const std::string& filePath, const std::vector<Mesh*>& meshes, bool isQuantized, Int32 framesPerChunk = 16);
+	void add_frame(Float32 time, const std::vector<Mesh*>& meshes);
+	// Writes remaining frames and frames count, returns false if any write failed
+	bool close();
+
+	bool is_open() const;
+	const Statistics& get_statistics() const;
+
+private:
+	struct Chunk
+	{
+		std::vector<UInt8> data;
+		Int64 framesCount = 0;
+	};
+
+	std::ofstream file;
+	BakeHeader header;
+	std::vector<Int64> vertexCounts;
+	Int32 framesPerChunk = 16;
+	Float32 firstTime = 0.0f;
+	Statistics statistics;
+
+	Chunk chunks[2];
+	Int32 fillingChunk = 0;
+	std::thread writingThread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	Chunk* pendingChunk = nullptr; // Handed to writing thread, null when it is idle
+	bool shouldStop	 = false;
+	bool isFailed	 = false;
+	// Set and read by calling thread only, file itself belongs to writing thread while it runs
+	bool isOpen = false;
+
+	void encode_frame(UInt8* frame, Float32 time, const std::vector<Mesh*>& meshes) const;
+	void submit_chunk();
+	void writer_loop();
+};
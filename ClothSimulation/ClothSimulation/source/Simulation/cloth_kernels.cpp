@@ -0,0 +1,273 @@
+#include "cloth_kernels.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define CLOTH_KERNELS_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define TARGET_SSE
+		#define TARGET_AVX2
+	#else
+		#define TARGET_SSE	__attribute__((target("sse2")))
+		#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#endif
+#else
+	#define CLOTH_KERNELS_X86 0
+#endif
+
+namespace
+{
+	void accumulate_springs_scalar(const ClothView& view, Int32 begin, Int32 end)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 indexA = view.springIndexesA[i];
+			const Int32 indexB = view.springIndexesB[i];
+
+			const Float32 lx = view.positionsX[indexB] - view.positionsX[indexA];
+			const Float32 ly = view.positionsY[indexB] - view.positionsY[indexA];
+			const Float32 lz = view.positionsZ[indexB] - view.positionsZ[indexA];
+			const Float32 length2 = lx * lx + ly * ly + lz * lz;
+			if (length2 <= glm::epsilon<Float32>())
+			{
+				continue;
+			}
+
+			// k * (l - restLength * l / |l|)
+			const Float32 scale = view.stiffnesses[i] * (1.0f - view.restLengths[i] / std::sqrt(length2));
+			view.forcesX[indexA] += scale * lx;
+			view.forcesY[indexA] += scale * ly;
+			view.forcesZ[indexA] += scale * lz;
+			view.forcesX[indexB] -= scale * lx;
+			view.forcesY[indexB] -= scale * ly;
+			view.forcesZ[indexB] -= scale * lz;
+		}
+	}
+
+	void integrate_scalar(const ClothView& view, Float32 deltaTime, Int32 begin, Int32 end)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Float32 inverseMass = view.inverseMasses[i];
+			view.velocitiesX[i] += view.forcesX[i] * inverseMass * deltaTime;
+			view.velocitiesY[i] += view.forcesY[i] * inverseMass * deltaTime;
+			view.velocitiesZ[i] += view.forcesZ[i] * inverseMass * deltaTime;
+			view.positionsX[i]  += view.velocitiesX[i] * deltaTime;
+			view.positionsY[i]  += view.velocitiesY[i] * deltaTime;
+			view.positionsZ[i]  += view.velocitiesZ[i] * deltaTime;
+		}
+	}
+
+#if CLOTH_KERNELS_X86
+	TARGET_SSE
+	void accumulate_springs_sse(const ClothView& view, Int32 begin, Int32 end)
+	{
+		const __m128 epsilon = _mm_set1_ps(glm::epsilon<Float32>());
+		const __m128 one	 = _mm_set1_ps(1.0f);
+		alignas(16) Float32 forcesX[4], forcesY[4], forcesZ[4];
+
+		Int32 i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const Int32 *indexesA = view.springIndexesA + i;
+			const Int32 *indexesB = view.springIndexesB + i;
+
+			const __m128 ax = _mm_set_ps(view.positionsX[indexesA[3]], view.positionsX[indexesA[2]], view.positionsX[indexesA[1]], view.positionsX[indexesA[0]]);
+			const __m128 ay = _mm_set_ps(view.positionsY[indexesA[3]], view.positionsY[indexesA[2]], view.positionsY[indexesA[1]], view.positionsY[indexesA[0]]);
+			const __m128 az = _mm_set_ps(view.positionsZ[indexesA[3]], view.positionsZ[indexesA[2]], view.positionsZ[indexesA[1]], view.positionsZ[indexesA[0]]);
+			const __m128 bx = _mm_set_ps(view.positionsX[indexesB[3]], view.positionsX[indexesB[2]], view.positionsX[indexesB[1]], view.positionsX[indexesB[0]]);
+			const __m128 by = _mm_set_ps(view.positionsY[indexesB[3]], view.positionsY[indexesB[2]], view.positionsY[indexesB[1]], view.positionsY[indexesB[0]]);
+			const __m128 bz = _mm_set_ps(view.positionsZ[indexesB[3]], view.positionsZ[indexesB[2]], view.positionsZ[indexesB[1]], view.positionsZ[indexesB[0]]);
+
+			const __m128 lx = _mm_sub_ps(bx, ax);
+			const __m128 ly = _mm_sub_ps(by, ay);
+			const __m128 lz = _mm_sub_ps(bz, az);
+			const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)), _mm_mul_ps(lz, lz));
+			const __m128 valid	 = _mm_cmpgt_ps(length2, epsilon);
+			const __m128 length	 = _mm_sqrt_ps(_mm_max_ps(length2, epsilon));
+
+			const __m128 restRatio = _mm_div_ps(_mm_loadu_ps(view.restLengths + i), length);
+			__m128 scale = _mm_mul_ps(_mm_loadu_ps(view.stiffnesses + i), _mm_sub_ps(one, restRatio));
+			scale = _mm_and_ps(scale, valid);
+
+			_mm_store_ps(forcesX, _mm_mul_ps(scale, lx));
+			_mm_store_ps(forcesY, _mm_mul_ps(scale, ly));
+			_mm_store_ps(forcesZ, _mm_mul_ps(scale, lz));
+
+			// There are no gather/scatter in SSE, springs in batch don't share points so order doesn't matter
+			for (Int32 lane = 0; lane < 4; ++lane)
+			{
+				view.forcesX[indexesA[lane]] += forcesX[lane];
+				view.forcesY[indexesA[lane]] += forcesY[lane];
+				view.forcesZ[indexesA[lane]] += forcesZ[lane];
+				view.forcesX[indexesB[lane]] -= forcesX[lane];
+				view.forcesY[indexesB[lane]] -= forcesY[lane];
+				view.forcesZ[indexesB[lane]] -= forcesZ[lane];
+			}
+		}
+
+		accumulate_springs_scalar(view, i, end);
+	}
+
+	TARGET_SSE
+	void integrate_sse(const ClothView& view, Float32 deltaTime, Int32 begin, Int32 end)
+	{
+		const __m128 dt = _mm_set1_ps(deltaTime);
+
+		for (Int32 i = begin; i < end; i += 4)
+		{
+			const __m128 inverseMass = _mm_load_ps(view.inverseMasses + i);
+			const __m128 step		 = _mm_mul_ps(inverseMass, dt);
+
+			__m128 vx = _mm_add_ps(_mm_load_ps(view.velocitiesX + i), _mm_mul_ps(_mm_load_ps(view.forcesX + i), step));
+			__m128 vy = _mm_add_ps(_mm_load_ps(view.velocitiesY + i), _mm_mul_ps(_mm_load_ps(view.forcesY + i), step));
+			__m128 vz = _mm_add_ps(_mm_load_ps(view.velocitiesZ + i), _mm_mul_ps(_mm_load_ps(view.forcesZ + i), step));
+			__m128 px = _mm_add_ps(_mm_load_ps(view.positionsX + i), _mm_mul_ps(vx, dt));
+			__m128 py = _mm_add_ps(_mm_load_ps(view.positionsY + i), _mm_mul_ps(vy, dt));
+			__m128 pz = _mm_add_ps(_mm_load_ps(view.positionsZ + i), _mm_mul_ps(vz, dt));
+
+			_mm_store_ps(view.velocitiesX + i, vx);
+			_mm_store_ps(view.velocitiesY + i, vy);
+			_mm_store_ps(view.velocitiesZ + i, vz);
+			_mm_store_ps(view.positionsX + i, px);
+			_mm_store_ps(view.positionsY + i, py);
+			_mm_store_ps(view.positionsZ + i, pz);
+		}
+	}
+
+	TARGET_AVX2
+	void accumulate_springs_avx2(const ClothView& view, Int32 begin, Int32 end)
+	{
+		const __m256 epsilon = _mm256_set1_ps(glm::epsilon<Float32>());
+		const __m256 one	 = _mm256_set1_ps(1.0f);
+		alignas(32) Float32 forcesX[8], forcesY[8], forcesZ[8];
+
+		Int32 i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const Int32 *indexesA = view.springIndexesA + i;
+			const Int32 *indexesB = view.springIndexesB + i;
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indexesA));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indexesB));
+
+			const __m256 lx = _mm256_sub_ps(_mm256_i32gather_ps(view.positionsX, b, 4), _mm256_i32gather_ps(view.positionsX, a, 4));
+			const __m256 ly = _mm256_sub_ps(_mm256_i32gather_ps(view.positionsY, b, 4), _mm256_i32gather_ps(view.positionsY, a, 4));
+			const __m256 lz = _mm256_sub_ps(_mm256_i32gather_ps(view.positionsZ, b, 4), _mm256_i32gather_ps(view.positionsZ, a, 4));
+			const __m256 length2 = _mm256_fmadd_ps(lz, lz, _mm256_fmadd_ps(ly, ly, _mm256_mul_ps(lx, lx)));
+			const __m256 valid	 = _mm256_cmp_ps(length2, epsilon, _CMP_GT_OQ);
+			const __m256 length	 = _mm256_sqrt_ps(_mm256_max_ps(length2, epsilon));
+
+			const __m256 restRatio = _mm256_div_ps(_mm256_loadu_ps(view.restLengths + i), length);
+			__m256 scale = _mm256_mul_ps(_mm256_loadu_ps(view.stiffnesses + i), _mm256_sub_ps(one, restRatio));
+			scale = _mm256_and_ps(scale, valid);
+
+			_mm256_store_ps(forcesX, _mm256_mul_ps(scale, lx));
+			_mm256_store_ps(forcesY, _mm256_mul_ps(scale, ly));
+			_mm256_store_ps(forcesZ, _mm256_mul_ps(scale, lz));
+
+			// AVX2 has no scatter, springs in batch don't share points so order doesn't matter
+			for (Int32 lane = 0; lane < 8; ++lane)
+			{
+				view.forcesX[indexesA[lane]] += forcesX[lane];
+				view.forcesY[indexesA[lane]] += forcesY[lane];
+				view.forcesZ[indexesA[lane]] += forcesZ[lane];
+				view.forcesX[indexesB[lane]] -= forcesX[lane];
+				view.forcesY[indexesB[lane]] -= forcesY[lane];
+				view.forcesZ[indexesB[lane]] -= forcesZ[lane];
+			}
+		}
+
+		accumulate_springs_scalar(view, i, end);
+	}
+
+	TARGET_AVX2
+	void integrate_avx2(const ClothView& view, Float32 deltaTime, Int32 begin, Int32 end)
+	{
+		const __m256 dt = _mm256_set1_ps(deltaTime);
+
+		for (Int32 i = begin; i < end; i += 8)
+		{
+			const __m256 inverseMass = _mm256_load_ps(view.inverseMasses + i);
+			const __m256 step		 = _mm256_mul_ps(inverseMass, dt);
+
+			const __m256 vx = _mm256_fmadd_ps(_mm256_load_ps(view.forcesX + i), step, _mm256_load_ps(view.velocitiesX + i));
+			const __m256 vy = _mm256_fmadd_ps(_mm256_load_ps(view.forcesY + i), step, _mm256_load_ps(view.velocitiesY + i));
+			const __m256 vz = _mm256_fmadd_ps(_mm256_load_ps(view.forcesZ + i), step, _mm256_load_ps(view.velocitiesZ + i));
+			const __m256 px = _mm256_fmadd_ps(vx, dt, _mm256_load_ps(view.positionsX + i));
+			const __m256 py = _mm256_fmadd_ps(vy, dt, _mm256_load_ps(view.positionsY + i));
+			const __m256 pz = _mm256_fmadd_ps(vz, dt, _mm256_load_ps(view.positionsZ + i));
+
+			_mm256_store_ps(view.velocitiesX + i, vx);
+			_mm256_store_ps(view.velocitiesY + i, vy);
+			_mm256_store_ps(view.velocitiesZ + i, vz);
+			_mm256_store_ps(view.positionsX + i, px);
+			_mm256_store_ps(view.positionsY + i, py);
+			_mm256_store_ps(view.positionsZ + i, pz);
+		}
+	}
+#endif
+}
+
+ClothKernels ClothKernels::s_get(ESimdLevel level)
+{
+	level = ESimdLevel(glm::min(Int8(level), Int8(s_get_supported_level())));
+
+	switch (level)
+	{
+#if CLOTH_KERNELS_X86
+		case ESimdLevel::AVX2:
+		{
+			return { accumulate_springs_avx2, integrate_avx2 };
+		}
+		case ESimdLevel::SSE:
+		{
+			return { accumulate_springs_sse, integrate_sse };
+		}
+#endif
+		default:
+		{
+			return { accumulate_springs_scalar, integrate_scalar };
+		}
+	}
+}
+
+ESimdLevel ClothKernels::s_get_supported_level()
+{
+#if CLOTH_KERNELS_X86
+	#if defined(_MSC_VER)
+		Int32 info[4];
+		__cpuid(info, 0);
+		const Int32 maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		const bool hasSse2	  = (info[3] & (1 << 26)) != 0;
+		const bool hasFma	  = (info[2] & (1 << 12)) != 0;
+		const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+		const bool hasAvx	  = (info[2] & (1 << 28)) != 0;
+
+		bool hasAvx2 = false;
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			hasAvx2 = (info[1] & (1 << 5)) != 0;
+		}
+
+		// Operating system has to save ymm registers on context switch
+		const bool hasYmmState = hasOsxsave && (_xgetbv(0) & 0x6) == 0x6;
+		if (hasAvx && hasAvx2 && hasFma && hasYmmState)
+		{
+			return ESimdLevel::AVX2;
+		}
+		return hasSse2 ? ESimdLevel::SSE : ESimdLevel::Scalar;
+	#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		{
+			return ESimdLevel::AVX2;
+		}
+		return __builtin_cpu_supports("sse2") ? ESimdLevel::SSE : ESimdLevel::Scalar;
+	#endif
+#else
+	return ESimdLevel::Scalar;
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Smallest range of mass points or springs worth sending to another thread
+constexpr Int32 MIN_CHUNK_SIZE = 1024;
+
+enum class ESimdLevel : Int8
+{
+	Scalar,
+	SSE,
+	AVX2
+};
+
+/** Raw pointers to cloth arrays used by hot loops */
+struct ClothView
+{
+	Float32 *positionsX, *positionsY, *positionsZ;
+	Float32 *velocitiesX, *velocitiesY, *velocitiesZ;
+	Float32 *forcesX, *forcesY, *forcesZ;
+	const Float32 *inverseMasses;
+	const Int32	  *springIndexesA, *springIndexesB;
+	const Float32 *restLengths, *stiffnesses;
+};
+
+/** Spring and integration passes, selected at runtime by instruction set available on cpu */
+struct ClothKernels
+{
+	// Adds forces of springs [begin, end) to both attached mass points
+	void (*accumulate_springs)(const ClothView& view, Int32 begin, Int32 end);
+	// Integrates mass points [begin, end), both multiples of SIMD_WIDTH
+	void (*integrate)(const ClothView& view, Float32 deltaTime, Int32 begin, Int32 end);
+
+	static ClothKernels s_get(ESimdLevel level);
+	static ESimdLevel s_get_supported_level();
+};
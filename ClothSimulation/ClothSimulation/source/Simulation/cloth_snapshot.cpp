@@ -0,0 +1,235 @@
+#include "cloth_snapshot.hpp"
+
+#include <fstream>
+
+#include "../Common/handle.hpp"
+#include "../Common/mesh.hpp"
+#include "../Common/cloth_data.hpp"
+
+// File starts with these, so files of other programs or older layouts are rejected
+constexpr UInt32 SNAPSHOT_MAGIC	  = 0x4E534C43; // "CLSN"
+constexpr UInt32 SNAPSHOT_VERSION = 2;
+
+namespace
+{
+	template<typename Vector>
+	void write_array(std::ofstream& file, const Vector& values)
+	{
+		const Int64 count = Int64(values.size());
+		file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		file.write(reinterpret_cast<const char*>(values.data()), count * sizeof(typename Vector::value_type));
+	}
+
+	template<typename Vector>
+	bool read_array(std::ifstream& file, Vector& values, Int64 maxCount)
+	{
+		Int64 count = 0;
+		file.read(reinterpret_cast<char*>(&count), sizeof(count));
+		if (!file || count < 0 || count > maxCount)
+		{
+			return false;
+		}
+		values.resize(count);
+		file.read(reinterpret_cast<char*>(values.data()), count * sizeof(typename Vector::value_type));
+		return bool(file);
+	}
+
+	void copy(Float32* target, const Float32* source, Int64 count)
+	{
+		std::memcpy(target, source, count * sizeof(Float32));
+	}
+}
+
+void ClothSnapshot::capture(const std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes)
+{
+	pointOffsets.resize(cloths.size() + 1);
+	vertexOffsets.resize(cloths.size() + 1);
+	pointOrders.resize(cloths.size());
+	pointOffsets[0]	 = 0;
+	vertexOffsets[0] = 0;
+	for (Int32 i = 0; i < cloths.size(); ++i)
+	{
+		pointOffsets[i + 1]	 = pointOffsets[i] + cloths[i].get_padded_count();
+		vertexOffsets[i + 1] = vertexOffsets[i] + Int64(meshes[i]->positions.size());
+		pointOrders[i]		 = cloths[i].pointOrder;
+	}
+
+	for (AlignedVector<Float32> *values : { &positionsX, &positionsY, &positionsZ, &velocitiesX, &velocitiesY, &velocitiesZ })
+	{
+		values->resize(pointOffsets.back());
+	}
+	meshPositions.resize(vertexOffsets.back());
+	meshNormals.resize(vertexOffsets.back());
+
+	for (Int32 i = 0; i < cloths.size(); ++i)
+	{
+		const ClothData &clothData = cloths[i];
+		const Int64 pointOffset	 = pointOffsets[i];
+		const Int64 pointsCount	 = clothData.get_padded_count();
+		copy(positionsX.data() + pointOffset, clothData.positionsX.data(), pointsCount);
+		copy(positionsY.data() + pointOffset, clothData.positionsY.data(), pointsCount);
+		copy(positionsZ.data() + pointOffset, clothData.positionsZ.data(), pointsCount);
+		copy(velocitiesX.data() + pointOffset, clothData.velocitiesX.data(), pointsCount);
+		copy(velocitiesY.data() + pointOffset, clothData.velocitiesY.data(), pointsCount);
+		copy(velocitiesZ.data() + pointOffset, clothData.velocitiesZ.data(), pointsCount);
+
+		const Mesh &mesh = *meshes[i];
+		std::memcpy(meshPositions.data() + vertexOffsets[i], mesh.positions.data(), mesh.positions.size() * sizeof(glm::vec3));
+		// Normals are recomputed after first step, meshes that don't have them yet store zeros
+		if (mesh.normals.size() == mesh.positions.size())
+		{
+			std::memcpy(meshNormals.data() + vertexOffsets[i], mesh.normals.data(), mesh.normals.size() * sizeof(glm::vec3));
+		} else {
+			std::fill(meshNormals.begin() + vertexOffsets[i], meshNormals.begin() + vertexOffsets[i + 1], glm::vec3(0.0f));
+		}
+	}
+}
+
+bool ClothSnapshot::restore(std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes) const
+{
+	if (!is_matching(cloths, meshes))
+	{
+		SPDLOG_WARN("Snapshot doesn't match layout of cloths, not restored.");
+		return false;
+	}
+
+	for (Int32 i = 0; i < cloths.size(); ++i)
+	{
+		ClothData &clothData	= cloths[i];
+		const Int64 pointOffset = pointOffsets[i];
+		const Int64 pointsCount = clothData.get_padded_count();
+		copy(clothData.positionsX.data(), positionsX.data() + pointOffset, pointsCount);
+		copy(clothData.positionsY.data(), positionsY.data() + pointOffset, pointsCount);
+		copy(clothData.positionsZ.data(), positionsZ.data() + pointOffset, pointsCount);
+		copy(clothData.velocitiesX.data(), velocitiesX.data() + pointOffset, pointsCount);
+		copy(clothData.velocitiesY.data(), velocitiesY.data() + pointOffset, pointsCount);
+		copy(clothData.velocitiesZ.data(), velocitiesZ.data() + pointOffset, pointsCount);
+
+		Mesh &mesh = *meshes[i];
+		std::memcpy(mesh.positions.data(), meshPositions.data() + vertexOffsets[i], mesh.positions.size() * sizeof(glm::vec3));
+		mesh.normals.resize(mesh.positions.size());
+		std::memcpy(mesh.normals.data(), meshNormals.data() + vertexOffsets[i], mesh.normals.size() * sizeof(glm::vec3));
+	}
+	return true;
+}
+
+bool ClothSnapshot::save(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		SPDLOG_ERROR("Failed to open snapshot file for writing: {}", filePath);
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&SNAPSHOT_MAGIC), sizeof(SNAPSHOT_MAGIC));
+	file.write(reinterpret_cast<const char*>(&SNAPSHOT_VERSION), sizeof(SNAPSHOT_VERSION));
+	write_array(file, pointOffsets);
+	write_array(file, vertexOffsets);
+	write_array(file, pointOrders);
+	for (const AlignedVector<Float32> *values : { &positionsX, &positionsY, &positionsZ, &velocitiesX, &velocitiesY, &velocitiesZ })
+	{
+		write_array(file, *values);
+	}
+	write_array(file, meshPositions);
+	write_array(file, meshNormals);
+
+	if (!file)
+	{
+		SPDLOG_ERROR("Failed to write snapshot file: {}", filePath);
+		return false;
+	}
+	return true;
+}
+
+bool ClothSnapshot::load(const std::string& filePath)
+{
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		SPDLOG_ERROR("Failed to open snapshot file: {}", filePath);
+		return false;
+	}
+	const Int64 fileSize = Int64(file.tellg());
+	file.seekg(0);
+
+	UInt32 magic = 0, version = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	if (!file || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+	{
+		SPDLOG_ERROR("File is not snapshot of supported version: {}", filePath);
+		return false;
+	}
+
+	// Sizes are checked against offsets and file size, so corrupted file can't make huge allocations or mismatched arrays
+	ClothSnapshot loaded;
+	const Int64 maxCount = fileSize / Int64(sizeof(Float32));
+	bool isValid = read_array(file, loaded.pointOffsets, maxCount) && read_array(file, loaded.vertexOffsets, maxCount)
+				   && !loaded.pointOffsets.empty() && loaded.pointOffsets.size() == loaded.vertexOffsets.size()
+				   && loaded.pointOffsets[0] == 0 && loaded.vertexOffsets[0] == 0
+				   && read_array(file, loaded.pointOrders, maxCount) && loaded.pointOrders.size() + 1 == loaded.pointOffsets.size();
+	const Int64 pointsCount	  = isValid ? glm::min(loaded.pointOffsets.back(), maxCount) : 0;
+	const Int64 verticesCount = isValid ? glm::min(loaded.vertexOffsets.back(), maxCount) : 0;
+	for (AlignedVector<Float32> *values : { &loaded.positionsX, &loaded.positionsY, &loaded.positionsZ,
+											&loaded.velocitiesX, &loaded.velocitiesY, &loaded.velocitiesZ })
+	{
+		isValid = isValid && read_array(file, *values, pointsCount) && values->size() == pointsCount;
+	}
+	isValid = isValid && read_array(file, loaded.meshPositions, verticesCount) && loaded.meshPositions.size() == verticesCount
+			  && read_array(file, loaded.meshNormals, verticesCount) && loaded.meshNormals.size() == verticesCount;
+	isValid = isValid && pointsCount == loaded.pointOffsets.back() && verticesCount == loaded.vertexOffsets.back();
+	for (Int32 i = 0; isValid && i + 1 < loaded.pointOffsets.size(); ++i)
+	{
+		isValid = loaded.pointOffsets[i] <= loaded.pointOffsets[i + 1] && loaded.vertexOffsets[i] <= loaded.vertexOffsets[i + 1];
+	}
+
+	if (!isValid)
+	{
+		SPDLOG_ERROR("Snapshot file is corrupted: {}", filePath);
+		return false;
+	}
+	*this = std::move(loaded);
+	return true;
+}
+
+bool ClothSnapshot::is_empty() const
+{
+	return pointOffsets.empty();
+}
+
+Int64 ClothSnapshot::get_size() const
+{
+	return Int64(positionsX.size()) * 6 * sizeof(Float32) + Int64(meshPositions.size()) * 2 * sizeof(glm::vec3);
+}
+
+void ClothSnapshot::clear()
+{
+	pointOffsets.clear();
+	vertexOffsets.clear();
+	pointOrders.clear();
+	for (AlignedVector<Float32> *values : { &positionsX, &positionsY, &positionsZ, &velocitiesX, &velocitiesY, &velocitiesZ })
+	{
+		values->clear();
+	}
+	meshPositions.clear();
+	meshNormals.clear();
+}
+
+bool ClothSnapshot::is_matching(const std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes) const
+{
+	if (pointOffsets.size() != cloths.size() + 1 || meshes.size() != cloths.size())
+	{
+		return false;
+	}
+	for (Int32 i = 0; i < cloths.size(); ++i)
+	{
+		if (pointOffsets[i + 1] - pointOffsets[i] != cloths[i].get_padded_count()
+			|| vertexOffsets[i + 1] - vertexOffsets[i] != Int64(meshes[i]->positions.size())
+			|| pointOrders[i] != cloths[i].pointOrder)
+		{
+			return false;
+		}
+	}
+	return true;
+}
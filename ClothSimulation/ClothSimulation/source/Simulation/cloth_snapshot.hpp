@@ -0,0 +1,37 @@
+#pragma once
+#include "../Common/aligned_allocator.hpp"
+
+struct ClothData;
+enum class EPointOrder : Int8;
+struct Mesh;
+
+/**
+ * Copy of changing state of cloths, positions and velocities of mass points with positions and normals of their meshes.
+ * Topology, masses and springs are not stored, so state is restored only into cloths of same layout
+ */
+class ClothSnapshot
+{
+public:
+	// Buffers are reused, capturing same layout again doesn't allocate
+	void capture(const std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes);
+	// Returns false and changes nothing when cloths don't match captured layout
+	bool restore(std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes) const;
+
+	bool save(const std::string& filePath) const;
+	bool load(const std::string& filePath);
+
+	bool is_empty() const;
+	// Bytes of captured state
+	Int64 get_size() const;
+	void clear();
+
+private:
+	// Offsets of cloth i are [pointOffsets[i], pointOffsets[i + 1]) and [vertexOffsets[i], vertexOffsets[i + 1])
+	std::vector<Int64> pointOffsets, vertexOffsets;
+	std::vector<EPointOrder> pointOrders; // Mass points of cloth are stored in its order
+	AlignedVector<Float32> positionsX, positionsY, positionsZ;
+	AlignedVector<Float32> velocitiesX, velocitiesY, velocitiesZ;
+	std::vector<glm::vec3> meshPositions, meshNormals;
+
+	bool is_matching(const std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes) const;
+};
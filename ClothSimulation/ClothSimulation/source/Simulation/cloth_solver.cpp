@@ -0,0 +1,933 @@
+#include "cloth_solver.hpp"
+
+#include "../Common/mesh.hpp"
+#include "../Common/handle.hpp"
+#include "../Common/cloth_data.hpp"
+#include "mesh_normals.hpp"
+
+#include <atomic>
+#include <bit>
+
+// Cloths with at least this many mass points are split over all threads, smaller ones are stepped whole by one thread
+constexpr Int32 SHARED_CLOTH_SIZE = 4 * MIN_CHUNK_SIZE;
+
+namespace
+{
+	// Springs of one pattern start at every mass point whose neighbour at offset exists. Two of them share no mass point
+	// when parities of (x or y) / period of their starts differ, so each pattern splits into two batches of grid coloring
+	struct SpringPattern
+	{
+		Int32 offsetX;
+		Int32 offsetY;
+		Int32 period;
+		bool isAlongRow; // Parity is taken of x, otherwise of y
+	};
+
+	// In order springs of one mass point are emitted
+	constexpr SpringPattern SPRING_PATTERNS[] =
+	{
+		{ 2, 0, 2, true },	 // Flexion
+		{ 0, 2, 2, false },
+		{ -1, 1, 1, false }, // Shear
+		{ 1, 1, 1, false },
+		{ 1, 0, 1, true },	 // Structural
+		{ 0, 1, 1, false }
+	};
+	constexpr Int32 PRESORTED_BATCHES_COUNT = 2 * Int32(std::size(SPRING_PATTERNS));
+	// Interior mass point starts and ends one spring of every pattern
+	constexpr Int32 MAX_POINT_SPRINGS = 2 * Int32(std::size(SPRING_PATTERNS));
+
+	Int32 s_get_springs_count(const glm::ivec2& gridSize)
+	{
+		Int32 count = 0;
+		for (const SpringPattern &pattern : SPRING_PATTERNS)
+		{
+			count += glm::max(gridSize.x - glm::abs(pattern.offsetX), 0) * glm::max(gridSize.y - pattern.offsetY, 0);
+		}
+		return count;
+	}
+
+	// Coordinates in [0, end) whose coordinate / period has parity
+	Int32 s_count_parity(Int32 end, Int32 period, Int32 parity)
+	{
+		const Int32 cycle = 2 * period;
+		return end / cycle * period + glm::clamp(end % cycle - parity * period, 0, period);
+	}
+
+	// Springs of pattern starting in row y, only those of batch with parity
+	Int32 s_get_row_springs_count(const SpringPattern& pattern, const glm::ivec2& gridSize, Int32 y, Int32 parity)
+	{
+		const Int32 begin = glm::max(-pattern.offsetX, 0);
+		const Int32 end	  = gridSize.x - glm::max(pattern.offsetX, 0);
+		if (y + pattern.offsetY >= gridSize.y || end <= begin)
+		{
+			return 0;
+		}
+		if (!pattern.isAlongRow)
+		{
+			return (y / pattern.period) % 2 == parity ? end - begin : 0;
+		}
+		return s_count_parity(end, pattern.period, parity) - s_count_parity(begin, pattern.period, parity);
+	}
+
+	// Mass points of spring between mesh vertices, lower one first
+	glm::ivec2 s_get_spring_points(const ClothData& clothData, Int32 vertexA, Int32 vertexB)
+	{
+		const Int32 pointA = clothData.get_mass_point(vertexA);
+		const Int32 pointB = clothData.get_mass_point(vertexB);
+		return { glm::min(pointA, pointB), glm::max(pointA, pointB) };
+	}
+
+	// Bits of x and y interleaved
+	UInt64 s_get_morton_key(UInt32 x, UInt32 y)
+	{
+		const auto spread = [](UInt64 value)
+		{
+			value = (value | value << 16) & 0x0000FFFF0000FFFFull;
+			value = (value | value << 8) & 0x00FF00FF00FF00FFull;
+			value = (value | value << 4) & 0x0F0F0F0F0F0F0F0Full;
+			value = (value | value << 2) & 0x3333333333333333ull;
+			return (value | value << 1) & 0x5555555555555555ull;
+		};
+		return spread(x) | spread(y) << 1;
+	}
+
+	// Distance along Hilbert curve filling square of size, which is power of two
+	UInt64 s_get_hilbert_key(UInt32 x, UInt32 y, UInt32 size)
+	{
+		UInt64 key = 0;
+		for (UInt32 half = size / 2; half > 0; half /= 2)
+		{
+			const UInt32 rightHalf = (x & half) > 0 ? 1 : 0;
+			const UInt32 upperHalf = (y & half) > 0 ? 1 : 0;
+			key += UInt64(half) * half * ((3 * rightHalf) ^ upperHalf);
+			// Quadrant is rotated, so curve inside of it starts where it enters
+			if (upperHalf == 0)
+			{
+				if (rightHalf == 1)
+				{
+					x = size - 1 - x;
+					y = size - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return key;
+	}
+
+	// Rows per chunk, so chunks of grid generation are about as big as chunks of stepping
+	Int32 s_get_rows_chunk(const glm::ivec2& gridSize)
+	{
+		return glm::max(MIN_CHUNK_SIZE / glm::max(gridSize.x, 1), 1);
+	}
+}
+
+void ClothSolver::build_cloth(ClothData& clothData, Mesh& mesh, const glm::ivec2& gridSize,
+							  const glm::vec2& meshSize, Float32 clothMass, Float32 stiffness, const glm::vec3& origin)
+{
+	const glm::vec2 initialLengths = { meshSize.x / Float32(gridSize.x - 1), meshSize.y / Float32(gridSize.y - 1) };
+	const Int32 numberOfMasses = glm::max(gridSize.x * gridSize.y, 0);
+	const Int32 paddedCount = (numberOfMasses + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	const Int32 numberOfSprings = s_get_springs_count(gridSize);
+	const Int32 numberOfIndexes = glm::max((gridSize.x - 1) * (gridSize.y - 1) * 6, 0);
+	const Float32 massOfPoint = clothMass / Float32(numberOfMasses);
+	startup_workers();
+
+	// Every array gets its exact size first, so rows are written in parallel. Vectors keep their capacity, so rebuild
+	// of same grid doesn't allocate
+	clothData.gridSize = gridSize;
+	mesh.positions.resize(numberOfMasses);
+	mesh.uvs.resize(numberOfMasses);
+	mesh.indexes.resize(numberOfIndexes);
+	calculate_positions(mesh, clothData, initialLengths, origin);
+	calculate_indexes(mesh, clothData);
+	calculate_uvs(mesh, clothData);
+	update_normals(clothData, mesh);
+
+	// Presorted springs go straight to their batches, others are colored from grid order in scratch. Reordered points
+	// need sort keys and springs are sorted by first mass point within batches
+	const bool isPresorted = settings.presortedSprings;
+	const bool isReordered = settings.pointOrder != EPointOrder::Grid;
+	const Int32 offsetsCount = (isPresorted ? PRESORTED_BATCHES_COUNT * gridSize.y : gridSize.y) + 1;
+	Int64 scratchSize = Arena::s_get_size<Int32>(offsetsCount);
+	if (!isPresorted)
+	{
+		scratchSize += 2 * Arena::s_get_size<Int32>(numberOfSprings) + Arena::s_get_size<Float32>(numberOfSprings)
+					   + Arena::s_get_size<UInt8>(numberOfSprings) + Arena::s_get_size<UInt64>(paddedCount)
+					   + Arena::s_get_size<Int32>(MAX_SPRING_BATCHES + 1);
+	}
+	if (isReordered)
+	{
+		scratchSize += Arena::s_get_size<UInt64>(numberOfMasses) + Arena::s_get_size<Int32>(paddedCount + 1)
+					   + 2 * Arena::s_get_size<Int32>(numberOfSprings);
+	}
+	scratch.reset(scratchSize);
+
+	allocate_cloth(clothData, numberOfSprings, isReordered);
+	if (isReordered)
+	{
+		calculate_point_order(clothData);
+	}
+	calculate_mass_points(mesh, clothData, massOfPoint);
+
+	attach_mass_point(clothData, clothData.get_mass_point(0));
+	attach_mass_point(clothData, clothData.get_mass_point(gridSize.x * Int32(gridSize.y * 0.5f)));
+	attach_mass_point(clothData, clothData.get_mass_point(gridSize.x * (gridSize.y - 1)));
+
+	springOffsets = scratch.take<Int32>(offsetsCount);
+	calculate_spring_offsets(clothData, isPresorted);
+	if (isPresorted)
+	{
+		calculate_presorted_springs(mesh, clothData, stiffness);
+	} else {
+		unsortedIndexesA	= scratch.take<Int32>(numberOfSprings);
+		unsortedIndexesB	= scratch.take<Int32>(numberOfSprings);
+		unsortedRestLengths = scratch.take<Float32>(numberOfSprings);
+		calculate_springs(mesh, clothData);
+		calculate_spring_batches(clothData, stiffness);
+	}
+	if (isReordered)
+	{
+		sort_springs_by_point(clothData);
+	}
+
+	// All springs share stiffness and the shortest ones are structural, attached points have zero inverse mass
+	clothData.minRestLength	 = glm::min(initialLengths.x, initialLengths.y);
+	clothData.maxStiffness	 = stiffness;
+	clothData.maxInverseMass = massOfPoint > 0.0f ? 1.0f / massOfPoint : 0.0f;
+}
+
+void ClothSolver::step(std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes)
+{
+	startup_workers();
+	kernels = ClothKernels::s_get(settings.simdLevel);
+
+	if (workspaces.size() != cloths.size())
+	{
+		workspaces.resize(cloths.size());
+	}
+	colliders.prepare();
+
+	// Big cloths get all threads one after another, small ones would mostly wait on synchronization,
+	// so they are spread over threads whole
+	const Int64 totalInstabilities = statistics.totalInstabilities;
+	statistics = Statistics();
+	statistics.totalInstabilities = totalInstabilities;
+	statistics.adaptiveDeltaTime  = settings.deltaTime;
+	spreadCloths.clear();
+	for (Int32 i = 0; i < cloths.size(); ++i)
+	{
+		if (cloths[i].get_padded_count() >= SHARED_CLOTH_SIZE || workerPool.get_threads_count() == 1)
+		{
+			step_cloth(workerPool, workspaces[i], cloths[i], *meshes[i]);
+			statistics.sharedCloths++;
+		} else {
+			spreadCloths.emplace_back(i);
+		}
+	}
+
+	workerPool.parallel_for(Int32(spreadCloths.size()), 1, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 index = spreadCloths[i];
+			step_cloth(serialPool, workspaces[index], cloths[index], *meshes[index]);
+		}
+	});
+	statistics.spreadCloths = Int32(spreadCloths.size());
+
+	for (const Workspace &workspace : workspaces)
+	{
+		statistics.solverIterations = glm::max(statistics.solverIterations, workspace.solverIterations);
+		if (settings.selfCollision)
+		{
+			statistics.collisionCandidates += workspace.selfCollision.get_statistics().candidatePairs;
+			statistics.collisionContacts   += workspace.selfCollision.get_statistics().contacts;
+		}
+		statistics.colliderContacts += workspace.colliderContacts;
+		statistics.adaptiveSubsteps	 = glm::max(statistics.adaptiveSubsteps, workspace.substeps);
+		statistics.adaptiveDeltaTime = glm::min(statistics.adaptiveDeltaTime, workspace.substepTime);
+		statistics.instabilities	+= workspace.instabilities;
+	}
+	statistics.totalInstabilities += statistics.instabilities;
+}
+
+const ClothSolver::Statistics& ClothSolver::get_statistics() const
+{
+	return statistics;
+}
+
+void ClothSolver::reset_state()
+{
+	for (Workspace &workspace : workspaces)
+	{
+		workspace.implicitIntegrator.reset_initial_guess();
+		// Rebuilt cloth may have other order of mass points or springs with same counts, adjacency is keyed on counts
+		workspace.xpbdIntegrator.clear();
+		workspace.selfCollision.clear();
+	}
+	statistics = Statistics();
+}
+
+void ClothSolver::shutdown()
+{
+	workerPool.shutdown();
+	workspaces.clear();
+	spreadCloths.clear();
+	colliders.clear_meshes(); // Shapes are settings, they survive reset
+}
+
+void ClothSolver::startup_workers()
+{
+	if (workerPool.get_threads_count() != settings.threadsCount)
+	{
+		workerPool.startup(settings.threadsCount);
+	}
+}
+
+void ClothSolver::step_cloth(WorkerPool& pool, Workspace& workspace, ClothData& clothData, Mesh& mesh)
+{
+	const Int32 paddedCount = clothData.get_padded_count();
+	if (Int32(workspace.forcesX.size()) != paddedCount)
+	{
+		workspace.arena.reset(6 * Arena::s_get_size<Float32>(paddedCount));
+		for (ArenaArray<Float32> *forces : { &workspace.forcesX, &workspace.forcesY, &workspace.forcesZ,
+											 &workspace.externalForcesX, &workspace.externalForcesY, &workspace.externalForcesZ })
+		{
+			*forces = workspace.arena.take<Float32>(paddedCount);
+			std::fill(forces->begin(), forces->end(), 0.0f);
+		}
+	}
+
+	// Speeds of first external forces pass decide substeps of whole step
+	compute_external_forces(pool, clothData, workspace);
+	const Int32 substeps = settings.adaptiveTimeStep ? get_substeps_count(clothData, workspace) : 1;
+	const Float32 deltaTime = settings.deltaTime / Float32(substeps);
+	for (Int32 substep = 0; substep < substeps; ++substep)
+	{
+		if (substep > 0)
+		{
+			compute_external_forces(pool, clothData, workspace);
+		}
+		step_substep(pool, workspace, clothData, mesh, deltaTime);
+	}
+	workspace.substeps	  = substeps;
+	workspace.substepTime = deltaTime;
+
+	// Conjugate gradient would otherwise start next step from guess of diverged one
+	workspace.instabilities = write_mesh_positions(pool, clothData, mesh);
+	if (workspace.instabilities > 0)
+	{
+		workspace.implicitIntegrator.reset_initial_guess();
+	}
+}
+
+void ClothSolver::step_substep(WorkerPool& pool, Workspace& workspace, ClothData& clothData, Mesh& mesh, Float32 deltaTime)
+{
+	const ClothView view = get_view(clothData, workspace);
+
+	switch (settings.integrator)
+	{
+		case EIntegrator::Explicit:
+		{
+			compute_internal_forces(pool, view, clothData, workspace);
+			integrate(pool, view, clothData, deltaTime);
+			workspace.solverIterations = 0;
+			break;
+		}
+		case EIntegrator::Implicit:
+		{
+			compute_internal_forces(pool, view, clothData, workspace);
+			ImplicitIntegrator::Parameters parameters;
+			parameters.deltaTime	 = deltaTime;
+			parameters.damping		 = settings.damping;
+			parameters.viscosity	 = settings.viscosity;
+			parameters.fluidNormal	 = get_fluid_normal();
+			parameters.maxIterations = settings.linearIterations;
+			parameters.tolerance	 = settings.linearTolerance;
+			workspace.solverIterations = workspace.implicitIntegrator.integrate(pool, view, clothData, parameters);
+			break;
+		}
+		case EIntegrator::Xpbd:
+		{
+			// Springs are constraints here, so prediction uses only external forces
+			ClothView externalView = view;
+			externalView.forcesX = workspace.externalForcesX.data();
+			externalView.forcesY = workspace.externalForcesY.data();
+			externalView.forcesZ = workspace.externalForcesZ.data();
+			XpbdIntegrator::Parameters parameters;
+			parameters.deltaTime  = deltaTime;
+			parameters.iterations = settings.constraintIterations;
+			parameters.mode		  = settings.xpbdMode;
+			workspace.xpbdIntegrator.integrate(pool, externalView, clothData, parameters);
+			workspace.solverIterations = settings.constraintIterations;
+			break;
+		}
+	}
+
+	// Runs after integration, so it corrects positions and velocities that the integrator produced
+	if (settings.selfCollision)
+	{
+		workspace.selfCollision.collide(pool, view, clothData, mesh.indexes, settings.collisionThickness);
+	}
+
+	// Last, so cloth never ends step inside of colliders even when self-collision pushed it there
+	StaticColliders::Parameters colliderParameters;
+	colliderParameters.thickness = settings.colliderThickness;
+	colliderParameters.friction	 = settings.colliderFriction;
+	colliderParameters.deltaTime = deltaTime;
+	workspace.colliderContacts = colliders.collide(pool, view, clothData, colliderParameters);
+}
+
+ClothView ClothSolver::get_view(ClothData& clothData, Workspace& workspace)
+{
+	ClothView view;
+	view.positionsX		= clothData.positionsX.data();
+	view.positionsY		= clothData.positionsY.data();
+	view.positionsZ		= clothData.positionsZ.data();
+	view.velocitiesX	= clothData.velocitiesX.data();
+	view.velocitiesY	= clothData.velocitiesY.data();
+	view.velocitiesZ	= clothData.velocitiesZ.data();
+	view.forcesX		= workspace.forcesX.data();
+	view.forcesY		= workspace.forcesY.data();
+	view.forcesZ		= workspace.forcesZ.data();
+	view.inverseMasses	= clothData.inverseMasses.data();
+	view.springIndexesA = clothData.springIndexesA.data();
+	view.springIndexesB = clothData.springIndexesB.data();
+	view.restLengths	= clothData.restLengths.data();
+	view.stiffnesses	= clothData.stiffnesses.data();
+	return view;
+}
+
+void ClothSolver::compute_internal_forces(WorkerPool& pool, const ClothView& view, const ClothData& clothData,
+										  Workspace& workspace)
+{
+	// Internal forces start from external ones, so integration reads one array
+	pool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		const UInt64 size = (end - begin) * sizeof(Float32);
+		std::memcpy(workspace.forcesX.data() + begin, workspace.externalForcesX.data() + begin, size);
+		std::memcpy(workspace.forcesY.data() + begin, workspace.externalForcesY.data() + begin, size);
+		std::memcpy(workspace.forcesZ.data() + begin, workspace.externalForcesZ.data() + begin, size);
+	});
+
+	// Springs in one batch never share mass point, so batch can be scattered without synchronization
+	for (Int32 batch = 0; batch + 1 < clothData.springBatchOffsets.size(); ++batch)
+	{
+		const Int32 batchBegin = clothData.springBatchOffsets[batch];
+		const Int32 batchEnd   = clothData.springBatchOffsets[batch + 1];
+		pool.parallel_for(batchEnd - batchBegin, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+		{
+			kernels.accumulate_springs(view, batchBegin + begin, batchBegin + end);
+		});
+	}
+}
+
+void ClothSolver::compute_external_forces(WorkerPool& pool, const ClothData &clothData, Workspace& workspace)
+{
+	const glm::vec3 normal = get_fluid_normal();
+	workspace.threadSpeeds2.assign(pool.get_threads_count(), 0.0f);
+	pool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+	{
+		Float32 maxSpeed2 = 0.0f;
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 velocity(clothData.velocitiesX[i], clothData.velocitiesY[i], clothData.velocitiesZ[i]);
+			maxSpeed2 = glm::max(maxSpeed2, glm::length2(velocity));
+			const glm::vec3 gravityForce = clothData.masses[i] * settings.gravity;
+			const glm::vec3 dampingForce = -settings.damping * velocity;
+			glm::vec3 fluidForce = settings.viscosity
+								 * glm::dot(normal, settings.fluidVelocity - velocity)
+								 * normal;
+
+			const glm::vec3 force = gravityForce + dampingForce + fluidForce;
+			workspace.externalForcesX[i] = force.x;
+			workspace.externalForcesY[i] = force.y;
+			workspace.externalForcesZ[i] = force.z;
+		}
+		workspace.threadSpeeds2[threadIndex] = glm::max(workspace.threadSpeeds2[threadIndex], maxSpeed2);
+	});
+}
+
+Int32 ClothSolver::get_substeps_count(const ClothData& clothData, const Workspace& workspace) const
+{
+	if (settings.deltaTime <= 0.0f)
+	{
+		return 1;
+	}
+
+	// Fastest mass point may cross only part of shortest spring, so springs and collisions see every crossing
+	Float32 stableTime = std::numeric_limits<Float32>::max();
+	const Float32 maxSpeed = glm::sqrt(*std::max_element(workspace.threadSpeeds2.begin(), workspace.threadSpeeds2.end()));
+	if (maxSpeed > 0.0f)
+	{
+		stableTime = settings.courantNumber * clothData.minRestLength / maxSpeed;
+	}
+
+	// Symplectic Euler of x'' = -w^2 x - c x' is stable for h^2 w^2 + 2 h c < 4. Squared frequency of any mode is bounded
+	// by largest sum of spring stiffnesses of mass point times its inverse mass (Gershgorin), damping and viscosity damp
+	// every point. Other integrators are stable for any step of springs
+	if (settings.integrator == EIntegrator::Explicit)
+	{
+		const Float32 frequency2 = 2.0f * Float32(MAX_POINT_SPRINGS) * clothData.maxStiffness * clothData.maxInverseMass;
+		const Float32 dampingRate = (settings.damping + settings.viscosity) * clothData.maxInverseMass;
+		const Float32 denominator = dampingRate + glm::sqrt(dampingRate * dampingRate + 4.0f * frequency2);
+		if (denominator > 0.0f)
+		{
+			stableTime = glm::min(stableTime, settings.stabilityFactor * 4.0f / denominator);
+		}
+	}
+
+	if (stableTime <= 0.0f)
+	{
+		return glm::max(settings.maxAdaptiveSubsteps, 1);
+	}
+	const Float32 substeps = glm::ceil(settings.deltaTime / stableTime);
+	return Int32(glm::clamp(substeps, 1.0f, Float32(glm::max(settings.maxAdaptiveSubsteps, 1))));
+}
+
+glm::vec3 ClothSolver::get_fluid_normal() const
+{
+	if (glm::length2(settings.fluidVelocity) > 0.0f)
+	{
+		return -glm::normalize(settings.fluidVelocity);
+	}
+	return glm::vec3(0.0f);
+}
+
+void ClothSolver::integrate(WorkerPool& pool, const ClothView& view, const ClothData& clothData, Float32 deltaTime)
+{
+	// Chunks are counted in SIMD_WIDTH blocks, so kernels can use aligned loads without tails
+	const Int32 blocksCount = clothData.get_padded_count() / SIMD_WIDTH;
+	pool.parallel_for(blocksCount, MIN_CHUNK_SIZE / SIMD_WIDTH, [&](Int32 begin, Int32 end, Int32)
+	{
+		kernels.integrate(view, deltaTime, begin * SIMD_WIDTH, end * SIMD_WIDTH);
+	});
+}
+
+Int32 ClothSolver::write_mesh_positions(WorkerPool& pool, ClothData& clothData, Mesh& mesh)
+{
+	std::atomic<Int32> instabilitiesCount = 0;
+	pool.parallel_for(clothData.massPointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		Int32 instabilities = 0;
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 vertex = clothData.get_mesh_vertex(i);
+			// Sum is NaN or infinite when any term is, finite terms overflow it only far past any sane state
+			const Float32 sum = clothData.positionsX[i] + clothData.positionsY[i] + clothData.positionsZ[i]
+							  + clothData.velocitiesX[i] + clothData.velocitiesY[i] + clothData.velocitiesZ[i];
+			if (std::isfinite(sum))
+			{
+				mesh.positions[vertex] = clothData.get_position(i);
+				continue;
+			}
+
+			const glm::vec3 &position = mesh.positions[vertex];
+			clothData.positionsX[i]	 = position.x;
+			clothData.positionsY[i]	 = position.y;
+			clothData.positionsZ[i]	 = position.z;
+			clothData.velocitiesX[i] = 0.0f;
+			clothData.velocitiesY[i] = 0.0f;
+			clothData.velocitiesZ[i] = 0.0f;
+			instabilities++;
+		}
+		if (instabilities > 0)
+		{
+			instabilitiesCount.fetch_add(instabilities, std::memory_order_relaxed);
+		}
+	});
+	return instabilitiesCount.load();
+}
+
+void ClothSolver::allocate_cloth(ClothData& clothData, Int32 springsCount, bool isReordered)
+{
+	const Int32 count = clothData.gridSize.x * clothData.gridSize.y;
+	const Int32 paddedCount = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	const Int32 orderCount = isReordered ? count : 0;
+
+	Arena &arena = clothData.arena;
+	arena.reset(8 * Arena::s_get_size<Float32>(paddedCount) + Arena::s_get_size<UInt8>(paddedCount)
+				+ 2 * Arena::s_get_size<Float32>(springsCount) + 2 * Arena::s_get_size<Int32>(springsCount)
+				+ Arena::s_get_size<Int32>(MAX_SPRING_BATCHES + 1) + 2 * Arena::s_get_size<Int32>(orderCount));
+	clothData.massPointsCount	 = count;
+	clothData.positionsX		 = arena.take<Float32>(paddedCount);
+	clothData.positionsY		 = arena.take<Float32>(paddedCount);
+	clothData.positionsZ		 = arena.take<Float32>(paddedCount);
+	clothData.velocitiesX		 = arena.take<Float32>(paddedCount);
+	clothData.velocitiesY		 = arena.take<Float32>(paddedCount);
+	clothData.velocitiesZ		 = arena.take<Float32>(paddedCount);
+	clothData.masses			 = arena.take<Float32>(paddedCount);
+	clothData.inverseMasses		 = arena.take<Float32>(paddedCount);
+	clothData.simulatedFlags	 = arena.take<UInt8>(paddedCount);
+	clothData.restLengths		 = arena.take<Float32>(springsCount);
+	clothData.stiffnesses		 = arena.take<Float32>(springsCount);
+	clothData.springIndexesA	 = arena.take<Int32>(springsCount);
+	clothData.springIndexesB	 = arena.take<Int32>(springsCount);
+	clothData.springBatchOffsets = arena.take<Int32>(MAX_SPRING_BATCHES + 1);
+	clothData.pointOrder		 = isReordered ? settings.pointOrder : EPointOrder::Grid;
+	clothData.pointVertices		 = arena.take<Int32>(orderCount);
+	clothData.vertexPoints		 = arena.take<Int32>(orderCount);
+}
+
+void ClothSolver::calculate_point_order(ClothData& clothData)
+{
+	// Key in high half, vertex in low half, so sorting keys sorts vertices along curve
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	const Int32 count = clothData.massPointsCount;
+	const UInt32 curveSize = std::bit_ceil(UInt32(glm::max(gridSize.x, gridSize.y)));
+	ArenaArray<UInt64> keys = scratch.take<UInt64>(count);
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			for (Int32 x = 0; x < gridSize.x; ++x)
+			{
+				const UInt64 key = clothData.pointOrder == EPointOrder::Morton
+					? s_get_morton_key(UInt32(x), UInt32(y)) : s_get_hilbert_key(UInt32(x), UInt32(y), curveSize);
+				keys[y * gridSize.x + x] = key << 32 | UInt64(y * gridSize.x + x);
+			}
+		}
+	});
+	std::sort(keys.begin(), keys.end());
+
+	workerPool.parallel_for(count, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 vertex = Int32(keys[i] & 0xFFFFFFFF);
+			clothData.pointVertices[i]		= vertex;
+			clothData.vertexPoints[vertex] = i;
+		}
+	});
+}
+
+void ClothSolver::calculate_mass_points(const Mesh& mesh, ClothData& clothData, Float32 massOfPoint)
+{
+	const Int32 count = clothData.massPointsCount;
+
+	// Padding points are attached and massless, so they never move nor pull anything
+	workerPool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const bool isPoint = i < count;
+			const glm::vec3 position = isPoint ? mesh.positions[clothData.get_mesh_vertex(i)] : glm::vec3(0.0f);
+			clothData.positionsX[i]		= position.x;
+			clothData.positionsY[i]		= position.y;
+			clothData.positionsZ[i]		= position.z;
+			clothData.velocitiesX[i]	= 0.0f;
+			clothData.velocitiesY[i]	= 0.0f;
+			clothData.velocitiesZ[i]	= 0.0f;
+			clothData.masses[i]			= isPoint ? massOfPoint : 0.0f;
+			clothData.inverseMasses[i]	= isPoint ? 1.0f / massOfPoint : 0.0f;
+			clothData.simulatedFlags[i] = isPoint ? 1 : 0;
+		}
+	});
+}
+
+void ClothSolver::attach_mass_point(ClothData& clothData, Int32 index)
+{
+	clothData.simulatedFlags[index] = 0;
+	clothData.inverseMasses[index]  = 0.0f;
+}
+
+void ClothSolver::calculate_positions(Mesh& mesh, const ClothData &clothData, const glm::vec2& initialLengths,
+									  const glm::vec3& origin)
+{
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			glm::vec3 *row = mesh.positions.data() + y * gridSize.x;
+			for (Int32 x = 0; x < gridSize.x; ++x)
+			{
+				row[x] = glm::vec3(origin.x + initialLengths.x * Float32(x), origin.y + initialLengths.y * Float32(-y), origin.z);
+			}
+		}
+	});
+}
+
+//		B
+//      *
+//     /|
+//    / |
+//   /  |A
+// C*---*---*C
+//      |  /
+//      | /
+//      |/
+//      *
+//		B
+void ClothSolver::calculate_indexes(Mesh& mesh, const ClothData& clothData)
+{
+	// Row y writes upper triangles of quads above it, then lower ones of quads below it, first row has only lower ones
+	const glm::ivec2& gridSize = clothData.gridSize;
+	const Int32 rowTriangles = glm::max(gridSize.x - 1, 0);
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			UInt32 *indexes = mesh.indexes.data() + (y > 0 ? (2 * y - 1) * 3 * rowTriangles : 0);
+			for (Int32 x = 0; x < gridSize.x; ++x)
+			{
+				const Int32 indexA = y * gridSize.x + x;
+				if (x - 1 >= 0 && y - 1 >= 0) // Upper triangle
+				{
+					*indexes++ = UInt32(indexA);
+					*indexes++ = UInt32((y - 1) * gridSize.x + x);
+					*indexes++ = UInt32(y * gridSize.x + x - 1);
+				}
+
+				if (x + 1 < gridSize.x && y + 1 < gridSize.y) // Lower triangle
+				{
+					*indexes++ = UInt32(indexA);
+					*indexes++ = UInt32((y + 1) * gridSize.x + x);
+					*indexes++ = UInt32(y * gridSize.x + x + 1);
+				}
+			}
+		}
+	});
+}
+
+void ClothSolver::update_normals(const ClothData& clothData, Mesh& mesh)
+{
+	startup_workers();
+	MeshNormals::s_update_grid(workerPool, mesh, clothData.gridSize);
+}
+
+void ClothSolver::calculate_uvs(Mesh& mesh, const ClothData &clothData)
+{
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	const glm::vec2 uvOffset = 1.0f / glm::vec2(gridSize - 1);
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			glm::vec2 *row = mesh.uvs.data() + y * gridSize.x;
+			for (Int32 x = 0; x < gridSize.x; ++x)
+			{
+				row[x] = glm::vec2(uvOffset.x * x, uvOffset.y * y);
+			}
+		}
+	});
+}
+
+void ClothSolver::calculate_spring_offsets(const ClothData& clothData, bool isPresorted)
+{
+	// Offsets of presorted springs are ordered by batch and row, others by row only
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	Int32 offset = 0;
+	if (isPresorted)
+	{
+		for (Int32 batch = 0; batch < PRESORTED_BATCHES_COUNT; ++batch)
+		{
+			for (Int32 y = 0; y < gridSize.y; ++y)
+			{
+				springOffsets[batch * gridSize.y + y] = offset;
+				offset += s_get_row_springs_count(SPRING_PATTERNS[batch / 2], gridSize, y, batch % 2);
+			}
+		}
+	} else {
+		for (Int32 y = 0; y < gridSize.y; ++y)
+		{
+			springOffsets[y] = offset;
+			for (const SpringPattern &pattern : SPRING_PATTERNS)
+			{
+				offset += s_get_row_springs_count(pattern, gridSize, y, 0) + s_get_row_springs_count(pattern, gridSize, y, 1);
+			}
+		}
+	}
+	springOffsets[springOffsets.size() - 1] = offset;
+}
+
+void ClothSolver::calculate_springs(const Mesh &mesh, const ClothData &clothData)
+{
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			Int32 target = springOffsets[y];
+			for (Int32 x = 0; x < gridSize.x; ++x)
+			{
+				const Int32 indexA = x + y * gridSize.x;
+				for (const SpringPattern &pattern : SPRING_PATTERNS)
+				{
+					const Int32 neighbourX = x + pattern.offsetX;
+					if (neighbourX < 0 || neighbourX >= gridSize.x || y + pattern.offsetY >= gridSize.y)
+					{
+						continue;
+					}
+					const Int32 indexB = indexA + pattern.offsetX + pattern.offsetY * gridSize.x;
+					const glm::ivec2 points = s_get_spring_points(clothData, indexA, indexB);
+					unsortedIndexesA[target]	= points.x;
+					unsortedIndexesB[target]	= points.y;
+					unsortedRestLengths[target] = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
+					target++;
+				}
+			}
+		}
+	});
+}
+
+void ClothSolver::calculate_presorted_springs(const Mesh& mesh, ClothData& clothData, Float32 stiffness)
+{
+	// Every row writes its part of every batch, batches follow grid coloring of patterns, so nothing is sorted later
+	const glm::ivec2 &gridSize = clothData.gridSize;
+	workerPool.parallel_for(gridSize.y, s_get_rows_chunk(gridSize), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			for (Int32 batch = 0; batch < PRESORTED_BATCHES_COUNT; ++batch)
+			{
+				Int32 target = springOffsets[batch * gridSize.y + y];
+				if (target == springOffsets[batch * gridSize.y + y + 1])
+				{
+					continue;
+				}
+				const SpringPattern &pattern = SPRING_PATTERNS[batch / 2];
+				const Int32 parity = batch % 2;
+				for (Int32 x = glm::max(-pattern.offsetX, 0); x < gridSize.x - glm::max(pattern.offsetX, 0); ++x)
+				{
+					if (pattern.isAlongRow && (x / pattern.period) % 2 != parity)
+					{
+						continue;
+					}
+					const Int32 indexA = x + y * gridSize.x;
+					const Int32 indexB = indexA + pattern.offsetX + pattern.offsetY * gridSize.x;
+					const glm::ivec2 points = s_get_spring_points(clothData, indexA, indexB);
+					clothData.springIndexesA[target] = points.x;
+					clothData.springIndexesB[target] = points.y;
+					clothData.restLengths[target]	 = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
+					clothData.stiffnesses[target]	 = stiffness;
+					target++;
+				}
+			}
+		}
+	});
+
+	// Empty batches of small grids are dropped
+	ArenaArray<Int32> &batchOffsets = clothData.springBatchOffsets;
+	Int32 batchesCount = 0;
+	for (Int32 batch = 0; batch < PRESORTED_BATCHES_COUNT; ++batch)
+	{
+		const Int32 batchBegin = springOffsets[batch * gridSize.y];
+		if (batchBegin != springOffsets[(batch + 1) * gridSize.y])
+		{
+			batchOffsets[batchesCount++] = batchBegin;
+		}
+	}
+	batchOffsets[batchesCount] = springOffsets[springOffsets.size() - 1];
+	batchOffsets = ArenaArray<Int32>(batchOffsets.data(), batchesCount + 1);
+}
+
+void ClothSolver::calculate_spring_batches(ClothData& clothData, Float32 stiffness)
+{
+	const Int32 springsCount = Int32(unsortedIndexesA.size());
+	std::fill(clothData.stiffnesses.begin(), clothData.stiffnesses.end(), stiffness);
+
+	// Greedy coloring, bit n of mask tells that point has already spring of color n
+	ArenaArray<UInt64> usedColors	= scratch.take<UInt64>(clothData.get_padded_count());
+	ArenaArray<UInt8> springColors	= scratch.take<UInt8>(springsCount);
+	ArenaArray<Int32> writeOffsets	= scratch.take<Int32>(MAX_SPRING_BATCHES + 1);
+	ArenaArray<Int32> &batchOffsets = clothData.springBatchOffsets;
+	std::fill(usedColors.begin(), usedColors.end(), UInt64(0));
+	Int32 colorsCount = 0;
+
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		const Int32 indexA = unsortedIndexesA[i];
+		const Int32 indexB = unsortedIndexesB[i];
+		const UInt64 freeColors = ~(usedColors[indexA] | usedColors[indexB]);
+		if (freeColors == 0)
+		{
+			SPDLOG_ERROR("Too many springs attached to one mass point, springs can't be batched.");
+			std::memcpy(clothData.springIndexesA.data(), unsortedIndexesA.data(), springsCount * sizeof(Int32));
+			std::memcpy(clothData.springIndexesB.data(), unsortedIndexesB.data(), springsCount * sizeof(Int32));
+			std::memcpy(clothData.restLengths.data(), unsortedRestLengths.data(), springsCount * sizeof(Float32));
+			batchOffsets[0] = 0;
+			batchOffsets[1] = springsCount;
+			batchOffsets	= ArenaArray<Int32>(batchOffsets.data(), 2);
+			return;
+		}
+		const Int32 color = std::countr_zero(freeColors);
+		usedColors[indexA] |= UInt64(1) << color;
+		usedColors[indexB] |= UInt64(1) << color;
+		springColors[i] = UInt8(color);
+		colorsCount = glm::max(colorsCount, color + 1);
+	}
+
+	// Counting sort keeps springs of one color in original order
+	std::fill(batchOffsets.begin(), batchOffsets.begin() + colorsCount + 1, 0);
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		batchOffsets[springColors[i] + 1]++;
+	}
+	for (Int32 color = 0; color < colorsCount; ++color)
+	{
+		batchOffsets[color + 1] += batchOffsets[color];
+	}
+	batchOffsets = ArenaArray<Int32>(batchOffsets.data(), colorsCount + 1);
+
+	std::memcpy(writeOffsets.data(), batchOffsets.data(), colorsCount * sizeof(Int32));
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		const Int32 target = writeOffsets[springColors[i]]++;
+		clothData.springIndexesA[target] = unsortedIndexesA[i];
+		clothData.springIndexesB[target] = unsortedIndexesB[i];
+		clothData.restLengths[target]	 = unsortedRestLengths[i];
+	}
+}
+
+void ClothSolver::sort_springs_by_point(ClothData& clothData)
+{
+	// Radix sort of two digits, counting sort by first mass point and then stable split into batches, so scatter of
+	// every batch walks mass points in order
+	const Int32 springsCount = Int32(clothData.springIndexesA.size());
+	ArenaArray<Int32> pointOffsets = scratch.take<Int32>(clothData.get_padded_count() + 1);
+	ArenaArray<Int32> byPoint	   = scratch.take<Int32>(springsCount);
+	ArenaArray<Int32> order		   = scratch.take<Int32>(springsCount);
+	std::fill(pointOffsets.begin(), pointOffsets.end(), 0);
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		pointOffsets[clothData.springIndexesA[i] + 1]++;
+	}
+	for (Int32 i = 0; i + 1 < pointOffsets.size(); ++i)
+	{
+		pointOffsets[i + 1] += pointOffsets[i];
+	}
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		byPoint[pointOffsets[clothData.springIndexesA[i]]++] = i;
+	}
+
+	const ArenaArray<Int32> &batchOffsets = clothData.springBatchOffsets;
+	Int32 writeOffsets[MAX_SPRING_BATCHES];
+	std::memcpy(writeOffsets, batchOffsets.data(), (batchOffsets.size() - 1) * sizeof(Int32));
+	for (Int32 spring : byPoint)
+	{
+		const Int32 batch = Int32(std::upper_bound(batchOffsets.begin(), batchOffsets.end(), spring) - batchOffsets.begin()) - 1;
+		order[writeOffsets[batch]++] = spring;
+	}
+
+	// Sorted by point isn't needed anymore, it holds values while they are permuted
+	ArenaArray<Int32> &values = byPoint;
+	for (ArenaArray<Int32> *indexes : { &clothData.springIndexesA, &clothData.springIndexesB })
+	{
+		for (Int32 i = 0; i < springsCount; ++i)
+		{
+			values[i] = (*indexes)[order[i]];
+		}
+		std::memcpy(indexes->data(), values.data(), springsCount * sizeof(Int32));
+	}
+	for (ArenaArray<Float32> *springValues : { &clothData.restLengths, &clothData.stiffnesses })
+	{
+		for (Int32 i = 0; i < springsCount; ++i)
+		{
+			values[i] = std::bit_cast<Int32>((*springValues)[order[i]]);
+		}
+		std::memcpy(springValues->data(), values.data(), springsCount * sizeof(Float32));
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "../Common/worker_pool.hpp"
+#include "../Common/arena.hpp"
+#include "../Common/cloth_data.hpp"
+#include "cloth_kernels.hpp"
+#include "implicit_integrator.hpp"
+#include "xpbd_integrator.hpp"
+#include "self_collision.hpp"
+#include "static_colliders.hpp"
+
+struct Mesh;
+
+enum class EIntegrator : Int8
+{
+	Explicit, // Symplectic Euler
+	Implicit, // Backward Euler with conjugate gradient solve
+	Xpbd	  // Springs projected as distance constraints
+};
+
+/** Mass-spring cloth solver, knows nothing about windows, OpenGL or resource manager */
+class ClothSolver
+{
+public:
+	struct Settings
+	{
+		glm::vec3 gravity		   = { 0.0f, -9.81f, 0.0f };
+		glm::vec3 fluidVelocity    = { 0.0f, 0.0f, 30.0f };
+		Float32 viscosity		   = 1.0f;
+		Float32 damping			   = 0.1f;
+		Float32 deltaTime		   = 0.016f;
+		Int32 threadsCount		   = WorkerPool::s_get_hardware_threads_count();
+		ESimdLevel simdLevel	   = ClothKernels::s_get_supported_level();
+		EIntegrator integrator	   = EIntegrator::Explicit;
+		Int32 linearIterations	   = 50;
+		Float32 linearTolerance	   = 1.0e-2f;
+		Int32 constraintIterations = 10;
+		EXpbdMode xpbdMode		   = EXpbdMode::GaussSeidel;
+		bool selfCollision		   = false;
+		Float32 collisionThickness = 0.3f; // Fraction of shortest spring rest length
+		Float32 colliderThickness  = 0.1f; // World distance kept from static colliders
+		Float32 colliderFriction   = 0.3f;
+		// Springs of next build go straight into batches of fixed grid coloring, each batch walks grid in order. Otherwise
+		// they are colored greedily in order of mass points
+		bool presortedSprings	   = false;
+		// Mass points of next build are ordered along this curve, springs are then sorted by first mass point in batches
+		EPointOrder pointOrder	   = EPointOrder::Grid;
+		// Every cloth splits deltaTime into equal substeps no longer than its estimated stable step
+		bool adaptiveTimeStep	   = false;
+		Float32 stabilityFactor	   = 0.9f; // Fraction of stable step of springs and damping taken, explicit integrator only
+		Float32 courantNumber	   = 0.5f; // Fraction of shortest spring rest length fastest mass point may travel per substep
+		Int32 maxAdaptiveSubsteps  = 64;   // Of one step, cloth that needs more takes longer substeps
+	};
+
+	struct Statistics
+	{
+		Int32 solverIterations = 0; // Most CG or constraint iterations of one cloth in last step, zero for explicit integrator
+		Int32 sharedCloths	   = 0; // Cloths of last step split over all threads
+		Int32 spreadCloths	   = 0; // Cloths of last step stepped whole on single thread
+		Int32 collisionCandidates = 0; // Self-collision pairs of all cloths that passed broad phase in last step
+		Int32 collisionContacts	  = 0; // Self-collision pairs of all cloths closer than thickness in last step
+		Int32 colliderContacts	  = 0; // Mass points of all cloths touching static colliders in last step
+		Int32 adaptiveSubsteps	  = 0; // Most substeps of one cloth in last step, one without adaptive time step
+		Float32 adaptiveDeltaTime = 0.0f; // Shortest substep of all cloths in last step
+		// Mass points of all cloths that ended last step with non-finite position or velocity, they were moved back to
+		// position of previous step and stopped
+		Int32 instabilities		  = 0;
+		Int64 totalInstabilities  = 0; // Since last reset_state
+	};
+
+	Settings settings;
+	// Shared by all cloths, changes are picked up at start of next step
+	StaticColliders colliders;
+
+	// Top left mass point is placed at origin, cloth spans +x and -y. Cloth and mesh may hold previous build, their memory
+	// is reused when it is big enough, so rebuilding cloths of same grid doesn't allocate
+	void build_cloth(ClothData& clothData, Mesh& mesh, const glm::ivec2& gridSize, const glm::vec2& meshSize,
+					 Float32 clothMass, Float32 stiffness, const glm::vec3& origin = glm::vec3(0.0f));
+	// Advances all cloths by one settings.deltaTime, meshes[i] receives positions of cloths[i]
+	void step(std::vector<ClothData>& cloths, const std::vector<Mesh*>& meshes);
+	// Gathers normals from grid neighbours on all threads
+	void update_normals(const ClothData& clothData, Mesh& mesh);
+	// Call after positions or velocities were replaced (e.g. restored snapshot) or cloths were rebuilt, so step doesn't
+	// continue from old state
+	void reset_state();
+	const Statistics& get_statistics() const;
+
+	void shutdown();
+
+private:
+	// Scratch buffers of one cloth, workspace i belongs to cloth i
+	struct Workspace
+	{
+		Arena arena; // Force arrays, allocated again only when cloth grows
+		ArenaArray<Float32> forcesX, forcesY, forcesZ;
+		ArenaArray<Float32> externalForcesX, externalForcesY, externalForcesZ;
+		ImplicitIntegrator implicitIntegrator;
+		XpbdIntegrator xpbdIntegrator;
+		SelfCollision selfCollision;
+		std::vector<Float32> threadSpeeds2; // Largest squared speed of mass points seen by every thread of pool
+		Int32 solverIterations = 0;
+		Int32 colliderContacts = 0;
+		Int32 substeps		   = 0;
+		Float32 substepTime	   = 0.0f;
+		Int32 instabilities	   = 0;
+	};
+
+	WorkerPool workerPool;
+	// Never started, runs everything on calling thread, used for cloths that are spread over threads whole
+	WorkerPool serialPool;
+	ClothKernels kernels;
+	Statistics statistics;
+	std::vector<Workspace> workspaces;
+	std::vector<Int32> spreadCloths;
+	// Temporaries of build, reset by every use and kept between them
+	Arena scratch;
+	ArenaArray<Int32> springOffsets; // Where rows write their springs
+	ArenaArray<Int32> unsortedIndexesA, unsortedIndexesB;
+	ArenaArray<Float32> unsortedRestLengths;
+
+	// Restarts pool when settings.threadsCount changed
+	void startup_workers();
+	void step_cloth(WorkerPool& pool, Workspace& workspace, ClothData& clothData, Mesh& mesh);
+	void step_substep(WorkerPool& pool, Workspace& workspace, ClothData& clothData, Mesh& mesh, Float32 deltaTime);
+	// Splits of settings.deltaTime that keep cloth under its stability limits, reads speeds of last external forces pass
+	Int32 get_substeps_count(const ClothData& clothData, const Workspace& workspace) const;
+	ClothView get_view(ClothData& clothData, Workspace& workspace);
+	void compute_internal_forces(WorkerPool& pool, const ClothView& view, const ClothData& clothData, Workspace& workspace);
+	void compute_external_forces(WorkerPool& pool, const ClothData& clothData, Workspace& workspace);
+	glm::vec3 get_fluid_normal() const;
+	void integrate(WorkerPool& pool, const ClothView& view, const ClothData& clothData, Float32 deltaTime);
+	// Mass points with non-finite state are moved back to their mesh positions of previous step, returns their count
+	Int32 write_mesh_positions(WorkerPool& pool, ClothData& clothData, Mesh& mesh);
+	void allocate_cloth(ClothData& clothData, Int32 springsCount, bool isReordered);
+	void calculate_point_order(ClothData& clothData);
+	void calculate_mass_points(const Mesh& mesh, ClothData& clothData, Float32 massOfPoint);
+	void attach_mass_point(ClothData& clothData, Int32 index);
+	void calculate_positions(Mesh& mesh, const ClothData& clothData, const glm::vec2& initialLengths, const glm::vec3& origin);
+	void calculate_indexes(Mesh& mesh, const ClothData& clothData);
+	void calculate_uvs(Mesh& mesh, const ClothData& clothData);
+	// Exact counts of springs of every row, prefix summed into springOffsets
+	void calculate_spring_offsets(const ClothData& clothData, bool isPresorted);
+	// Springs go to scratch in grid order, batches copy them into cloth sorted by color
+	void calculate_springs(const Mesh& mesh, const ClothData& clothData);
+	void calculate_spring_batches(ClothData& clothData, Float32 stiffness);
+	void calculate_presorted_springs(const Mesh& mesh, ClothData& clothData, Float32 stiffness);
+	void sort_springs_by_point(ClothData& clothData);
+};
@@ -0,0 +1,252 @@
+#include "collider_bvh.hpp"
+
+#include <algorithm>
+
+#include "geometry.hpp"
+
+constexpr Int32 BINS_COUNT = 16;
+constexpr Int32 MAX_LEAF_SIZE = 8;
+// Cost of visiting inner node relative to testing one triangle
+constexpr Float32 TRAVERSAL_COST = 1.0f;
+constexpr Int32 MAX_STACK_SIZE = 64;
+// Traversal keeps at most one pending sibling per level and two children of node it just popped, so nodes past this
+// depth are leaves regardless of their size. Clustered or degenerate meshes would otherwise overflow traversal stack
+constexpr Int32 MAX_DEPTH = MAX_STACK_SIZE - 1;
+
+namespace
+{
+	Float32 get_area(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		const glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	Float32 get_distance2(const ColliderBvh::Node& node, const glm::vec3& point)
+	{
+		const glm::vec3 outside = glm::max(glm::max(node.boundsMin - point, point - node.boundsMax), glm::vec3(0.0f));
+		return glm::dot(outside, outside);
+	}
+
+	struct Bin
+	{
+		glm::vec3 boundsMin = glm::vec3(std::numeric_limits<Float32>::max());
+		glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<Float32>::max());
+		Int32 count = 0;
+	};
+}
+
+void ColliderBvh::build(std::vector<Triangle>&& newTriangles)
+{
+	clear();
+	if (newTriangles.empty())
+	{
+		return;
+	}
+
+	const Int32 trianglesCount = Int32(newTriangles.size());
+	indexes.resize(trianglesCount);
+	centroids.resize(trianglesCount);
+	boundsMin.resize(trianglesCount);
+	boundsMax.resize(trianglesCount);
+	for (Int32 i = 0; i < trianglesCount; ++i)
+	{
+		const Triangle &triangle = newTriangles[i];
+		indexes[i]	 = i;
+		boundsMin[i] = glm::min(glm::min(triangle.a, triangle.b), triangle.c);
+		boundsMax[i] = glm::max(glm::max(triangle.a, triangle.b), triangle.c);
+		centroids[i] = (triangle.a + triangle.b + triangle.c) / 3.0f;
+	}
+
+	nodes.reserve(2 * trianglesCount);
+	build_node(0, trianglesCount, 0);
+
+	triangles.resize(trianglesCount);
+	for (Int32 i = 0; i < trianglesCount; ++i)
+	{
+		triangles[i] = newTriangles[indexes[i]];
+	}
+
+	std::vector<Int32>().swap(indexes);
+	std::vector<glm::vec3>().swap(centroids);
+	std::vector<glm::vec3>().swap(boundsMin);
+	std::vector<glm::vec3>().swap(boundsMax);
+}
+
+bool ColliderBvh::find_closest(const glm::vec3& point, Float32 maxDistance, glm::vec3& closest, glm::vec3& normal) const
+{
+	if (nodes.empty() || get_distance2(nodes[0], point) > maxDistance * maxDistance)
+	{
+		return false;
+	}
+
+	// Closer child is visited first, so search radius shrinks fast
+	Int32 stack[MAX_STACK_SIZE];
+	Int32 stackSize = 0;
+	stack[stackSize++] = 0;
+	Float32 bestDistance2 = maxDistance * maxDistance;
+	Float32 bestSide = -std::numeric_limits<Float32>::max();
+	bool isFound = false;
+
+	while (stackSize > 0)
+	{
+		const Node &node = nodes[stack[--stackSize]];
+		if (get_distance2(node, point) > bestDistance2)
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (Int32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				const Triangle &triangle = triangles[i];
+				const glm::vec3 barycentric = closest_on_triangle(point, triangle.a, triangle.b, triangle.c);
+				const glm::vec3 candidate = barycentric.x * triangle.a + barycentric.y * triangle.b + barycentric.z * triangle.c;
+				const Float32 distance2 = glm::dot(point - candidate, point - candidate);
+				// On shared edges and vertices the face point is most in front of decides on which side it is
+				const Float32 side = glm::dot(point - candidate, triangle.normal);
+				const Float32 tolerance = glm::epsilon<Float32>() * glm::max(bestDistance2, 1.0f);
+				if (distance2 < bestDistance2 - tolerance || (distance2 <= bestDistance2 + tolerance && side > bestSide))
+				{
+					bestDistance2 = glm::min(distance2, bestDistance2);
+					bestSide = side;
+					closest	 = candidate;
+					normal	 = triangle.normal;
+					isFound	 = true;
+				}
+			}
+			continue;
+		}
+
+		const Int32 first  = Int32(&node - nodes.data()) + 1;
+		const Int32 second = node.offset;
+		const bool isFirstCloser = get_distance2(nodes[first], point) <= get_distance2(nodes[second], point);
+		stack[stackSize++] = isFirstCloser ? second : first;
+		stack[stackSize++] = isFirstCloser ? first : second;
+	}
+	return isFound;
+}
+
+Int32 ColliderBvh::get_nodes_count() const
+{
+	return Int32(nodes.size());
+}
+
+Int32 ColliderBvh::get_triangles_count() const
+{
+	return Int32(triangles.size());
+}
+
+void ColliderBvh::clear()
+{
+	nodes.clear();
+	triangles.clear();
+}
+
+void ColliderBvh::build_node(Int32 begin, Int32 end, Int32 depth)
+{
+	const Int32 nodeIndex = Int32(nodes.size());
+	nodes.emplace_back();
+
+	glm::vec3 nodeMin(std::numeric_limits<Float32>::max()), nodeMax(-std::numeric_limits<Float32>::max());
+	glm::vec3 centroidMin = nodeMin, centroidMax = nodeMax;
+	for (Int32 i = begin; i < end; ++i)
+	{
+		const Int32 index = indexes[i];
+		nodeMin		= glm::min(nodeMin, boundsMin[index]);
+		nodeMax		= glm::max(nodeMax, boundsMax[index]);
+		centroidMin = glm::min(centroidMin, centroids[index]);
+		centroidMax = glm::max(centroidMax, centroids[index]);
+	}
+	nodes[nodeIndex].boundsMin = nodeMin;
+	nodes[nodeIndex].boundsMax = nodeMax;
+
+	const Int32 count = end - begin;
+	const auto make_leaf = [&]()
+	{
+		nodes[nodeIndex].offset = begin;
+		nodes[nodeIndex].count	= count;
+	};
+	if (count <= 2 || depth >= MAX_DEPTH)
+	{
+		make_leaf();
+		return;
+	}
+
+	// Binned SAH, cost of split is relative to area of this node, leaf costs one per triangle
+	Int32 bestAxis = -1, bestSplit = 0;
+	Float32 bestCost = std::numeric_limits<Float32>::max();
+	const Float32 nodeArea = glm::max(get_area(nodeMin, nodeMax), std::numeric_limits<Float32>::min());
+	for (Int32 axis = 0; axis < 3; ++axis)
+	{
+		const Float32 extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		Bin bins[BINS_COUNT];
+		const Float32 scale = Float32(BINS_COUNT) / extent;
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 index = indexes[i];
+			Bin &bin = bins[glm::min(Int32((centroids[index][axis] - centroidMin[axis]) * scale), BINS_COUNT - 1)];
+			bin.boundsMin = glm::min(bin.boundsMin, boundsMin[index]);
+			bin.boundsMax = glm::max(bin.boundsMax, boundsMax[index]);
+			bin.count++;
+		}
+
+		// Right sides are swept from the end, left sides from the start
+		Float32 rightAreas[BINS_COUNT];
+		Int32 rightCounts[BINS_COUNT];
+		Bin right;
+		for (Int32 i = BINS_COUNT - 1; i > 0; --i)
+		{
+			right.boundsMin = glm::min(right.boundsMin, bins[i].boundsMin);
+			right.boundsMax = glm::max(right.boundsMax, bins[i].boundsMax);
+			right.count += bins[i].count;
+			rightAreas[i]  = get_area(right.boundsMin, right.boundsMax);
+			rightCounts[i] = right.count;
+		}
+		Bin left;
+		for (Int32 i = 0; i + 1 < BINS_COUNT; ++i)
+		{
+			left.boundsMin = glm::min(left.boundsMin, bins[i].boundsMin);
+			left.boundsMax = glm::max(left.boundsMax, bins[i].boundsMax);
+			left.count += bins[i].count;
+			if (left.count == 0 || rightCounts[i + 1] == 0)
+			{
+				continue;
+			}
+			const Float32 cost = TRAVERSAL_COST + (get_area(left.boundsMin, left.boundsMax) * Float32(left.count)
+												   + rightAreas[i + 1] * Float32(rightCounts[i + 1])) / nodeArea;
+			if (cost < bestCost)
+			{
+				bestCost  = cost;
+				bestAxis  = axis;
+				bestSplit = i + 1;
+			}
+		}
+	}
+
+	if (bestAxis < 0 || (bestCost >= Float32(count) && count <= MAX_LEAF_SIZE))
+	{
+		make_leaf();
+		return;
+	}
+
+	const Float32 scale = Float32(BINS_COUNT) / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	Int32 middle = Int32(std::partition(indexes.begin() + begin, indexes.begin() + end, [&](Int32 index)
+	{
+		return glm::min(Int32((centroids[index][bestAxis] - centroidMin[bestAxis]) * scale), BINS_COUNT - 1) < bestSplit;
+	}) - indexes.begin());
+	if (middle == begin || middle == end)
+	{
+		middle = begin + count / 2;
+	}
+
+	build_node(begin, middle, depth + 1);
+	nodes[nodeIndex].offset = Int32(nodes.size());
+	nodes[nodeIndex].count	= 0;
+	build_node(middle, end, depth + 1);
+}
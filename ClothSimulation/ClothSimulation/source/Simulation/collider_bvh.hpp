@@ -0,0 +1,42 @@
+#pragma once
+
+/** Bounding volume hierarchy over static triangles, built with binned SAH into depth first array of nodes */
+class ColliderBvh
+{
+public:
+	// 32 bytes, so two nodes share cache line and first child is right after its parent
+	struct Node
+	{
+		glm::vec3 boundsMin;
+		Int32 offset; // First triangle of leaf, second child of inner node
+		glm::vec3 boundsMax;
+		Int32 count;  // Triangles of leaf, zero for inner node
+	};
+
+	struct Triangle
+	{
+		glm::vec3 a, b, c;
+		glm::vec3 normal; // Points outside of mesh, counter clockwise winding
+	};
+
+	// Triangles are reordered, so leaves reference continuous ranges
+	void build(std::vector<Triangle>&& newTriangles);
+	// Closest point of triangles not further than maxDistance, returns false if there is none
+	bool find_closest(const glm::vec3& point, Float32 maxDistance, glm::vec3& closest, glm::vec3& normal) const;
+
+	Int32 get_nodes_count() const;
+	Int32 get_triangles_count() const;
+	void clear();
+
+private:
+	std::vector<Node> nodes;
+	std::vector<Triangle> triangles;
+
+	// Build only, centroids and bounds of triangles in order of indexes
+	std::vector<Int32> indexes;
+	std::vector<glm::vec3> centroids;
+	std::vector<glm::vec3> boundsMin, boundsMax;
+
+	// Nodes deeper than traversal stack allows are made leaves
+	void build_node(Int32 begin, Int32 end, Int32 depth);
+};
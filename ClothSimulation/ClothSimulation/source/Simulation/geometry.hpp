@@ -0,0 +1,88 @@
+#pragma once
+
+// Closest point queries shared by collision passes
+
+// Closest point on triangle abc to point p as barycentric coordinates, Ericson - Real-Time Collision Detection 5.1.5
+inline glm::vec3 closest_on_triangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	const glm::vec3 ab = b - a;
+	const glm::vec3 ac = c - a;
+	const glm::vec3 ap = p - a;
+	const Float32 d1 = glm::dot(ab, ap);
+	const Float32 d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return { 1.0f, 0.0f, 0.0f };
+	}
+
+	const glm::vec3 bp = p - b;
+	const Float32 d3 = glm::dot(ab, bp);
+	const Float32 d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return { 0.0f, 1.0f, 0.0f };
+	}
+
+	const Float32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		const Float32 v = d1 / (d1 - d3);
+		return { 1.0f - v, v, 0.0f };
+	}
+
+	const glm::vec3 cp = p - c;
+	const Float32 d5 = glm::dot(ab, cp);
+	const Float32 d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return { 0.0f, 0.0f, 1.0f };
+	}
+
+	const Float32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		const Float32 w = d2 / (d2 - d6);
+		return { 1.0f - w, 0.0f, w };
+	}
+
+	const Float32 va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		const Float32 w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return { 0.0f, 1.0f - w, w };
+	}
+
+	const Float32 denominator = 1.0f / (va + vb + vc);
+	const Float32 v = vb * denominator;
+	const Float32 w = vc * denominator;
+	return { 1.0f - v - w, v, w };
+}
+
+// Parameters of closest points of segments p1q1 and p2q2, Ericson - Real-Time Collision Detection 5.1.9
+inline glm::vec2 closest_on_segments(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2)
+{
+	const glm::vec3 d1 = q1 - p1;
+	const glm::vec3 d2 = q2 - p2;
+	const glm::vec3 r = p1 - p2;
+	const Float32 a = glm::dot(d1, d1);
+	const Float32 e = glm::dot(d2, d2);
+	const Float32 f = glm::dot(d2, r);
+	const Float32 c = glm::dot(d1, r);
+	const Float32 b = glm::dot(d1, d2);
+	const Float32 denominator = a * e - b * b;
+
+	// Springs never have zero length, so only parallel segments need special case
+	Float32 s = denominator > glm::epsilon<Float32>() * a * e ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+	Float32 t = (b * s + f) / e;
+	if (t < 0.0f)
+	{
+		t = 0.0f;
+		s = glm::clamp(-c / a, 0.0f, 1.0f);
+	}
+	else if (t > 1.0f)
+	{
+		t = 1.0f;
+		s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+	}
+	return { s, t };
+}
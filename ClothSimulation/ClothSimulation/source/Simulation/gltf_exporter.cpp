@@ -0,0 +1,290 @@
+#include "gltf_exporter.hpp"
+
+#include <filesystem>
+
+#include "../Common/mesh.hpp"
+
+namespace
+{
+	constexpr Int32 GLTF_UNSIGNED_INT = 5125;
+	constexpr Int32 GLTF_FLOAT		  = 5126;
+	constexpr Int32 GLTF_ARRAY_BUFFER		  = 34962;
+	constexpr Int32 GLTF_ELEMENT_ARRAY_BUFFER = 34963;
+
+	std::string format_vec3(const glm::vec3& vector)
+	{
+		return fmt::format("[{},{},{}]", vector.x, vector.y, vector.z);
+	}
+
+	void compute_bounds(glm::vec3& min, glm::vec3& max, const glm::vec3* positions, Int64 count)
+	{
+		min = glm::vec3(std::numeric_limits<Float32>::max());
+		max = glm::vec3(-std::numeric_limits<Float32>::max());
+		for (Int64 i = 0; i < count; ++i)
+		{
+			min = glm::min(min, positions[i]);
+			max = glm::max(max, positions[i]);
+		}
+	}
+}
+
+GltfExporter::~GltfExporter()
+{
+	close();
+}
+
+bool GltfExporter::open(const std::string& filePath, const std::vector<Mesh*>& meshes)
+{
+	close();
+	if (meshes.empty())
+	{
+		SPDLOG_ERROR("Nothing to export, there are no meshes.");
+		return false;
+	}
+
+	gltfPath = filePath;
+	binPath	 = std::filesystem::path(filePath).replace_extension(".bin").string();
+	binFile.open(binPath, std::ios::binary | std::ios::trunc);
+	if (!binFile)
+	{
+		SPDLOG_ERROR("Failed to open glTF buffer file for writing: {}", binPath);
+		return false;
+	}
+	binSize = 0;
+
+	vertexCounts.clear();
+	indexCounts.clear();
+	hasUvs.clear();
+	baseOffsets.clear();
+	baseBounds.clear();
+	basePositions.clear();
+	baseNormals.clear();
+	frameTimes.clear();
+	frameBounds.clear();
+	frameSize = 0;
+	for (const Mesh *mesh : meshes)
+	{
+		const Int64 verticesCount = Int64(mesh->positions.size());
+		vertexCounts.emplace_back(verticesCount);
+		indexCounts.emplace_back(Int64(mesh->indexes.size()));
+		hasUvs.emplace_back(Int64(mesh->uvs.size()) == verticesCount);
+		baseOffsets.emplace_back(binSize);
+
+		Bounds bounds;
+		compute_bounds(bounds.min, bounds.max, mesh->positions.data(), verticesCount);
+		baseBounds.emplace_back(bounds);
+		basePositions.insert(basePositions.end(), mesh->positions.begin(), mesh->positions.end());
+		baseNormals.insert(baseNormals.end(), mesh->normals.begin(), mesh->normals.end());
+		baseNormals.resize(basePositions.size(), glm::vec3(0.0f));
+
+		write(mesh->indexes.data(), indexCounts.back() * sizeof(UInt32));
+		write(mesh->positions.data(), verticesCount * sizeof(glm::vec3));
+		write(baseNormals.data() + basePositions.size() - verticesCount, verticesCount * sizeof(glm::vec3));
+		if (hasUvs.back())
+		{
+			write(mesh->uvs.data(), verticesCount * sizeof(glm::vec2));
+		}
+		frameSize += 2 * verticesCount * sizeof(glm::vec3);
+	}
+	baseSize = binSize;
+	frameDifferences.resize(basePositions.size());
+	return bool(binFile);
+}
+
+void GltfExporter::add_frame(Float32 time, const std::vector<Mesh*>& meshes)
+{
+	if (!is_open())
+	{
+		return;
+	}
+	if (meshes.size() != vertexCounts.size())
+	{
+		SPDLOG_ERROR("Exported frame has {} meshes, export has {}.", meshes.size(), vertexCounts.size());
+		return;
+	}
+	for (Int32 i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i]->positions.size() != vertexCounts[i] || meshes[i]->normals.size() != vertexCounts[i])
+		{
+			SPDLOG_ERROR("Exported mesh {} changed its vertex count.", i);
+			return;
+		}
+	}
+	// Animation input has to grow strictly
+	if (!frameTimes.empty() && time <= frameTimes.back())
+	{
+		return;
+	}
+
+	frameTimes.emplace_back(time);
+	Int64 firstVertex = 0;
+	for (const Mesh *mesh : meshes)
+	{
+		const Int64 verticesCount = Int64(mesh->positions.size());
+		glm::vec3 *differences = frameDifferences.data() + firstVertex;
+		for (Int64 i = 0; i < verticesCount; ++i)
+		{
+			differences[i] = mesh->positions[i] - basePositions[firstVertex + i];
+		}
+		Bounds bounds;
+		compute_bounds(bounds.min, bounds.max, differences, verticesCount);
+		frameBounds.emplace_back(bounds);
+		write(differences, verticesCount * sizeof(glm::vec3));
+
+		for (Int64 i = 0; i < verticesCount; ++i)
+		{
+			differences[i] = mesh->normals[i] - baseNormals[firstVertex + i];
+		}
+		write(differences, verticesCount * sizeof(glm::vec3));
+		firstVertex += verticesCount;
+	}
+}
+
+bool GltfExporter::close()
+{
+	if (!is_open())
+	{
+		return true;
+	}
+
+	// Keyframe i has weight one for target i only, rows are written one by one so N^2 weights never are in memory
+	const Int64 framesCount	  = Int64(frameTimes.size());
+	const Int64 timesOffset	  = binSize;
+	const Float32 firstTime	  = framesCount > 0 ? frameTimes[0] : 0.0f;
+	for (Float32 &time : frameTimes)
+	{
+		time -= firstTime;
+	}
+	write(frameTimes.data(), framesCount * sizeof(Float32));
+	const Int64 weightsOffset = binSize;
+	std::vector<Float32> weights(framesCount, 0.0f);
+	for (Int64 i = 0; i < framesCount; ++i)
+	{
+		weights[i] = 1.0f;
+		write(weights.data(), framesCount * sizeof(Float32));
+		weights[i] = 0.0f;
+	}
+	bool isWritten = bool(binFile);
+	binFile.close();
+
+	std::ofstream gltfFile(gltfPath, std::ios::trunc);
+	gltfFile << build_json(timesOffset, weightsOffset);
+	isWritten = isWritten && bool(gltfFile);
+	if (!isWritten)
+	{
+		SPDLOG_ERROR("Failed to write glTF export {}.", gltfPath);
+	}
+
+	basePositions.clear();
+	basePositions.shrink_to_fit();
+	baseNormals.clear();
+	baseNormals.shrink_to_fit();
+	frameDifferences.clear();
+	frameDifferences.shrink_to_fit();
+	return isWritten;
+}
+
+bool GltfExporter::is_open() const
+{
+	return binFile.is_open();
+}
+
+Int64 GltfExporter::get_frames_count() const
+{
+	return Int64(frameTimes.size());
+}
+
+Int64 GltfExporter::get_bytes() const
+{
+	return binSize;
+}
+
+void GltfExporter::write(const void* data, Int64 size)
+{
+	binFile.write(reinterpret_cast<const char*>(data), size);
+	binSize += size;
+}
+
+std::string GltfExporter::build_json(Int64 timesOffset, Int64 weightsOffset) const
+{
+	std::string bufferViews, accessors;
+	Int32 accessorsCount = 0;
+	// Every accessor gets its own buffer view, returns index of accessor
+	const auto add_accessor = [&](Int64 offset, Int64 size, Int32 componentType, Int64 count, const char* type, Int32 target,
+								  const std::string& min, const std::string& max)
+	{
+		const std::string separator = accessorsCount > 0 ? "," : "";
+		bufferViews += separator + fmt::format(R"({{"buffer":0,"byteOffset":{},"byteLength":{})", offset, size)
+					   + (target != 0 ? fmt::format(R"(,"target":{}}})", target) : "}");
+		accessors += separator + fmt::format(R"({{"bufferView":{},"componentType":{},"count":{},"type":"{}")", accessorsCount,
+											 componentType, count, type)
+					 + (min.empty() ? "}" : fmt::format(R"(,"min":{},"max":{}}})", min, max));
+		return accessorsCount++;
+	};
+
+	const Int64 framesCount = Int64(frameTimes.size());
+	const Int64 meshesCount = Int64(vertexCounts.size());
+	std::string nodes, meshes, channels;
+	Int64 frameOffset = 0; // Of mesh inside of frame
+	for (Int64 i = 0; i < meshesCount; ++i)
+	{
+		const Int64 verticesCount = vertexCounts[i];
+		const Int64 vec3Size	  = verticesCount * sizeof(glm::vec3);
+		Int64 offset = baseOffsets[i];
+		const Int32 indexesAccessor = add_accessor(offset, indexCounts[i] * sizeof(UInt32), GLTF_UNSIGNED_INT, indexCounts[i],
+												   "SCALAR", GLTF_ELEMENT_ARRAY_BUFFER, "", "");
+		offset += indexCounts[i] * sizeof(UInt32);
+		const Int32 positionsAccessor = add_accessor(offset, vec3Size, GLTF_FLOAT, verticesCount, "VEC3", GLTF_ARRAY_BUFFER,
+													 format_vec3(baseBounds[i].min), format_vec3(baseBounds[i].max));
+		offset += vec3Size;
+		std::string attributes = fmt::format(R"("POSITION":{},"NORMAL":{})", positionsAccessor,
+											 add_accessor(offset, vec3Size, GLTF_FLOAT, verticesCount, "VEC3", GLTF_ARRAY_BUFFER, "", ""));
+		offset += vec3Size;
+		if (hasUvs[i])
+		{
+			attributes += fmt::format(R"(,"TEXCOORD_0":{})", add_accessor(offset, verticesCount * sizeof(glm::vec2), GLTF_FLOAT,
+																		  verticesCount, "VEC2", GLTF_ARRAY_BUFFER, "", ""));
+		}
+
+		std::string targets, defaultWeights;
+		for (Int64 frame = 0; frame < framesCount; ++frame)
+		{
+			const Bounds &bounds = frameBounds[frame * meshesCount + i];
+			const Int64 targetOffset = baseSize + frame * frameSize + frameOffset;
+			const Int32 positionsTarget = add_accessor(targetOffset, vec3Size, GLTF_FLOAT, verticesCount, "VEC3", GLTF_ARRAY_BUFFER,
+													   format_vec3(bounds.min), format_vec3(bounds.max));
+			const Int32 normalsTarget = add_accessor(targetOffset + vec3Size, vec3Size, GLTF_FLOAT, verticesCount, "VEC3",
+													 GLTF_ARRAY_BUFFER, "", "");
+			targets += (frame > 0 ? "," : "") + fmt::format(R"({{"POSITION":{},"NORMAL":{}}})", positionsTarget, normalsTarget);
+			defaultWeights += frame > 0 ? ",0" : "0";
+		}
+		frameOffset += 2 * vec3Size;
+
+		const std::string separator = i > 0 ? "," : "";
+		nodes += separator + fmt::format(R"({{"name":"Cloth{}","mesh":{}}})", i, i);
+		meshes += separator + fmt::format(R"({{"name":"Cloth{}","primitives":[{{"attributes":{{{}}},"indices":{},"mode":4)", i,
+										  attributes, indexesAccessor)
+				  + (framesCount > 0 ? fmt::format(R"(,"targets":[{}]}}],"weights":[{}]}})", targets, defaultWeights) : "}]}");
+		channels += separator + fmt::format(R"({{"sampler":0,"target":{{"node":{},"path":"weights"}}}})", i);
+	}
+
+	std::string animations;
+	if (framesCount > 0)
+	{
+		const Int32 timesAccessor = add_accessor(timesOffset, framesCount * sizeof(Float32), GLTF_FLOAT, framesCount, "SCALAR", 0,
+												 fmt::format("[{}]", frameTimes.front()), fmt::format("[{}]", frameTimes.back()));
+		const Int32 weightsAccessor = add_accessor(weightsOffset, framesCount * framesCount * sizeof(Float32), GLTF_FLOAT,
+												   framesCount * framesCount, "SCALAR", 0, "", "");
+		animations = fmt::format(R"(,"animations":[{{"name":"Simulation","channels":[{}],"samplers":[{{"input":{},"output":{},"interpolation":"LINEAR"}}]}}])",
+								 channels, timesAccessor, weightsAccessor);
+	}
+
+	std::string sceneNodes;
+	for (Int64 i = 0; i < meshesCount; ++i)
+	{
+		sceneNodes += (i > 0 ? "," : "") + std::to_string(i);
+	}
+	return fmt::format(R"({{"asset":{{"version":"2.0","generator":"ClothSimulation"}},"scene":0,"scenes":[{{"nodes":[{}]}}],)"
+					   R"("nodes":[{}],"meshes":[{}]{},"buffers":[{{"uri":"{}","byteLength":{}}}],"bufferViews":[{}],"accessors":[{}]}})",
+					   sceneNodes, nodes, meshes, animations, std::filesystem::path(binPath).filename().string(), binSize, bufferViews, accessors);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <fstream>
+
+struct Mesh;
+
+/**
+ * Exports simulated meshes as animated glTF. Every added frame becomes morph target of each mesh and is appended to
+ * .bin file right away, only bounds of frames stay in memory. Animation sets weight of frame's target to one at its time,
+ * linear interpolation blends neighbouring frames. Scene json is written when export is closed
+ */
+class GltfExporter
+{
+public:
+	GltfExporter() = default;
+	GltfExporter(GltfExporter&) = delete;
+	~GltfExporter();
+
+	// Meshes in their current state are base geometry, .bin file is placed next to .gltf one
+	bool open(const std::string& filePath, const std::vector<Mesh*>& meshes);
+	void add_frame(Float32 time, const std::vector<Mesh*>& meshes);
+	// Writes animation and scene json, returns false if any write failed
+	bool close();
+
+	bool is_open() const;
+	Int64 get_frames_count() const;
+	Int64 get_bytes() const;
+
+private:
+	struct Bounds
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	std::string gltfPath;
+	std::string binPath;
+	std::ofstream binFile;
+	Int64 binSize = 0;
+
+	std::vector<Int64> vertexCounts;
+	std::vector<Int64> indexCounts;
+	std::vector<bool> hasUvs;
+	std::vector<Int64> baseOffsets; // Indexes, positions, normals and uvs of mesh i are stored from baseOffsets[i]
+	std::vector<Bounds> baseBounds;
+	std::vector<glm::vec3> basePositions; // All meshes, targets are differences from them
+	std::vector<glm::vec3> baseNormals;
+	Int64 baseSize	= 0;
+	Int64 frameSize = 0; // Position and normal differences of all meshes
+
+	std::vector<Float32> frameTimes;
+	std::vector<Bounds> frameBounds;		// Position differences, frame * meshes count + mesh
+	std::vector<glm::vec3> frameDifferences; // Reused for every frame
+
+	void write(const void* data, Int64 size);
+	std::string build_json(Int64 timesOffset, Int64 weightsOffset) const;
+};
@@ -0,0 +1,332 @@
+#include "implicit_integrator.hpp"
+
+#include "../Common/handle.hpp"
+#include "../Common/worker_pool.hpp"
+#include "../Common/cloth_data.hpp"
+
+Int32 ImplicitIntegrator::integrate(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+									const Parameters& parameters)
+{
+	const Int32 pointsCount = clothData.get_padded_count();
+	const Float32 deltaTime = parameters.deltaTime;
+	resize(pointsCount, Int32(clothData.restLengths.size()), workerPool.get_threads_count());
+
+	prepare_springs(workerPool, view, clothData, deltaTime);
+	compute_preconditioner(workerPool, view, clothData, parameters);
+
+	// Previous velocity change is initial guess, residual is b - A * dv where b = h * f + h^2 * df/dx * v,
+	// spring part of b is gathered in products together with A * dv
+	multiply(workerPool, clothData, parameters, deltaVelocities);
+	add_spring_products(workerPool, clothData, view.velocitiesX, view.velocitiesY, view.velocitiesZ);
+
+	reset_partial_sums();
+	workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+	{
+		glm::vec3 sum(0.0f);
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Float32 simulated = view.inverseMasses[i] > 0.0f ? 1.0f : 0.0f;
+			const glm::vec3 impulse = deltaTime * simulated * glm::vec3(view.forcesX[i], view.forcesY[i], view.forcesZ[i]);
+			const glm::vec3 residual = impulse - simulated * glm::vec3(products.x[i], products.y[i], products.z[i]);
+			const glm::vec3 precondition(inverseDiagonal.x[i] * residual.x,
+										 inverseDiagonal.y[i] * residual.y,
+										 inverseDiagonal.z[i] * residual.z);
+			residuals.x[i] = residual.x;
+			residuals.y[i] = residual.y;
+			residuals.z[i] = residual.z;
+			searchDirections.x[i] = precondition.x;
+			searchDirections.y[i] = precondition.y;
+			searchDirections.z[i] = precondition.z;
+			sum += glm::vec3(glm::dot(residual, precondition), glm::dot(residual, residual), glm::dot(impulse, impulse));
+		}
+		partialSums[threadIndex].sum += sum;
+	});
+
+	glm::vec3 sums = sum_partial_sums();
+	Float32 residualDotPreconditioned = sums.x;
+	// Warm started initial residual is already small, so progress is measured against h * f. Without any force there is
+	// nothing to compare with, then initial residual is the reference
+	const Float32 referenceNorm2 = sums.z > 0.0f ? sums.z : sums.y;
+	const Float32 threshold = parameters.tolerance * parameters.tolerance * referenceNorm2;
+
+	Int32 iteration = 0;
+	for (; iteration < parameters.maxIterations && sums.y > threshold && residualDotPreconditioned > 0.0f; ++iteration)
+	{
+		multiply(workerPool, clothData, parameters, searchDirections);
+
+		reset_partial_sums();
+		workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+		{
+			Float32 sum = 0.0f;
+			for (Int32 i = begin; i < end; ++i)
+			{
+				sum += searchDirections.x[i] * products.x[i]
+					 + searchDirections.y[i] * products.y[i]
+					 + searchDirections.z[i] * products.z[i];
+			}
+			partialSums[threadIndex].sum.x += sum;
+		});
+		const Float32 curvature = sum_partial_sums().x;
+		if (curvature <= 0.0f)
+		{
+			break;
+		}
+		const Float32 alpha = residualDotPreconditioned / curvature;
+
+		reset_partial_sums();
+		workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+		{
+			glm::vec2 sum(0.0f);
+			for (Int32 i = begin; i < end; ++i)
+			{
+				const Float32 simulated = view.inverseMasses[i] > 0.0f ? 1.0f : 0.0f;
+				deltaVelocities.x[i] += alpha * searchDirections.x[i];
+				deltaVelocities.y[i] += alpha * searchDirections.y[i];
+				deltaVelocities.z[i] += alpha * searchDirections.z[i];
+				residuals.x[i] -= alpha * simulated * products.x[i];
+				residuals.y[i] -= alpha * simulated * products.y[i];
+				residuals.z[i] -= alpha * simulated * products.z[i];
+				preconditioned.x[i] = inverseDiagonal.x[i] * residuals.x[i];
+				preconditioned.y[i] = inverseDiagonal.y[i] * residuals.y[i];
+				preconditioned.z[i] = inverseDiagonal.z[i] * residuals.z[i];
+				sum.x += residuals.x[i] * preconditioned.x[i]
+					   + residuals.y[i] * preconditioned.y[i]
+					   + residuals.z[i] * preconditioned.z[i];
+				sum.y += residuals.x[i] * residuals.x[i]
+					   + residuals.y[i] * residuals.y[i]
+					   + residuals.z[i] * residuals.z[i];
+			}
+			partialSums[threadIndex].sum += glm::vec3(sum, 0.0f);
+		});
+
+		sums = sum_partial_sums();
+		const Float32 beta = sums.x / residualDotPreconditioned;
+		residualDotPreconditioned = sums.x;
+
+		workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+		{
+			for (Int32 i = begin; i < end; ++i)
+			{
+				searchDirections.x[i] = preconditioned.x[i] + beta * searchDirections.x[i];
+				searchDirections.y[i] = preconditioned.y[i] + beta * searchDirections.y[i];
+				searchDirections.z[i] = preconditioned.z[i] + beta * searchDirections.z[i];
+			}
+		});
+	}
+
+	workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			view.velocitiesX[i] += deltaVelocities.x[i];
+			view.velocitiesY[i] += deltaVelocities.y[i];
+			view.velocitiesZ[i] += deltaVelocities.z[i];
+			view.positionsX[i]	+= view.velocitiesX[i] * deltaTime;
+			view.positionsY[i]	+= view.velocitiesY[i] * deltaTime;
+			view.positionsZ[i]	+= view.velocitiesZ[i] * deltaTime;
+		}
+	});
+
+	return iteration;
+}
+
+void ImplicitIntegrator::reset_initial_guess()
+{
+	std::fill(deltaVelocities.x.begin(), deltaVelocities.x.end(), 0.0f);
+	std::fill(deltaVelocities.y.begin(), deltaVelocities.y.end(), 0.0f);
+	std::fill(deltaVelocities.z.begin(), deltaVelocities.z.end(), 0.0f);
+}
+
+void ImplicitIntegrator::clear()
+{
+	for (AlignedVector<Float32> *values : { &springAxesX, &springAxesY, &springAxesZ, &isotropicTerms, &directionalTerms })
+	{
+		values->clear();
+	}
+	for (Field *field : { &deltaVelocities, &residuals, &preconditioned, &searchDirections, &products, &inverseDiagonal })
+	{
+		field->x.clear();
+		field->y.clear();
+		field->z.clear();
+	}
+	partialSums.clear();
+}
+
+void ImplicitIntegrator::resize(Int32 pointsCount, Int32 springsCount, Int32 threadsCount)
+{
+	if (isotropicTerms.size() != springsCount)
+	{
+		for (AlignedVector<Float32> *values : { &springAxesX, &springAxesY, &springAxesZ, &isotropicTerms, &directionalTerms })
+		{
+			values->resize(springsCount);
+		}
+	}
+	if (residuals.x.size() != pointsCount)
+	{
+		for (Field *field : { &deltaVelocities, &residuals, &preconditioned, &searchDirections, &products, &inverseDiagonal })
+		{
+			field->x.assign(pointsCount, 0.0f);
+			field->y.assign(pointsCount, 0.0f);
+			field->z.assign(pointsCount, 0.0f);
+		}
+	}
+	partialSums.resize(threadsCount);
+}
+
+void ImplicitIntegrator::prepare_springs(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime)
+{
+	const Float32 deltaTime2 = deltaTime * deltaTime;
+	workerPool.parallel_for(Int32(clothData.restLengths.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 indexA = view.springIndexesA[i];
+			const Int32 indexB = view.springIndexesB[i];
+			const glm::vec3 spring(view.positionsX[indexB] - view.positionsX[indexA],
+								   view.positionsY[indexB] - view.positionsY[indexA],
+								   view.positionsZ[indexB] - view.positionsZ[indexA]);
+			const Float32 length2 = glm::dot(spring, spring);
+			if (length2 <= glm::epsilon<Float32>())
+			{
+				springAxesX[i] = springAxesY[i] = springAxesZ[i] = 0.0f;
+				isotropicTerms[i] = directionalTerms[i] = 0.0f;
+				continue;
+			}
+
+			// K_s = k * (u * u^T + (1 - L / l) * (I - u * u^T)), transverse term of compressed spring
+			// is negative, clamping it keeps system positive definite
+			const Float32 length = std::sqrt(length2);
+			const glm::vec3 axis = spring / length;
+			const Float32 transverse = glm::max(1.0f - view.restLengths[i] / length, 0.0f);
+			const Float32 stiffness = deltaTime2 * view.stiffnesses[i];
+			springAxesX[i]		= axis.x;
+			springAxesY[i]		= axis.y;
+			springAxesZ[i]		= axis.z;
+			isotropicTerms[i]	= stiffness * transverse;
+			directionalTerms[i] = stiffness * (1.0f - transverse);
+		}
+	});
+}
+
+void ImplicitIntegrator::compute_preconditioner(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+												const Parameters& parameters)
+{
+	// Diagonal of M - h * df/dv, then spring blocks are added and whole diagonal is inverted
+	const Float32 velocityTerm = parameters.deltaTime * parameters.damping;
+	const glm::vec3 fluidTerm = parameters.deltaTime * parameters.viscosity * parameters.fluidNormal * parameters.fluidNormal;
+	workerPool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Float32 diagonal = clothData.masses[i] + velocityTerm;
+			inverseDiagonal.x[i] = diagonal + fluidTerm.x;
+			inverseDiagonal.y[i] = diagonal + fluidTerm.y;
+			inverseDiagonal.z[i] = diagonal + fluidTerm.z;
+		}
+	});
+
+	for (Int32 batch = 0; batch + 1 < clothData.springBatchOffsets.size(); ++batch)
+	{
+		const Int32 batchBegin = clothData.springBatchOffsets[batch];
+		const Int32 batchEnd   = clothData.springBatchOffsets[batch + 1];
+		workerPool.parallel_for(batchEnd - batchBegin, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+		{
+			for (Int32 i = batchBegin + begin; i < batchBegin + end; ++i)
+			{
+				const glm::vec3 axis(springAxesX[i], springAxesY[i], springAxesZ[i]);
+				const glm::vec3 diagonal = isotropicTerms[i] + directionalTerms[i] * axis * axis;
+				for (const Int32 index : { view.springIndexesA[i], view.springIndexesB[i] })
+				{
+					inverseDiagonal.x[index] += diagonal.x;
+					inverseDiagonal.y[index] += diagonal.y;
+					inverseDiagonal.z[index] += diagonal.z;
+				}
+			}
+		});
+	}
+
+	workerPool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const bool isSimulated = view.inverseMasses[i] > 0.0f;
+			inverseDiagonal.x[i] = isSimulated ? 1.0f / inverseDiagonal.x[i] : 0.0f;
+			inverseDiagonal.y[i] = isSimulated ? 1.0f / inverseDiagonal.y[i] : 0.0f;
+			inverseDiagonal.z[i] = isSimulated ? 1.0f / inverseDiagonal.z[i] : 0.0f;
+		}
+	});
+}
+
+void ImplicitIntegrator::multiply(WorkerPool& workerPool, const ClothData& clothData, const Parameters& parameters,
+								  const Field& vector)
+{
+	// Vector is zero at attached points, so only simulated points get nonzero diagonal part
+	const Float32 velocityTerm = parameters.deltaTime * parameters.damping;
+	const Float32 fluidTerm = parameters.deltaTime * parameters.viscosity;
+	const glm::vec3 &normal = parameters.fluidNormal;
+	workerPool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 direction(vector.x[i], vector.y[i], vector.z[i]);
+			const glm::vec3 product = (clothData.masses[i] + velocityTerm) * direction
+									+ fluidTerm * glm::dot(normal, direction) * normal;
+			products.x[i] = product.x;
+			products.y[i] = product.y;
+			products.z[i] = product.z;
+		}
+	});
+
+	add_spring_products(workerPool, clothData, vector.x.data(), vector.y.data(), vector.z.data());
+}
+
+void ImplicitIntegrator::add_spring_products(WorkerPool& workerPool, const ClothData& clothData,
+											 const Float32* vectorX, const Float32* vectorY, const Float32* vectorZ)
+{
+	// Springs in one batch never share mass point, same as in force accumulation
+	for (Int32 batch = 0; batch + 1 < clothData.springBatchOffsets.size(); ++batch)
+	{
+		const Int32 batchBegin = clothData.springBatchOffsets[batch];
+		const Int32 batchEnd   = clothData.springBatchOffsets[batch + 1];
+		workerPool.parallel_for(batchEnd - batchBegin, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+		{
+			Float32 *productsX = products.x.data(), *productsY = products.y.data(), *productsZ = products.z.data();
+			for (Int32 i = batchBegin + begin; i < batchBegin + end; ++i)
+			{
+				const Int32 indexA = clothData.springIndexesA[i];
+				const Int32 indexB = clothData.springIndexesB[i];
+				const Float32 dx = vectorX[indexA] - vectorX[indexB];
+				const Float32 dy = vectorY[indexA] - vectorY[indexB];
+				const Float32 dz = vectorZ[indexA] - vectorZ[indexB];
+				const Float32 projection = directionalTerms[i] * (springAxesX[i] * dx + springAxesY[i] * dy + springAxesZ[i] * dz);
+				const Float32 px = isotropicTerms[i] * dx + projection * springAxesX[i];
+				const Float32 py = isotropicTerms[i] * dy + projection * springAxesY[i];
+				const Float32 pz = isotropicTerms[i] * dz + projection * springAxesZ[i];
+				productsX[indexA] += px;
+				productsY[indexA] += py;
+				productsZ[indexA] += pz;
+				productsX[indexB] -= px;
+				productsY[indexB] -= py;
+				productsZ[indexB] -= pz;
+			}
+		});
+	}
+}
+
+void ImplicitIntegrator::reset_partial_sums()
+{
+	for (PartialSum &partialSum : partialSums)
+	{
+		partialSum = PartialSum();
+	}
+}
+
+glm::vec3 ImplicitIntegrator::sum_partial_sums() const
+{
+	glm::vec3 sum(0.0f);
+	for (const PartialSum &partialSum : partialSums)
+	{
+		sum += partialSum.sum;
+	}
+	return sum;
+}
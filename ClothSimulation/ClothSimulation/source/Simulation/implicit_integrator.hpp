@@ -0,0 +1,63 @@
+#pragma once
+#include "../Common/aligned_allocator.hpp"
+#include "cloth_kernels.hpp"
+
+class WorkerPool;
+struct ClothData;
+
+/**
+ * Backward Euler step (Baraff-Witkin), solves (M - h * df/dv - h^2 * df/dx) dv = h * (f + h * df/dx * v)
+ * with matrix-free Jacobi preconditioned conjugate gradient, attached points are filtered out of the system
+ */
+class ImplicitIntegrator
+{
+public:
+	struct Parameters
+	{
+		Float32 deltaTime;
+		Float32 damping;
+		Float32 viscosity;
+		glm::vec3 fluidNormal;
+		Int32 maxIterations;
+		Float32 tolerance; // Residual norm relative to norm of h * f
+	};
+
+	// Forces in view have to contain all forces at current positions, returns count of CG iterations
+	Int32 integrate(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, const Parameters& parameters);
+
+	// Previous velocity change is initial guess of next solve, it has no meaning after cloth state was replaced
+	void reset_initial_guess();
+	void clear();
+
+private:
+	struct Field
+	{
+		AlignedVector<Float32> x, y, z;
+	};
+
+	// Per thread sums of dot products, aligned to avoid false sharing
+	struct alignas(64) PartialSum
+	{
+		glm::vec3 sum{ 0.0f };
+	};
+
+	// Spring stiffness matrix scaled by h^2 is isotropic * I + directional * u * u^T, u - spring axis
+	AlignedVector<Float32> springAxesX, springAxesY, springAxesZ;
+	AlignedVector<Float32> isotropicTerms, directionalTerms;
+
+	Field deltaVelocities; // Kept between steps as initial guess
+	Field residuals, preconditioned, searchDirections, products;
+	Field inverseDiagonal; // Zero for attached and padding points, this filters them out of solve
+	std::vector<PartialSum> partialSums;
+
+	void resize(Int32 pointsCount, Int32 springsCount, Int32 threadsCount);
+	void prepare_springs(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime);
+	void compute_preconditioner(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, const Parameters& parameters);
+	// Sets products = A * vector
+	void multiply(WorkerPool& workerPool, const ClothData& clothData, const Parameters& parameters, const Field& vector);
+	// Adds h^2 * K_s * (vector_a - vector_b) to products of spring point a and subtracts it from point b
+	void add_spring_products(WorkerPool& workerPool, const ClothData& clothData,
+							 const Float32* vectorX, const Float32* vectorY, const Float32* vectorZ);
+	void reset_partial_sums();
+	glm::vec3 sum_partial_sums() const;
+};
@@ -0,0 +1,106 @@
+#include "mesh_normals.hpp"
+#include "cloth_kernels.hpp"
+
+#include "../Common/worker_pool.hpp"
+#include "../Common/mesh.hpp"
+
+namespace
+{
+	// Degenerate neighbourhoods get zero normal instead of NaN
+	glm::vec3 safe_normalize(const glm::vec3& vector)
+	{
+		return vector * glm::inversesqrt(glm::max(glm::dot(vector, vector), 1.0e-30f));
+	}
+}
+
+void MeshNormals::s_update_grid(WorkerPool& pool, Mesh& mesh, const glm::ivec2& gridSize)
+{
+	mesh.normals.resize(mesh.positions.size());
+	const glm::vec3 *positions = mesh.positions.data();
+	glm::vec3 *normals = mesh.normals.data();
+	const Int32 width = gridSize.x;
+
+	// Central differences along rows and columns, edges fall back to one sided ones
+	pool.parallel_for(gridSize.y, glm::max(MIN_CHUNK_SIZE / glm::max(width, 1), 1), [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 y = begin; y < end; ++y)
+		{
+			const glm::vec3 *row  = positions + y * width;
+			const glm::vec3 *up	  = positions + glm::max(y - 1, 0) * width;
+			const glm::vec3 *down = positions + glm::min(y + 1, gridSize.y - 1) * width;
+			glm::vec3 *rowNormals = normals + y * width;
+
+			rowNormals[0] = safe_normalize(glm::cross(row[glm::min(1, width - 1)] - row[0], up[0] - down[0]));
+			for (Int32 x = 1; x < width - 1; ++x)
+			{
+				rowNormals[x] = safe_normalize(glm::cross(row[x + 1] - row[x - 1], up[x] - down[x]));
+			}
+			if (width > 1)
+			{
+				rowNormals[width - 1] = safe_normalize(glm::cross(row[width - 1] - row[width - 2], up[width - 1] - down[width - 1]));
+			}
+		}
+	});
+}
+
+void MeshNormals::build(const Mesh& mesh)
+{
+	const Int32 verticesCount  = Int32(mesh.positions.size());
+	const Int32 trianglesCount = Int32(mesh.indexes.size() / 3);
+
+	// Counting sort of triangle corners by vertex
+	triangleOffsets.assign(verticesCount + 1, 0);
+	for (Int32 i = 0; i < trianglesCount * 3; ++i)
+	{
+		triangleOffsets[mesh.indexes[i] + 1]++;
+	}
+	for (Int32 i = 0; i < verticesCount; ++i)
+	{
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+	triangles.resize(trianglesCount * 3);
+	std::vector<Int32> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (Int32 i = 0; i < trianglesCount * 3; ++i)
+	{
+		triangles[fill[mesh.indexes[i]]++] = i / 3;
+	}
+	triangleNormals.resize(trianglesCount);
+}
+
+void MeshNormals::update(WorkerPool& pool, Mesh& mesh)
+{
+	if (!is_built_for(mesh))
+	{
+		build(mesh);
+	}
+	mesh.normals.resize(mesh.positions.size());
+	const glm::vec3 *positions = mesh.positions.data();
+	const UInt32 *indexes = mesh.indexes.data();
+
+	pool.parallel_for(Int32(triangleNormals.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 &a = positions[indexes[3 * i]];
+			triangleNormals[i] = safe_normalize(glm::cross(positions[indexes[3 * i + 1]] - a, positions[indexes[3 * i + 2]] - a));
+		}
+	});
+
+	pool.parallel_for(Int32(mesh.normals.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			glm::vec3 normal(0.0f);
+			for (Int32 j = triangleOffsets[i]; j < triangleOffsets[i + 1]; ++j)
+			{
+				normal += triangleNormals[triangles[j]];
+			}
+			mesh.normals[i] = safe_normalize(normal);
+		}
+	});
+}
+
+bool MeshNormals::is_built_for(const Mesh& mesh) const
+{
+	return triangleOffsets.size() == mesh.positions.size() + 1 && triangles.size() == mesh.indexes.size() / 3 * 3;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+class WorkerPool;
+struct Mesh;
+
+/**
+ * Vertex normals recomputed by gathering, every vertex writes only its own normal, so ranges of vertices run on
+ * threads without atomics or zeroing pass. Grids use neighbours of vertex, any other mesh uses adjacency of vertices
+ * to triangles stored in compressed sparse rows
+ */
+class MeshNormals
+{
+public:
+	// Vertex x, y of grid is at y * gridSize.x + x, triangles are wound like cloth meshes (normal +z for flat cloth)
+	static void s_update_grid(WorkerPool& pool, Mesh& mesh, const glm::ivec2& gridSize);
+
+	// Has to be called again when indexes of mesh change
+	void build(const Mesh& mesh);
+	// Average of normals of triangles around every vertex
+	void update(WorkerPool& pool, Mesh& mesh);
+	bool is_built_for(const Mesh& mesh) const;
+
+private:
+	std::vector<Int32> triangleOffsets; // Triangles of vertex i are triangles[triangleOffsets[i], triangleOffsets[i + 1])
+	std::vector<Int32> triangles;
+	std::vector<glm::vec3> triangleNormals;
+};
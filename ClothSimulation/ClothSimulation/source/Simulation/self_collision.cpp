@@ -0,0 +1,446 @@
+#include "self_collision.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "../Common/handle.hpp"
+#include "../Common/worker_pool.hpp"
+#include "../Common/cloth_data.hpp"
+#include "geometry.hpp"
+
+// Queries are much heavier than per point passes, so they are split into smaller chunks
+constexpr Int32 QUERY_CHUNK_SIZE = 128;
+// Items over this many cells are overstretched and are left out of hash
+constexpr Float32 MAX_ITEM_CELLS = 512.0f;
+// Cloth with average edge stretched more is diverging, collisions would only make grid cells huge and pairs quadratic
+constexpr Float32 MAX_AVERAGE_STRETCH = 4.0f;
+// Cell coordinates are clamped to it, so far or non finite positions can't overflow integer cells
+constexpr Float32 MAX_CELL_COORDINATE = 1.0e8f;
+
+namespace
+{
+	UInt32 hash_cell(const glm::ivec3& cell, UInt32 tableMask)
+	{
+		return (UInt32(cell.x) * 92837111u ^ UInt32(cell.y) * 689287499u ^ UInt32(cell.z) * 283923481u) & tableMask;
+	}
+
+	glm::vec3 get_cell_coordinates(const glm::vec3& position, Float32 inverseCellSize)
+	{
+		// fmax returns bound for NaN
+		glm::vec3 cell = glm::floor(position * inverseCellSize);
+		for (Int32 i = 0; i < 3; ++i)
+		{
+			cell[i] = std::fmin(std::fmax(cell[i], -MAX_CELL_COORDINATE), MAX_CELL_COORDINATE);
+		}
+		return cell;
+	}
+
+	glm::ivec3 get_cell(const glm::vec3& position, Float32 inverseCellSize)
+	{
+		return glm::ivec3(get_cell_coordinates(position, inverseCellSize));
+	}
+
+	glm::vec3 get_position(const ClothView& view, Int32 index)
+	{
+		return { view.positionsX[index], view.positionsY[index], view.positionsZ[index] };
+	}
+}
+
+void SelfCollision::collide(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+							const std::vector<UInt32>& indexes, Float32 thickness)
+{
+	if (triangles.size() * 3 != indexes.size())
+	{
+		build_topology(clothData, indexes);
+	}
+	if (threadContacts.size() != workerPool.get_threads_count())
+	{
+		threadContacts.resize(workerPool.get_threads_count());
+	}
+	for (ThreadContacts &thread : threadContacts)
+	{
+		thread.contacts.clear();
+		thread.candidatePairs = 0;
+		thread.edgeLengthSum  = 0.0f;
+	}
+
+	// Cells of average edge size keep both count of cells per item and items per cell small, even when few springs overstretch
+	workerPool.parallel_for(Int32(edges.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+	{
+		Float32 edgeLengthSum = 0.0f;
+		for (Int32 i = begin; i < end; ++i)
+		{
+			edgeLengthSum += glm::distance(get_position(view, edges[i].x), get_position(view, edges[i].y));
+		}
+		threadContacts[threadIndex].edgeLengthSum += edgeLengthSum;
+	});
+	Float32 edgeLengthSum = 0.0f;
+	for (const ThreadContacts &thread : threadContacts)
+	{
+		edgeLengthSum += thread.edgeLengthSum;
+	}
+
+	statistics = Statistics();
+	const Float32 contactThickness = thickness * minRestLength;
+	const Float32 averageEdgeLength = edgeLengthSum / Float32(glm::max(Int32(edges.size()), 1));
+	const Float32 cellSize = glm::max(averageEdgeLength, contactThickness);
+	if (contactThickness <= 0.0f || !(averageEdgeLength <= MAX_AVERAGE_STRETCH * averageRestEdgeLength))
+	{
+		return;
+	}
+
+	build_hashes(workerPool, view, cellSize, contactThickness);
+	find_point_triangle_contacts(workerPool, view, clothData, cellSize, contactThickness);
+	find_edge_edge_contacts(workerPool, view, contactThickness);
+
+	contacts.clear();
+	for (const ThreadContacts &thread : threadContacts)
+	{
+		contacts.insert(contacts.end(), thread.contacts.begin(), thread.contacts.end());
+		statistics.candidatePairs += thread.candidatePairs;
+	}
+	statistics.contacts = Int32(contacts.size());
+	std::sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b)
+	{
+		return std::lexicographical_compare(a.indexes, a.indexes + 4, b.indexes, b.indexes + 4);
+	});
+
+	resolve_contacts(view, contactThickness);
+}
+
+const SelfCollision::Statistics& SelfCollision::get_statistics() const
+{
+	return statistics;
+}
+
+void SelfCollision::clear()
+{
+	triangles.clear();
+	edges.clear();
+	triangleHash = SpatialHash();
+	edgeHash	 = SpatialHash();
+	threadContacts.clear();
+	contacts.clear();
+	statistics = Statistics();
+}
+
+void SelfCollision::build_topology(const ClothData& clothData, const std::vector<UInt32>& indexes)
+{
+	triangles.resize(indexes.size() / 3);
+	edges.clear();
+	edges.reserve(indexes.size());
+	for (Int32 i = 0; i < triangles.size(); ++i)
+	{
+		triangles[i] = glm::ivec3(clothData.get_mass_point(indexes[3 * i]), clothData.get_mass_point(indexes[3 * i + 1]),
+								  clothData.get_mass_point(indexes[3 * i + 2]));
+		for (Int32 j = 0; j < 3; ++j)
+		{
+			const Int32 a = triangles[i][j];
+			const Int32 b = triangles[i][(j + 1) % 3];
+			edges.emplace_back(glm::min(a, b), glm::max(a, b));
+		}
+	}
+	const auto isEdgeLess = [](const glm::ivec2& a, const glm::ivec2& b)
+	{
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	};
+	std::sort(edges.begin(), edges.end(), isEdgeLess);
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	minRestLength = clothData.restLengths.empty()
+		? 0.0f : *std::min_element(clothData.restLengths.begin(), clothData.restLengths.end());
+	// Topology may be rebuilt from restored or crumpled state, so rest lengths come from springs lying on triangle edges,
+	// that is structural springs and shear springs of triangulated diagonals
+	averageRestEdgeLength = 0.0f;
+	Int32 restEdgesCount = 0;
+	for (Int32 i = 0; i < clothData.restLengths.size(); ++i)
+	{
+		const Int32 indexA = clothData.springIndexesA[i], indexB = clothData.springIndexesB[i];
+		const glm::ivec2 edge(glm::min(indexA, indexB), glm::max(indexA, indexB));
+		if (std::binary_search(edges.begin(), edges.end(), edge, isEdgeLess))
+		{
+			averageRestEdgeLength += clothData.restLengths[i];
+			restEdgesCount++;
+		}
+	}
+	averageRestEdgeLength /= Float32(glm::max(restEdgesCount, 1));
+
+	resize_hash(triangleHash, Int32(triangles.size()));
+	resize_hash(edgeHash, Int32(edges.size()));
+}
+
+void SelfCollision::resize_hash(SpatialHash& hash, Int32 itemsCount)
+{
+	// Power of two table with a few buckets per item, items usually overlap 2 - 4 cells
+	hash.bucketOffsets.assign(std::bit_ceil(UInt32(4 * glm::max(itemsCount, 1))) + 1, 0);
+	hash.boundsMin.resize(itemsCount);
+	hash.boundsMax.resize(itemsCount);
+	hash.cellsMin.resize(itemsCount);
+	hash.cellsMax.resize(itemsCount);
+	hash.itemOffsets.resize(itemsCount + 1);
+}
+
+void SelfCollision::build_hashes(WorkerPool& workerPool, const ClothView& view, Float32 cellSize, Float32 thickness)
+{
+	// Point closer than thickness to triangle lies in its bounds grown by thickness, two edges closer than thickness
+	// have overlapping bounds grown by half of it
+	workerPool.parallel_for(Int32(triangles.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 a = get_position(view, triangles[i].x);
+			const glm::vec3 b = get_position(view, triangles[i].y);
+			const glm::vec3 c = get_position(view, triangles[i].z);
+			triangleHash.boundsMin[i] = glm::min(glm::min(a, b), c) - glm::vec3(thickness);
+			triangleHash.boundsMax[i] = glm::max(glm::max(a, b), c) + glm::vec3(thickness);
+		}
+	});
+	workerPool.parallel_for(Int32(edges.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 a = get_position(view, edges[i].x);
+			const glm::vec3 b = get_position(view, edges[i].y);
+			edgeHash.boundsMin[i] = glm::min(a, b) - glm::vec3(0.5f * thickness);
+			edgeHash.boundsMax[i] = glm::max(a, b) + glm::vec3(0.5f * thickness);
+		}
+	});
+
+	fill_hash(workerPool, triangleHash, cellSize);
+	fill_hash(workerPool, edgeHash, cellSize);
+}
+
+void SelfCollision::fill_hash(WorkerPool& workerPool, SpatialHash& hash, Float32 cellSize)
+{
+	const Float32 inverseCellSize = 1.0f / cellSize;
+	const UInt32 tableMask = UInt32(hash.bucketOffsets.size() - 2);
+	const Int32 itemsCount = Int32(hash.boundsMin.size());
+
+	workerPool.parallel_for(itemsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const glm::vec3 cellsMin = get_cell_coordinates(hash.boundsMin[i], inverseCellSize);
+			const glm::vec3 cellsMax = get_cell_coordinates(hash.boundsMax[i], inverseCellSize);
+			const glm::vec3 size = cellsMax - cellsMin + 1.0f;
+			if (size.x * size.y * size.z <= MAX_ITEM_CELLS)
+			{
+				hash.cellsMin[i] = glm::ivec3(cellsMin);
+				hash.cellsMax[i] = glm::ivec3(cellsMax);
+				hash.itemOffsets[i + 1] = Int32(size.x * size.y * size.z);
+			} else {
+				hash.cellsMin[i] = glm::ivec3(1);
+				hash.cellsMax[i] = glm::ivec3(0);
+				hash.itemOffsets[i + 1] = 0;
+			}
+		}
+	});
+	hash.itemOffsets[0] = 0;
+	for (Int32 i = 0; i < itemsCount; ++i)
+	{
+		hash.itemOffsets[i + 1] += hash.itemOffsets[i];
+	}
+	hash.entriesCount = hash.itemOffsets[itemsCount];
+	if (hash.unsortedItems.size() < hash.entriesCount)
+	{
+		hash.unsortedBuckets.resize(hash.entriesCount);
+		hash.unsortedItems.resize(hash.entriesCount);
+		hash.unsortedCells.resize(hash.entriesCount);
+		hash.items.resize(hash.entriesCount);
+		hash.cells.resize(hash.entriesCount);
+	}
+
+	workerPool.parallel_for(itemsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			Int32 entry = hash.itemOffsets[i];
+			for (Int32 z = hash.cellsMin[i].z; z <= hash.cellsMax[i].z; ++z)
+			{
+				for (Int32 y = hash.cellsMin[i].y; y <= hash.cellsMax[i].y; ++y)
+				{
+					for (Int32 x = hash.cellsMin[i].x; x <= hash.cellsMax[i].x; ++x, ++entry)
+					{
+						hash.unsortedCells[entry]	= glm::ivec3(x, y, z);
+						hash.unsortedBuckets[entry] = hash_cell(hash.unsortedCells[entry], tableMask);
+						hash.unsortedItems[entry]	= i;
+					}
+				}
+			}
+		}
+	});
+
+	// Counting sort keeps entries of one bucket in item order, so queries are deterministic
+	std::fill(hash.bucketOffsets.begin(), hash.bucketOffsets.end(), 0);
+	for (Int32 i = 0; i < hash.entriesCount; ++i)
+	{
+		hash.bucketOffsets[hash.unsortedBuckets[i] + 1]++;
+	}
+	for (Int32 i = 0; i + 1 < hash.bucketOffsets.size(); ++i)
+	{
+		hash.bucketOffsets[i + 1] += hash.bucketOffsets[i];
+	}
+	for (Int32 i = 0; i < hash.entriesCount; ++i)
+	{
+		const Int32 entry = hash.bucketOffsets[hash.unsortedBuckets[i]]++;
+		hash.items[entry] = hash.unsortedItems[i];
+		hash.cells[entry] = hash.unsortedCells[i];
+	}
+	// Filling moved every offset to the end of its bucket, shift them back
+	for (Int32 i = Int32(hash.bucketOffsets.size()) - 1; i > 0; --i)
+	{
+		hash.bucketOffsets[i] = hash.bucketOffsets[i - 1];
+	}
+	hash.bucketOffsets[0] = 0;
+}
+
+void SelfCollision::find_point_triangle_contacts(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+												 Float32 cellSize, Float32 thickness)
+{
+	const Float32 inverseCellSize = 1.0f / cellSize;
+	const UInt32 tableMask = UInt32(triangleHash.bucketOffsets.size() - 2);
+
+	workerPool.parallel_for(clothData.massPointsCount, QUERY_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+	{
+		ThreadContacts &thread = threadContacts[threadIndex];
+		for (Int32 point = begin; point < end; ++point)
+		{
+			// Triangles are stored in all cells they overlap, so point needs only its own cell
+			const glm::vec3 position = get_position(view, point);
+			const glm::ivec3 cell = get_cell(position, inverseCellSize);
+			const UInt32 bucket = hash_cell(cell, tableMask);
+			for (Int32 entry = triangleHash.bucketOffsets[bucket]; entry < triangleHash.bucketOffsets[bucket + 1]; ++entry)
+			{
+				const Int32 triangle = triangleHash.items[entry];
+				const glm::ivec3 &vertices = triangles[triangle];
+				if (triangleHash.cells[entry] != cell || vertices.x == point || vertices.y == point || vertices.z == point
+					|| glm::any(glm::lessThan(position, triangleHash.boundsMin[triangle]))
+					|| glm::any(glm::greaterThan(position, triangleHash.boundsMax[triangle])))
+				{
+					continue;
+				}
+				thread.candidatePairs++;
+
+				const glm::vec3 a = get_position(view, vertices.x);
+				const glm::vec3 b = get_position(view, vertices.y);
+				const glm::vec3 c = get_position(view, vertices.z);
+				const glm::vec3 barycentric = closest_on_triangle(position, a, b, c);
+				const glm::vec3 difference = position - (barycentric.x * a + barycentric.y * b + barycentric.z * c);
+				const Float32 distance2 = glm::dot(difference, difference);
+				if (distance2 >= thickness * thickness)
+				{
+					continue;
+				}
+
+				// Point lying on triangle has no direction to leave it, so it goes along triangle normal
+				const Float32 distance = std::sqrt(distance2);
+				glm::vec3 normal = difference / distance;
+				if (distance <= glm::epsilon<Float32>() * thickness)
+				{
+					normal = glm::cross(b - a, c - a);
+					const Float32 length = glm::length(normal);
+					if (length <= glm::epsilon<Float32>())
+					{
+						continue;
+					}
+					normal /= length;
+				}
+				thread.contacts.push_back({ { point, vertices.x, vertices.y, vertices.z },
+											{ 1.0f, -barycentric.x, -barycentric.y, -barycentric.z }, normal });
+			}
+		}
+	});
+}
+
+void SelfCollision::find_edge_edge_contacts(WorkerPool& workerPool, const ClothView& view, Float32 thickness)
+{
+	workerPool.parallel_for(Int32(edges.size()), QUERY_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32 threadIndex)
+	{
+		ThreadContacts &thread = threadContacts[threadIndex];
+		for (Int32 edge = begin; edge < end; ++edge)
+		{
+			const glm::ivec2 &vertices = edges[edge];
+			for (Int32 entry = edgeHash.itemOffsets[edge]; entry < edgeHash.itemOffsets[edge + 1]; ++entry)
+			{
+				// Entries of bucket are in item order, so pairs with lower edges are skipped by search, and each pair is
+				// tested only in first cell shared by both edges
+				const glm::ivec3 &cell = edgeHash.unsortedCells[entry];
+				const UInt32 bucket = edgeHash.unsortedBuckets[entry];
+				const auto bucketBegin = edgeHash.items.begin() + edgeHash.bucketOffsets[bucket];
+				const auto bucketEnd = edgeHash.items.begin() + edgeHash.bucketOffsets[bucket + 1];
+				const Int32 firstEntry = Int32(std::upper_bound(bucketBegin, bucketEnd, edge) - edgeHash.items.begin());
+				for (Int32 otherEntry = firstEntry; otherEntry < edgeHash.bucketOffsets[bucket + 1]; ++otherEntry)
+				{
+					const Int32 other = edgeHash.items[otherEntry];
+					const glm::ivec2 &otherVertices = edges[other];
+					if (edgeHash.cells[otherEntry] != cell || vertices.x == otherVertices.x || vertices.x == otherVertices.y
+						|| vertices.y == otherVertices.x || vertices.y == otherVertices.y
+						|| glm::max(edgeHash.cellsMin[edge], edgeHash.cellsMin[other]) != cell
+						|| glm::any(glm::lessThan(edgeHash.boundsMax[edge], edgeHash.boundsMin[other]))
+						|| glm::any(glm::lessThan(edgeHash.boundsMax[other], edgeHash.boundsMin[edge])))
+					{
+						continue;
+					}
+					thread.candidatePairs++;
+
+					const glm::vec3 p1 = get_position(view, vertices.x);
+					const glm::vec3 q1 = get_position(view, vertices.y);
+					const glm::vec3 p2 = get_position(view, otherVertices.x);
+					const glm::vec3 q2 = get_position(view, otherVertices.y);
+					const glm::vec2 parameters = closest_on_segments(p1, q1, p2, q2);
+					const glm::vec3 difference = glm::mix(p1, q1, parameters.x) - glm::mix(p2, q2, parameters.y);
+					const Float32 distance2 = glm::dot(difference, difference);
+					// Crossing edges have no separation direction, point-triangle pairs of their triangles handle them
+					if (distance2 >= thickness * thickness || distance2 <= glm::epsilon<Float32>() * thickness * thickness)
+					{
+						continue;
+					}
+
+					const glm::vec3 normal = difference / std::sqrt(distance2);
+					thread.contacts.push_back({ { vertices.x, vertices.y, otherVertices.x, otherVertices.y },
+												{ 1.0f - parameters.x, parameters.x, parameters.y - 1.0f, -parameters.y }, normal });
+				}
+			}
+		}
+	});
+}
+
+void SelfCollision::resolve_contacts(const ClothView& view, Float32 thickness)
+{
+	// Gauss-Seidel over contacts, each one reads positions already moved by previous ones
+	for (const Contact &contact : contacts)
+	{
+		Float32 separation = 0.0f;
+		Float32 normalVelocity = 0.0f;
+		Float32 inverseMassSum = 0.0f;
+		for (Int32 i = 0; i < 4; ++i)
+		{
+			const Int32 index = contact.indexes[i];
+			const Float32 weight = contact.weights[i];
+			separation	   += weight * glm::dot(contact.normal, get_position(view, index));
+			normalVelocity += weight * (contact.normal.x * view.velocitiesX[index] + contact.normal.y * view.velocitiesY[index]
+										+ contact.normal.z * view.velocitiesZ[index]);
+			inverseMassSum += weight * weight * view.inverseMasses[index];
+		}
+		if (inverseMassSum <= 0.0f)
+		{
+			continue;
+		}
+
+		// Pushes pair to thickness and removes approaching part of relative velocity, points move by their inverse mass
+		const Float32 positionScale = glm::max(thickness - separation, 0.0f) / inverseMassSum;
+		const Float32 velocityScale = glm::max(-normalVelocity, 0.0f) / inverseMassSum;
+		for (Int32 i = 0; i < 4; ++i)
+		{
+			const Int32 index = contact.indexes[i];
+			const glm::vec3 positionCorrection = view.inverseMasses[index] * contact.weights[i] * positionScale * contact.normal;
+			const glm::vec3 velocityCorrection = view.inverseMasses[index] * contact.weights[i] * velocityScale * contact.normal;
+			view.positionsX[index]	+= positionCorrection.x;
+			view.positionsY[index]	+= positionCorrection.y;
+			view.positionsZ[index]	+= positionCorrection.z;
+			view.velocitiesX[index] += velocityCorrection.x;
+			view.velocitiesY[index] += velocityCorrection.y;
+			view.velocitiesZ[index] += velocityCorrection.z;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "cloth_kernels.hpp"
+
+class WorkerPool;
+struct ClothData;
+
+/**
+ * Cloth against itself, point-triangle and edge-edge pairs closer than thickness are pushed apart and lose
+ * approaching velocity. Broad phase is uniform grid hashed into fixed table, rebuilt every step with counting sort
+ */
+class SelfCollision
+{
+public:
+	struct Statistics
+	{
+		Int32 candidatePairs = 0; // Pairs that passed broad phase in last step
+		Int32 contacts		 = 0; // Pairs closer than thickness in last step
+	};
+
+	// Triangles are read from mesh indexes and mapped to mass points, thickness is fraction of shortest spring rest length
+	void collide(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+				 const std::vector<UInt32>& indexes, Float32 thickness);
+
+	const Statistics& get_statistics() const;
+	void clear();
+
+private:
+	struct Contact
+	{
+		Int32 indexes[4];
+		Float32 weights[4]; // Separation is dot(normal, sum of weights[i] * position of indexes[i])
+		glm::vec3 normal;
+	};
+
+	// Items are stored in every cell overlapped by their bounding box, sorted entries of bucket b are
+	// [bucketOffsets[b], bucketOffsets[b + 1]). All arrays only grow, so steady state rebuilds don't allocate
+	struct SpatialHash
+	{
+		std::vector<glm::vec3> boundsMin, boundsMax;
+		std::vector<glm::ivec3> cellsMin, cellsMax;
+		std::vector<Int32> itemOffsets; // First unsorted entry of each item
+		std::vector<UInt32> unsortedBuckets;
+		std::vector<Int32> unsortedItems;
+		std::vector<glm::ivec3> unsortedCells;
+		std::vector<Int32> bucketOffsets;
+		std::vector<Int32> items;
+		std::vector<glm::ivec3> cells; // Cell of each sorted entry, skips other cells hashed to same bucket
+		Int32 entriesCount = 0;
+	};
+
+	// Contacts found by one thread, aligned to avoid false sharing of counters
+	struct alignas(64) ThreadContacts
+	{
+		std::vector<Contact> contacts;
+		Int32 candidatePairs  = 0;
+		Float32 edgeLengthSum = 0.0f;
+	};
+
+	std::vector<glm::ivec3> triangles;
+	std::vector<glm::ivec2> edges;
+	Float32 minRestLength = 0.0f;
+	Float32 averageRestEdgeLength = 0.0f;
+
+	SpatialHash triangleHash, edgeHash;
+	std::vector<ThreadContacts> threadContacts;
+	std::vector<Contact> contacts; // All threads, sorted so responses don't depend on scheduling
+	Statistics statistics;
+
+	void build_topology(const ClothData& clothData, const std::vector<UInt32>& indexes);
+	void build_hashes(WorkerPool& workerPool, const ClothView& view, Float32 cellSize, Float32 thickness);
+	void resize_hash(SpatialHash& hash, Int32 itemsCount);
+	// Bounds of items have to be set, fills entries of all cells they overlap and sorts them by bucket
+	void fill_hash(WorkerPool& workerPool, SpatialHash& hash, Float32 cellSize);
+	void find_point_triangle_contacts(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+									  Float32 cellSize, Float32 thickness);
+	void find_edge_edge_contacts(WorkerPool& workerPool, const ClothView& view, Float32 thickness);
+	void resolve_contacts(const ClothView& view, Float32 thickness);
+};
@@ -0,0 +1,179 @@
+#include "static_colliders.hpp"
+
+#include <atomic>
+
+#include "../Common/handle.hpp"
+#include "../Common/worker_pool.hpp"
+#include "../Common/cloth_data.hpp"
+
+// Every point queries hierarchy, so chunks are smaller than for plain per point passes
+constexpr Int32 QUERY_CHUNK_SIZE = 256;
+
+void StaticColliders::add_mesh(const std::vector<glm::vec3>& positions, const std::vector<UInt32>& indexes, const glm::mat4& transform)
+{
+	meshTriangles.reserve(meshTriangles.size() + indexes.size() / 3);
+	for (Int32 i = 0; i + 2 < indexes.size(); i += 3)
+	{
+		ColliderBvh::Triangle triangle;
+		triangle.a = glm::vec3(transform * glm::vec4(positions[indexes[i]], 1.0f));
+		triangle.b = glm::vec3(transform * glm::vec4(positions[indexes[i + 1]], 1.0f));
+		triangle.c = glm::vec3(transform * glm::vec4(positions[indexes[i + 2]], 1.0f));
+		const glm::vec3 normal = glm::cross(triangle.b - triangle.a, triangle.c - triangle.a);
+		const Float32 length   = glm::length(normal);
+		if (length <= 0.0f)
+		{
+			continue; // Degenerate triangles have no side
+		}
+		triangle.normal = normal / length;
+		meshTriangles.emplace_back(triangle);
+	}
+	isBvhDirty = true;
+}
+
+void StaticColliders::prepare()
+{
+	if (isBvhDirty)
+	{
+		// Copy is kept, so more meshes can be added later without reading hierarchy back
+		bvh.build(std::vector<ColliderBvh::Triangle>(meshTriangles));
+		isBvhDirty = false;
+	}
+}
+
+Int32 StaticColliders::collide(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, const Parameters& parameters) const
+{
+	if (is_empty())
+	{
+		return 0;
+	}
+
+	std::atomic<Int32> contactsCount = 0;
+	workerPool.parallel_for(clothData.massPointsCount, QUERY_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		Int32 contacts = 0;
+		for (Int32 i = begin; i < end; ++i)
+		{
+			if (view.inverseMasses[i] <= 0.0f)
+			{
+				continue;
+			}
+
+			glm::vec3 position(view.positionsX[i], view.positionsY[i], view.positionsZ[i]);
+			glm::vec3 velocity(view.velocitiesX[i], view.velocitiesY[i], view.velocitiesZ[i]);
+			bool isInContact = false;
+
+			const auto respond = [&](const glm::vec3& normal, Float32 distance)
+			{
+				if (distance >= parameters.thickness)
+				{
+					return;
+				}
+				position += (parameters.thickness - distance) * normal;
+
+				const Float32 normalVelocity = glm::dot(velocity, normal);
+				if (normalVelocity < 0.0f)
+				{
+					velocity -= normalVelocity * normal;
+					const glm::vec3 tangentVelocity = velocity - glm::dot(velocity, normal) * normal;
+					const Float32 tangentSpeed = glm::length(tangentVelocity);
+					if (tangentSpeed > 0.0f)
+					{
+						const Float32 reduction = glm::min(-normalVelocity * parameters.friction, tangentSpeed);
+						velocity -= tangentVelocity * (reduction / tangentSpeed);
+					}
+				}
+				isInContact = true;
+			};
+
+			for (const ColliderShape &shape : shapes)
+			{
+				glm::vec3 normal;
+				const Float32 distance = get_shape_distance(shape, position, normal);
+				respond(normal, distance);
+			}
+
+			// Fast points may cross thin surface within step, so search reaches as far as they travel
+			const Float32 searchRadius = parameters.thickness + glm::length(velocity) * parameters.deltaTime;
+			glm::vec3 closest, normal;
+			if (bvh.find_closest(position, searchRadius, closest, normal))
+			{
+				const Float32 side = glm::dot(position - closest, normal);
+				const Float32 distance = glm::length(position - closest);
+				// Closest feature may be edge or vertex, push goes along face normal so points inside leave on right side
+				if (side < 0.0f)
+				{
+					position = closest;
+					respond(normal, 0.0f);
+				} else {
+					respond(distance > 0.0f ? (position - closest) / distance : normal, distance);
+				}
+			}
+
+			if (isInContact)
+			{
+				view.positionsX[i]	= position.x;
+				view.positionsY[i]	= position.y;
+				view.positionsZ[i]	= position.z;
+				view.velocitiesX[i] = velocity.x;
+				view.velocitiesY[i] = velocity.y;
+				view.velocitiesZ[i] = velocity.z;
+				contacts++;
+			}
+		}
+		contactsCount += contacts;
+	});
+	return contactsCount;
+}
+
+bool StaticColliders::is_empty() const
+{
+	return shapes.empty() && bvh.get_triangles_count() == 0;
+}
+
+Int32 StaticColliders::get_triangles_count() const
+{
+	return Int32(meshTriangles.size());
+}
+
+void StaticColliders::clear_meshes()
+{
+	meshTriangles.clear();
+	bvh.clear();
+	isBvhDirty = false;
+}
+
+void StaticColliders::clear()
+{
+	shapes.clear();
+	clear_meshes();
+}
+
+Float32 StaticColliders::get_shape_distance(const ColliderShape& shape, const glm::vec3& point, glm::vec3& normal) const
+{
+	glm::vec3 center = shape.position;
+	Float32 radius = shape.radius;
+	switch (shape.shape)
+	{
+		case EColliderShape::Plane:
+		{
+			normal = glm::normalize(shape.direction);
+			return glm::dot(point - shape.position, normal);
+		}
+		case EColliderShape::Capsule:
+		{
+			const Float32 length2 = glm::dot(shape.direction, shape.direction);
+			const Float32 t = length2 > 0.0f ? glm::clamp(glm::dot(point - shape.position, shape.direction) / length2, 0.0f, 1.0f) : 0.0f;
+			center = shape.position + t * shape.direction;
+			break;
+		}
+		case EColliderShape::Sphere:
+		{
+			break;
+		}
+	}
+
+	const glm::vec3 offset = point - center;
+	const Float32 length = glm::length(offset);
+	normal = length > 0.0f ? offset / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	return length - radius;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "cloth_kernels.hpp"
+#include "collider_bvh.hpp"
+
+class WorkerPool;
+struct ClothData;
+
+enum class EColliderShape : Int8
+{
+	Sphere,
+	Plane,	// Infinite, position lies on it and direction is its normal
+	Capsule // Segment from position to position + direction, swept by radius
+};
+
+struct ColliderShape
+{
+	EColliderShape shape = EColliderShape::Sphere;
+	glm::vec3 position	 = { 0.0f, 0.0f, 0.0f };
+	glm::vec3 direction	 = { 0.0f, 1.0f, 0.0f };
+	Float32 radius		 = 1.0f;
+};
+
+/**
+ * Colliders that don't move, analytic shapes and triangle meshes. Meshes are expected closed with faces pointing
+ * outside, all of them are merged into one hierarchy that is rebuilt only after they change
+ */
+class StaticColliders
+{
+public:
+	struct Parameters
+	{
+		Float32 thickness = 0.1f; // World distance kept between cloth and collider surface
+		Float32 friction  = 0.3f; // Coulomb coefficient, tangential velocity is reduced by friction times normal one
+		Float32 deltaTime = 0.016f;
+	};
+
+	std::vector<ColliderShape> shapes;
+
+	// Triangles of indexes are transformed to world space, hierarchy is built on next prepare
+	void add_mesh(const std::vector<glm::vec3>& positions, const std::vector<UInt32>& indexes, const glm::mat4& transform);
+	// Must be called before collide runs concurrently on more cloths
+	void prepare();
+	// Pushes simulated mass points out of colliders, returns count of points in contact
+	Int32 collide(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, const Parameters& parameters) const;
+
+	bool is_empty() const;
+	Int32 get_triangles_count() const;
+	void clear_meshes();
+	void clear();
+
+private:
+	ColliderBvh bvh;
+	std::vector<ColliderBvh::Triangle> meshTriangles;
+	bool isBvhDirty = false;
+
+	// Writes closest surface point and outside normal, returns signed distance from surface
+	Float32 get_shape_distance(const ColliderShape& shape, const glm::vec3& point, glm::vec3& normal) const;
+};
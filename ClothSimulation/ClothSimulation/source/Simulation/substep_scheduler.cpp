@@ -0,0 +1,74 @@
+#include "substep_scheduler.hpp"
+
+void SubstepScheduler::begin_frame(Float32 frameTime, Float32 deltaTime)
+{
+	this->deltaTime = deltaTime;
+	statistics.substeps		   = 0;
+	statistics.extraSubsteps   = 0;
+	statistics.droppedSubsteps = 0;
+	frameBegin = Clock::now();
+
+	if (deltaTime <= 0.0f)
+	{
+		accumulator = 0.0f;
+		dueSubsteps = 0;
+		return;
+	}
+
+	// Time cut by clamping is lost the same way as substeps over budget
+	const Float32 clampedFrameTime = glm::clamp(frameTime, 0.0f, settings.maxFrameTime);
+	statistics.droppedSubsteps = Int32((frameTime - clampedFrameTime) * settings.timeScale / deltaTime);
+
+	accumulator += clampedFrameTime * settings.timeScale;
+	dueSubsteps = Int32(accumulator / deltaTime);
+}
+
+bool SubstepScheduler::should_step()
+{
+	const Int32 substeps = statistics.substeps;
+	if (substeps >= dueSubsteps || substeps >= settings.maxSubsteps)
+	{
+		return false;
+	}
+
+	// First substep always runs, next ones only if average substep so far still fits in budget
+	if (settings.timeBudgetMs > 0.0f && substeps > 0)
+	{
+		const Float32 elapsedMs = std::chrono::duration<Float32, std::milli>(Clock::now() - frameBegin).count();
+		if (elapsedMs * Float32(substeps + 1) / Float32(substeps) > settings.timeBudgetMs)
+		{
+			return false;
+		}
+	}
+
+	statistics.substeps++;
+	accumulator -= deltaTime;
+	return true;
+}
+
+void SubstepScheduler::end_frame()
+{
+	// Leftover shorter than one substep is carried over, whole substeps that didn't fit are dropped
+	const Int32 skippedSubsteps = dueSubsteps - statistics.substeps;
+	accumulator -= Float32(skippedSubsteps) * deltaTime;
+	accumulator = glm::max(accumulator, 0.0f);
+
+	statistics.droppedSubsteps += skippedSubsteps;
+	statistics.extraSubsteps	= glm::max(statistics.substeps - 1, 0);
+	statistics.totalDroppedSubsteps += statistics.droppedSubsteps;
+	statistics.totalExtraSubsteps	+= statistics.extraSubsteps;
+	statistics.substepsTimeMs = std::chrono::duration<Float32, std::milli>(Clock::now() - frameBegin).count();
+	dueSubsteps = 0;
+}
+
+const SubstepScheduler::Statistics& SubstepScheduler::get_statistics() const
+{
+	return statistics;
+}
+
+void SubstepScheduler::reset()
+{
+	statistics	= Statistics();
+	accumulator = 0.0f;
+	dueSubsteps = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+
+/**
+ * Splits render frame time into fixed simulation substeps, leftover time is carried to next frame.
+ * Substeps that don't fit in per frame budget are dropped, so simulation slows down instead of frame time spiking.
+ */
+class SubstepScheduler
+{
+public:
+	struct Settings
+	{
+		Int32 maxSubsteps	  = 16;	   // Per frame
+		Float32 timeBudgetMs  = 8.0f;  // Wall clock spent on substeps per frame, zero disables it
+		Float32 maxFrameTime  = 0.25f; // Longer frames (e.g. window dragging) are clamped to it
+		Float32 timeScale	  = 1.0f;
+	};
+
+	struct Statistics
+	{
+		Int32 substeps		  = 0; // Done in last frame
+		Int32 extraSubsteps	  = 0; // Over one substep per frame in last frame
+		Int32 droppedSubsteps = 0; // Due in last frame, but over budget
+		Int64 totalExtraSubsteps   = 0;
+		Int64 totalDroppedSubsteps = 0;
+		Float32 substepsTimeMs	   = 0.0f; // Wall clock spent on substeps in last frame
+	};
+
+	Settings settings;
+
+	// Adds render frame time in seconds, substeps are deltaTime long
+	void begin_frame(Float32 frameTime, Float32 deltaTime);
+	// True while there is due substep that fits in budget, every true has to be followed by one solver step
+	bool should_step();
+	void end_frame();
+
+	const Statistics& get_statistics() const;
+	void reset();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Statistics statistics;
+	Clock::time_point frameBegin;
+	Float32 accumulator = 0.0f;
+	Float32 deltaTime	= 0.0f;
+	Int32 dueSubsteps	= 0;
+};
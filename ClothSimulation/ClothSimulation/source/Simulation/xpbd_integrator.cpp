@@ -0,0 +1,231 @@
+#include "xpbd_integrator.hpp"
+
+#include "../Common/handle.hpp"
+#include "../Common/worker_pool.hpp"
+#include "../Common/cloth_data.hpp"
+
+// Over-relaxation of averaged Jacobi corrections, values in range [1, 2) converge faster than plain average
+constexpr Float32 JACOBI_RELAXATION = 1.5f;
+
+namespace
+{
+	// Returns change of lagrange multiplier and writes correction that point A receives scaled by its inverse mass
+	Float32 solve_distance_constraint(const ClothView& view, Int32 spring, Float32 deltaTime2, Float32 lambda, glm::vec3& correction)
+	{
+		const Int32 indexA = view.springIndexesA[spring];
+		const Int32 indexB = view.springIndexesB[spring];
+		const Float32 inverseMassSum = view.inverseMasses[indexA] + view.inverseMasses[indexB];
+		const Float32 stiffness = view.stiffnesses[spring];
+		const glm::vec3 difference(view.positionsX[indexA] - view.positionsX[indexB],
+								   view.positionsY[indexA] - view.positionsY[indexB],
+								   view.positionsZ[indexA] - view.positionsZ[indexB]);
+		const Float32 length2 = glm::dot(difference, difference);
+		if (inverseMassSum <= 0.0f || stiffness <= 0.0f || length2 <= glm::epsilon<Float32>())
+		{
+			correction = glm::vec3(0.0f);
+			return 0.0f;
+		}
+
+		// alpha~ = compliance / h^2
+		const Float32 length = std::sqrt(length2);
+		const Float32 compliance = 1.0f / (stiffness * deltaTime2);
+		const Float32 constraint = length - view.restLengths[spring];
+		const Float32 deltaLambda = (-constraint - compliance * lambda) / (inverseMassSum + compliance);
+		correction = deltaLambda / length * difference;
+		return deltaLambda;
+	}
+}
+
+void XpbdIntegrator::integrate(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData,
+							   const Parameters& parameters)
+{
+	const Int32 pointsCount = clothData.get_padded_count();
+	resize(clothData);
+
+	predict(workerPool, view, pointsCount, parameters.deltaTime);
+	std::fill(lambdas.begin(), lambdas.end(), 0.0f);
+
+	for (Int32 iteration = 0; iteration < parameters.iterations; ++iteration)
+	{
+		if (parameters.mode == EXpbdMode::GaussSeidel)
+		{
+			solve_gauss_seidel(workerPool, view, clothData, parameters.deltaTime);
+		} else {
+			solve_jacobi(workerPool, view, clothData, parameters.deltaTime);
+		}
+	}
+
+	update_velocities(workerPool, view, pointsCount, parameters.deltaTime);
+}
+
+void XpbdIntegrator::clear()
+{
+	for (AlignedVector<Float32> *values : { &previousX, &previousY, &previousZ, &lambdas,
+											&correctionsX, &correctionsY, &correctionsZ })
+	{
+		values->clear();
+	}
+	adjacencyOffsets.clear();
+	adjacency.clear();
+}
+
+void XpbdIntegrator::resize(const ClothData& clothData)
+{
+	const Int32 pointsCount = clothData.get_padded_count();
+	const Int32 springsCount = Int32(clothData.restLengths.size());
+	if (previousX.size() != pointsCount)
+	{
+		previousX.resize(pointsCount);
+		previousY.resize(pointsCount);
+		previousZ.resize(pointsCount);
+	}
+	if (lambdas.size() != springsCount)
+	{
+		for (AlignedVector<Float32> *values : { &lambdas, &correctionsX, &correctionsY, &correctionsZ })
+		{
+			values->resize(springsCount);
+		}
+	}
+	if (adjacencyOffsets.size() != pointsCount + 1 || adjacency.size() != 2 * springsCount)
+	{
+		build_adjacency(clothData);
+	}
+}
+
+void XpbdIntegrator::build_adjacency(const ClothData& clothData)
+{
+	const Int32 pointsCount = clothData.get_padded_count();
+	const Int32 springsCount = Int32(clothData.restLengths.size());
+
+	adjacencyOffsets.assign(pointsCount + 1, 0);
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		adjacencyOffsets[clothData.springIndexesA[i] + 1]++;
+		adjacencyOffsets[clothData.springIndexesB[i] + 1]++;
+	}
+	for (Int32 i = 0; i < pointsCount; ++i)
+	{
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+
+	std::vector<Int32> writeOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	adjacency.resize(2 * springsCount);
+	for (Int32 i = 0; i < springsCount; ++i)
+	{
+		adjacency[writeOffsets[clothData.springIndexesA[i]]++] = 2 * i;
+		adjacency[writeOffsets[clothData.springIndexesB[i]]++] = 2 * i + 1;
+	}
+}
+
+void XpbdIntegrator::predict(WorkerPool& workerPool, const ClothView& view, Int32 pointsCount, Float32 deltaTime)
+{
+	workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Float32 inverseMass = view.inverseMasses[i];
+			previousX[i] = view.positionsX[i];
+			previousY[i] = view.positionsY[i];
+			previousZ[i] = view.positionsZ[i];
+			view.velocitiesX[i] += view.forcesX[i] * inverseMass * deltaTime;
+			view.velocitiesY[i] += view.forcesY[i] * inverseMass * deltaTime;
+			view.velocitiesZ[i] += view.forcesZ[i] * inverseMass * deltaTime;
+			view.positionsX[i]	+= view.velocitiesX[i] * deltaTime;
+			view.positionsY[i]	+= view.velocitiesY[i] * deltaTime;
+			view.positionsZ[i]	+= view.velocitiesZ[i] * deltaTime;
+		}
+	});
+}
+
+void XpbdIntegrator::solve_gauss_seidel(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime)
+{
+	// Constraints in one batch never share mass point, so they can be projected in place concurrently
+	const Float32 deltaTime2 = deltaTime * deltaTime;
+	for (Int32 batch = 0; batch + 1 < clothData.springBatchOffsets.size(); ++batch)
+	{
+		const Int32 batchBegin = clothData.springBatchOffsets[batch];
+		const Int32 batchEnd   = clothData.springBatchOffsets[batch + 1];
+		workerPool.parallel_for(batchEnd - batchBegin, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+		{
+			for (Int32 i = batchBegin + begin; i < batchBegin + end; ++i)
+			{
+				glm::vec3 correction;
+				lambdas[i] += solve_distance_constraint(view, i, deltaTime2, lambdas[i], correction);
+
+				const Int32 indexA = view.springIndexesA[i];
+				const Int32 indexB = view.springIndexesB[i];
+				const Float32 inverseMassA = view.inverseMasses[indexA];
+				const Float32 inverseMassB = view.inverseMasses[indexB];
+				view.positionsX[indexA] += inverseMassA * correction.x;
+				view.positionsY[indexA] += inverseMassA * correction.y;
+				view.positionsZ[indexA] += inverseMassA * correction.z;
+				view.positionsX[indexB] -= inverseMassB * correction.x;
+				view.positionsY[indexB] -= inverseMassB * correction.y;
+				view.positionsZ[indexB] -= inverseMassB * correction.z;
+			}
+		});
+	}
+}
+
+void XpbdIntegrator::solve_jacobi(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime)
+{
+	// Every constraint reads positions from previous iteration, so there is no need for coloring. Constraint step
+	// is divided by count of constraints of its busier point, lambda gets same scale to stay consistent with positions
+	const Float32 deltaTime2 = deltaTime * deltaTime;
+	workerPool.parallel_for(Int32(lambdas.size()), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Int32 indexA = view.springIndexesA[i];
+			const Int32 indexB = view.springIndexesB[i];
+			const Int32 constraintsCount = glm::max(adjacencyOffsets[indexA + 1] - adjacencyOffsets[indexA],
+													adjacencyOffsets[indexB + 1] - adjacencyOffsets[indexB]);
+			const Float32 scale = JACOBI_RELAXATION / Float32(constraintsCount);
+
+			glm::vec3 correction;
+			lambdas[i] += scale * solve_distance_constraint(view, i, deltaTime2, lambdas[i], correction);
+			correctionsX[i] = scale * correction.x;
+			correctionsY[i] = scale * correction.y;
+			correctionsZ[i] = scale * correction.z;
+		}
+	});
+
+	// Each mass point gathers corrections of its own constraints, so there are no write conflicts
+	workerPool.parallel_for(clothData.get_padded_count(), MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			const Float32 inverseMass = view.inverseMasses[i];
+			if (inverseMass <= 0.0f)
+			{
+				continue;
+			}
+
+			glm::vec3 sum(0.0f);
+			for (Int32 j = adjacencyOffsets[i]; j < adjacencyOffsets[i + 1]; ++j)
+			{
+				const Int32 spring = adjacency[j] >> 1;
+				const Float32 sign = (adjacency[j] & 1) ? -1.0f : 1.0f;
+				sum += sign * glm::vec3(correctionsX[spring], correctionsY[spring], correctionsZ[spring]);
+			}
+
+			view.positionsX[i] += inverseMass * sum.x;
+			view.positionsY[i] += inverseMass * sum.y;
+			view.positionsZ[i] += inverseMass * sum.z;
+		}
+	});
+}
+
+void XpbdIntegrator::update_velocities(WorkerPool& workerPool, const ClothView& view, Int32 pointsCount, Float32 deltaTime)
+{
+	const Float32 inverseDeltaTime = deltaTime > 0.0f ? 1.0f / deltaTime : 0.0f;
+	workerPool.parallel_for(pointsCount, MIN_CHUNK_SIZE, [&](Int32 begin, Int32 end, Int32)
+	{
+		for (Int32 i = begin; i < end; ++i)
+		{
+			view.velocitiesX[i] = (view.positionsX[i] - previousX[i]) * inverseDeltaTime;
+			view.velocitiesY[i] = (view.positionsY[i] - previousY[i]) * inverseDeltaTime;
+			view.velocitiesZ[i] = (view.positionsZ[i] - previousZ[i]) * inverseDeltaTime;
+		}
+	});
+}
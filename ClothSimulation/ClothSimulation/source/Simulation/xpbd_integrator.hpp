@@ -0,0 +1,45 @@
+#pragma once
+#include "../Common/aligned_allocator.hpp"
+#include "cloth_kernels.hpp"
+
+class WorkerPool;
+struct ClothData;
+
+enum class EXpbdMode : Int8
+{
+	GaussSeidel, // Colored spring batches, each batch sees corrections of previous ones
+	Jacobi		 // All constraints solved from same positions, corrections averaged per mass point
+};
+
+/** Extended position based dynamics, springs are distance constraints with compliance 1 / stiffness */
+class XpbdIntegrator
+{
+public:
+	struct Parameters
+	{
+		Float32 deltaTime;
+		Int32 iterations;
+		EXpbdMode mode;
+	};
+
+	// Forces in view have to contain only external forces, they are applied in prediction
+	void integrate(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, const Parameters& parameters);
+
+	void clear();
+
+private:
+	AlignedVector<Float32> previousX, previousY, previousZ;
+	AlignedVector<Float32> lambdas;
+	// Jacobi only, position correction of each constraint applied with + to point A and - to point B
+	AlignedVector<Float32> correctionsX, correctionsY, correctionsZ;
+	// Jacobi only, constraints of each mass point, value is 2 * spring + 1 for point B
+	std::vector<Int32> adjacencyOffsets;
+	std::vector<Int32> adjacency;
+
+	void resize(const ClothData& clothData);
+	void build_adjacency(const ClothData& clothData);
+	void predict(WorkerPool& workerPool, const ClothView& view, Int32 pointsCount, Float32 deltaTime);
+	void solve_gauss_seidel(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime);
+	void solve_jacobi(WorkerPool& workerPool, const ClothView& view, const ClothData& clothData, Float32 deltaTime);
+	void update_velocities(WorkerPool& workerPool, const ClothView& view, Int32 pointsCount, Float32 deltaTime);
+};
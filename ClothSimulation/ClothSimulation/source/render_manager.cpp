@@ -18,6 +18,22 @@
 #include "simulation_manager.hpp"
 #include "Common/cloth_data.hpp"
 
+namespace
+{
+	// Even, so batches of draw_lines never split line
+	constexpr Int64 MAX_LINE_VERTICES_COUNT = 1000000;
+
+	const std::string SHADERS_PATH = "Resources/Shaders/";
+
+	constexpr UInt32 FRAME_BLOCK	= 0;
+	constexpr UInt32 MATERIAL_BLOCK = 1;
+
+	// Samplers in order of texture handles in Material, sampler i reads texture unit i
+	constexpr UniformName TEXTURE_SAMPLERS[] = { "Albedo", "Normal", "Roughness", "Metalness", "AmbientOcclusion",
+												 "Emission", "Height", "Opacity" };
+	static_assert(std::size(TEXTURE_SAMPLERS) == sizeof(Material) / sizeof(Handle<Texture>));
+}
+
 SRenderManager& SRenderManager::get()
 {
 	static SRenderManager instance = SRenderManager();
@@ -52,12 +68,29 @@ void SRenderManager::startup()
 	ImGuiStyle &style = ImGui::GetStyle();
 	style.Colors[ImGuiCol_WindowBg].w = 1.0f;
 
-	diffuse.create("Resources/Shaders/Vertex.vert",
-				  "Resources/Shaders/Fragment.frag");
-
-	normals.create("Resources/Shaders/Normals.vert",
-				  "Resources/Shaders/Normals.frag",
-				  "Resources/Shaders/Normals.geom");
+	diffuse.create(SHADERS_PATH + "Vertex.vert",
+				   SHADERS_PATH + "Fragment.frag");
+
+	normals.create(SHADERS_PATH + "Normals.vert",
+				   SHADERS_PATH + "Normals.frag",
+				   SHADERS_PATH + "Normals.geom");
+
+	springs.create(SHADERS_PATH + "Springs.vert",
+				   SHADERS_PATH + "Springs.frag",
+				   SHADERS_PATH + "Springs.geom");
+
+	glGenBuffers(1, &frameBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK, frameBuffer);
+	glGenBuffers(1, &materialBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialData), &boundMaterial, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK, materialBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	setup_shaders();
+	shadersWatcher.start(SHADERS_PATH);
 	// glEnable(GL_CULL_FACE);
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
@@ -74,37 +107,40 @@ void SRenderManager::update(Camera &camera)
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
 
+	reload_changed_shaders();
+	resourceManager.upload_loaded_textures();
 	camera_gui(camera);
 	simulationManager.show_gui();
+	if (simulationManager.is_debug_mode())
+	{
+		debug_gui();
+	}
 
 	ImGui::Render();
 
 	glfwMakeContextCurrent(&displayManager.get_window());
 	
+	const glm::mat4 view = camera.get_view();
+	const glm::mat4 proj = camera.get_projection(displayManager.get_aspect_ratio());
+	FrameData frameData = { proj * view, glm::vec4(camera.position, 1.0f) };
+	Shader::s_bind_uniform_buffer(frameBuffer, 0, sizeof(FrameData), &frameData.viewProjection[0][0]);
+
 	diffuse.use();
-	glm::mat4 view = camera.get_view();
-	glm::mat4 proj = camera.get_projection(displayManager.get_aspect_ratio());
-	glm::mat4 model = glm::mat4(1.0f);
-	diffuse.set_mat4("viewProjection", proj * view);
-	diffuse.set_vec3("cameraPosition", camera.position);
 	const glm::vec3  origin   = { 10.0f , 30.0f, -5.0f };
 	diffuse.set_mat4("model", glm::translate(glm::mat4(1.0f), origin));
 
 	if (simulationManager.is_debug_mode())
 	{
-		const ClothData &cloth = simulationManager.get_cloth_data(0);
-		const Mesh &mesh = resourceManager.get_mesh_by_handle(cloth.simulatedMesh);
-
-		for (const glm::ivec2 &attachment : cloth.springAttachments)
+		springs.use();
+		draw_springs(origin);
+		diffuse.use();
+	} else {
+		for (Int32 clothIndex = 0; clothIndex < simulationManager.get_cloths_count(); ++clothIndex)
 		{
-			add_line(mesh.positions[attachment.x],
-					 mesh.positions[attachment.y]);
+			draw_model(resourceManager.get_model_by_handle(simulationManager.get_cloth_data(clothIndex).simulatedModel), diffuse);
 		}
-
-		draw_lines(glm::vec3(1.0f));
-	} else {
-		draw_model(resourceManager.get_model_by_name("Flag"), diffuse);
 	}
+	draw_colliders(origin);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 	glfwSwapBuffers(&displayManager.get_window());
 }
@@ -118,18 +154,20 @@ void SRenderManager::draw_model(const Model& model, Shader &shader)
 		Mesh& mesh = resourceManager.get_mesh_by_handle(model.meshes[i]);
 		Material& material = resourceManager.get_material_by_handle(model.materials[i]);
 		
+		// Samplers read fixed units set at startup, only textures are bound. Textures that are still loading aren't used
+		MaterialData materialData;
 		Handle<Texture>* textureHandle = &material.albedo;
 		for (Int32 j = 0; j < sizeof(Material) / sizeof(Handle<Texture>); ++j, ++textureHandle)
 		{
-			if (*textureHandle != Handle<Texture>::sNone)
+			if (*textureHandle != Handle<Texture>::sNone && resourceManager.get_texture_by_handle(*textureHandle).gpuId)
 			{
 				const Texture& texture = resourceManager.get_texture_by_handle(*textureHandle);
-				std::string type(magic_enum::enum_name(texture.type));
-				shader.set_int(type, j);
 				glActiveTexture(GL_TEXTURE0 + j);
 				glBindTexture(GL_TEXTURE_2D, texture.gpuId);
+				materialData.texturesMask |= 1U << j;
 			}
 		}
+		set_material(materialData);
 		
 		glBindVertexArray(mesh.gpuIds[0]);
         glDrawElements(GL_TRIANGLES, mesh.indexes.size(), GL_UNSIGNED_INT, 0);
@@ -251,7 +289,7 @@ void SRenderManager::draw_sphere(const glm::vec3& color)
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
-	diffuse.set_vec3("objectColor", color);
+	set_material({ glm::vec4(color, 1.0f) });
 	glBindVertexArray(sphereVAO);
 	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
 }
@@ -273,8 +311,7 @@ void SRenderManager::draw_lines(const glm::vec3& color)
 		glBindVertexArray(linesVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, linesVBO);
 
-		constexpr UInt32 MAX_VERTEX_COUNT = 1000000;
-		glBufferData(GL_ARRAY_BUFFER, MAX_VERTEX_COUNT * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, MAX_LINE_VERTICES_COUNT * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
 		
 		// Position attribute
 		glEnableVertexAttribArray(0);
@@ -288,28 +325,190 @@ void SRenderManager::draw_lines(const glm::vec3& color)
 	{
 		return;
 	}
-	diffuse.set_vec3("objectColor", color);
+	set_material({ glm::vec4(color, 1.0f) });
 
-	glBindBuffer(GL_ARRAY_BUFFER, linesVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, positions.size() * sizeof(glm::vec3), positions.data());
-	
 	glLineWidth(10.0f);
 	glDisable(GL_LINE_SMOOTH);
 
+	// Lines that don't fit into buffer are drawn in more batches instead of overflowing it
 	glBindVertexArray(linesVAO);
-	glDrawArrays(GL_LINES, 0, positions.size());
+	glBindBuffer(GL_ARRAY_BUFFER, linesVBO);
+	for (Int64 first = 0; first < Int64(positions.size()); first += MAX_LINE_VERTICES_COUNT)
+	{
+		const Int64 count = glm::min(Int64(positions.size()) - first, MAX_LINE_VERTICES_COUNT);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec3), positions.data() + first);
+		glDrawArrays(GL_LINES, 0, count);
+	}
 	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	positions.clear();
 }
 
+void SRenderManager::draw_springs(const glm::vec3& origin)
+{
+	SimulationManager &simulationManager = SimulationManager::get();
+	SResourceManager &resourceManager = SResourceManager::get();
+	const Int32 clothsCount = simulationManager.get_cloths_count();
+	if (springViewsVersion != simulationManager.get_cloths_version() || Int32(springViews.size()) != clothsCount)
+	{
+		delete_spring_views();
+		springViews.resize(clothsCount);
+		for (Int32 i = 0; i < clothsCount; ++i)
+		{
+			build_spring_view(springViews[i], simulationManager.get_cloth_data(i));
+		}
+		springViewsVersion = simulationManager.get_cloths_version();
+	}
+
+	Int32 typesMask = 0;
+	for (Int32 i = 0; i < 3; ++i)
+	{
+		typesMask |= springTypesShown[i] ? 1 << i : 0;
+	}
+	springs.set_mat4("model", glm::translate(glm::mat4(1.0f), origin));
+	springs.set_int("typesMask", typesMask);
+	springs.set_float("strainScale", strainScale);
+	glLineWidth(1.0f);
+
+	// Positions are read from buffer mesh was uploaded to this frame, CPU only rebinds it
+	for (Int32 i = 0; i < clothsCount; ++i)
+	{
+		const SpringView &springView = springViews[i];
+		resourceManager.share_positions(resourceManager.get_mesh_by_handle(simulationManager.get_cloth_data(i).simulatedMesh),
+										springView.vertexArray);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, springView.springsBuffer);
+		glBindVertexArray(springView.vertexArray);
+		glDrawElements(GL_LINES, 2 * springView.springsCount, GL_UNSIGNED_INT, 0);
+	}
+	glBindVertexArray(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+}
+
+void SRenderManager::build_spring_view(SpringView& springView, const ClothData& cloth)
+{
+	springView.springsCount = Int32(cloth.springIndexesA.size());
+	std::vector<UInt32> indexes(2 * springView.springsCount);
+	std::vector<glm::vec2> springsData(springView.springsCount);
+	for (Int32 i = 0; i < springView.springsCount; ++i)
+	{
+		indexes[2 * i]	   = UInt32(cloth.get_mesh_vertex(cloth.springIndexesA[i]));
+		indexes[2 * i + 1] = UInt32(cloth.get_mesh_vertex(cloth.springIndexesB[i]));
+		springsData[i]	   = { cloth.restLengths[i], Float32(cloth.get_spring_type(i)) };
+	}
+
+	glGenVertexArrays(1, &springView.vertexArray);
+	glGenBuffers(1, &springView.indexBuffer);
+	glGenBuffers(1, &springView.springsBuffer);
+
+	glBindVertexArray(springView.vertexArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, springView.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexes.size() * sizeof(UInt32), indexes.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, springView.springsBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, springsData.size() * sizeof(glm::vec2), springsData.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SRenderManager::delete_spring_views()
+{
+	for (SpringView &springView : springViews)
+	{
+		glDeleteVertexArrays(1, &springView.vertexArray);
+		glDeleteBuffers(1, &springView.indexBuffer);
+		glDeleteBuffers(1, &springView.springsBuffer);
+	}
+	springViews.clear();
+	springViewsVersion = -1;
+}
+
+void SRenderManager::draw_colliders(const glm::vec3& origin)
+{
+	SimulationManager &simulationManager = SimulationManager::get();
+	SResourceManager &resourceManager = SResourceManager::get();
+	const glm::mat4 simulationTransform = glm::translate(glm::mat4(1.0f), origin);
+	constexpr Int32 PLANE_LINES = 10;
+	constexpr Float32 PLANE_SIZE = 50.0f;
+
+	const Handle<Model> meshCollider = simulationManager.get_mesh_collider();
+	if (meshCollider != Handle<Model>::sNone)
+	{
+		diffuse.set_mat4("model", simulationTransform * simulationManager.get_mesh_collider_transform());
+		draw_model(resourceManager.get_model_by_handle(meshCollider), diffuse);
+	}
+
+	for (const ColliderShape &shape : simulationManager.get_collider_shapes())
+	{
+		switch (shape.shape)
+		{
+			case EColliderShape::Sphere:
+			{
+				diffuse.set_mat4("model", glm::scale(glm::translate(simulationTransform, shape.position), glm::vec3(shape.radius)));
+				draw_sphere(glm::vec3(0.8f, 0.3f, 0.3f));
+				break;
+			}
+			case EColliderShape::Capsule:
+			{
+				const glm::vec3 end	 = shape.position + shape.direction;
+				const glm::vec3 axis = glm::dot(shape.direction, shape.direction) > 0.0f ? glm::normalize(shape.direction) : glm::vec3(0.0f, 1.0f, 0.0f);
+				const glm::vec3 side = glm::normalize(glm::cross(axis, glm::abs(axis.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+				const glm::vec3 up	 = glm::cross(axis, side);
+				add_circle(shape.position, axis, shape.radius);
+				add_circle(end, axis, shape.radius);
+				for (const glm::vec3 &offset : { side, -side, up, -up })
+				{
+					add_line(shape.position + shape.radius * offset, end + shape.radius * offset);
+				}
+				break;
+			}
+			case EColliderShape::Plane:
+			{
+				const glm::vec3 normal = glm::normalize(shape.direction);
+				const glm::vec3 side   = glm::normalize(glm::cross(normal, glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+				const glm::vec3 up	   = glm::cross(normal, side);
+				for (Int32 i = -PLANE_LINES; i <= PLANE_LINES; ++i)
+				{
+					const Float32 offset = PLANE_SIZE * Float32(i) / Float32(PLANE_LINES);
+					add_line(shape.position + offset * side - PLANE_SIZE * up, shape.position + offset * side + PLANE_SIZE * up);
+					add_line(shape.position + offset * up - PLANE_SIZE * side, shape.position + offset * up + PLANE_SIZE * side);
+				}
+				break;
+			}
+		}
+	}
+
+	diffuse.set_mat4("model", simulationTransform);
+	draw_lines(glm::vec3(0.8f, 0.3f, 0.3f));
+}
+
+void SRenderManager::add_circle(const glm::vec3& center, const glm::vec3& axis, Float32 radius)
+{
+	constexpr Int32 SEGMENTS = 24;
+	const glm::vec3 side = glm::normalize(glm::cross(axis, glm::abs(axis.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 up	 = glm::cross(axis, side);
+	for (Int32 i = 0; i < SEGMENTS; ++i)
+	{
+		const Float32 begin = glm::two_pi<Float32>() * Float32(i) / Float32(SEGMENTS);
+		const Float32 end	= glm::two_pi<Float32>() * Float32(i + 1) / Float32(SEGMENTS);
+		add_line(center + radius * (glm::cos(begin) * side + glm::sin(begin) * up),
+				 center + radius * (glm::cos(end) * side + glm::sin(end) * up));
+	}
+}
+
 void SRenderManager::shutdown()
 {
 	SPDLOG_INFO("Render Manager shutdown.");
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
+	shadersWatcher.stop();
+	delete_spring_views();
+	glDeleteBuffers(1, &frameBuffer);
+	glDeleteBuffers(1, &materialBuffer);
 	diffuse.shutdown();
 	normals.shutdown();
+	springs.shutdown();
 }
 
 void SRenderManager::camera_gui(Camera &camera)
@@ -319,3 +518,65 @@ void SRenderManager::camera_gui(Camera &camera)
 	ImGui::DragFloat("Speed", &camera.speed, 1.0f, 0.f, 100.0f);
 	ImGui::End();
 }
+
+void SRenderManager::setup_shaders()
+{
+	diffuse.set_block("Frame", FRAME_BLOCK);
+	diffuse.set_block("Material", MATERIAL_BLOCK);
+	springs.set_block("Frame", FRAME_BLOCK);
+	diffuse.use();
+	for (Int32 i = 0; i < std::size(TEXTURE_SAMPLERS); ++i)
+	{
+		diffuse.set_int(TEXTURE_SAMPLERS[i], i);
+	}
+}
+
+void SRenderManager::reload_changed_shaders()
+{
+	const std::vector<std::string> changedFiles = shadersWatcher.take_changes();
+	if (changedFiles.empty())
+	{
+		return;
+	}
+	bool isReloaded = false;
+	for (Shader *shader : { &diffuse, &normals, &springs })
+	{
+		for (const std::string &fileName : changedFiles)
+		{
+			if (shader->has_source(fileName))
+			{
+				// Broken shader keeps its previous program, so it can be fixed while application runs
+				if (shader->reload())
+				{
+					SPDLOG_INFO("Reloaded shader after change of {}.", fileName);
+					isReloaded = true;
+				}
+				break;
+			}
+		}
+	}
+	if (isReloaded)
+	{
+		setup_shaders();
+	}
+}
+
+void SRenderManager::set_material(const MaterialData& materialData)
+{
+	if (materialData != boundMaterial)
+	{
+		boundMaterial = materialData;
+		Shader::s_bind_uniform_buffer(materialBuffer, 0, sizeof(MaterialData), &boundMaterial.color[0]);
+	}
+}
+
+void SRenderManager::debug_gui()
+{
+	ImGui::Begin("Debug view");
+	ImGui::Checkbox("Structural springs", &springTypesShown[Int32(ESpringType::Structural)]);
+	ImGui::Checkbox("Shear springs", &springTypesShown[Int32(ESpringType::Shear)]);
+	ImGui::Checkbox("Flexion springs", &springTypesShown[Int32(ESpringType::Flexion)]);
+	ImGui::DragFloat("Strain scale", &strainScale, 0.5f, 1.0f, 1000.0f, "%.1f");
+	ImGui::Text("Red springs are stretched, blue compressed, full colour at strain 1 / scale");
+	ImGui::End();
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "Common/shader.hpp"
+#include "Common/file_watcher.hpp"
 
 class SRenderManager
 {
@@ -19,11 +20,60 @@ public:
 	void shutdown();
 
 private:
+	// Uniform blocks, std140 layout of Frame and Material blocks in shaders
+	struct FrameData
+	{
+		glm::mat4 viewProjection;
+		glm::vec4 cameraPosition;
+	};
+
+	struct MaterialData
+	{
+		glm::vec4 color	   = glm::vec4(1.0f);
+		UInt32 texturesMask = 0; // Bit i is set when texture unit i has texture of material slot i
+		UInt32 padding[3]	= {};
+
+		bool operator==(const MaterialData& other) const = default;
+	};
+
+	// Springs of one cloth drawn straight from its uploaded positions, buffers are built once per cloths version
+	struct SpringView
+	{
+		UInt32 vertexArray	 = 0;
+		UInt32 indexBuffer	 = 0; // Mass point pairs in order of springs, so line primitive id is spring index
+		UInt32 springsBuffer = 0; // Rest length and type of every spring
+		Int32 springsCount	 = 0;
+	};
+
 	SRenderManager() = default;
 	~SRenderManager() = default;
 
+	// Block bindings and sampler units are state of program, so they are set again after reload
+	void setup_shaders();
+	// Reloads shaders whose sources were written since last frame
+	void reload_changed_shaders();
 	void camera_gui(class Camera& camera);
-	Shader diffuse, normals;
+	void debug_gui();
+	// Uploads material block only if it differs from the one drawn last
+	void set_material(const MaterialData& materialData);
+	void draw_springs(const glm::vec3& origin);
+	void build_spring_view(SpringView& springView, const struct ClothData& cloth);
+	void delete_spring_views();
+	// Static colliders of simulation, origin is translation applied to whole simulation
+	void draw_colliders(const glm::vec3& origin);
+	void add_circle(const glm::vec3& center, const glm::vec3& axis, Float32 radius);
+	Shader diffuse, normals, springs;
+	FileWatcher shadersWatcher;
 	std::vector<glm::vec3> positions;
+
+	UInt32 frameBuffer	  = 0;
+	UInt32 materialBuffer = 0;
+	MaterialData boundMaterial;
+
+	std::vector<SpringView> springViews;
+	Int64 springViewsVersion = -1;
+	bool springTypesShown[3] = { true, true, true }; // By ESpringType
+	Float32 strainScale = 10.0f; // Strain of full colour
+
 };
 
@@ -10,13 +10,53 @@
 #include "Common/material.hpp"
 #include "Common/mesh.hpp"
 #include "Common/texture.hpp"
+#include "Common/worker_pool.hpp"
 
 #include <filesystem>
 #include <glad/glad.h>
 
+// S3TC formats aren't core, but every desktop driver supports them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+	// Static buffer of every mesh
+	struct StaticVertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	struct PackedVertex
+	{
+		glm::vec3 position;
+		UInt32 normal;
+	};
+
+	// Signed normalized 10 bits per component, w stays zero
+	UInt32 pack_normal(const glm::vec3& normal)
+	{
+		const glm::vec3 scaled = glm::round(glm::clamp(normal, glm::vec3(-1.0f), glm::vec3(1.0f)) * 511.0f);
+		return (UInt32(Int32(scaled.x)) & 0x3FF) | ((UInt32(Int32(scaled.y)) & 0x3FF) << 10) | ((UInt32(Int32(scaled.z)) & 0x3FF) << 20);
+	}
+
+	Int64 get_vertex_size(EVertexFormat format)
+	{
+		return format == EVertexFormat::Packed ? Int64(sizeof(PackedVertex)) : Int64(2 * sizeof(glm::vec3));
+	}
+}
+
 void SResourceManager::startup()
 {
 	SPDLOG_INFO("Resource Manager startup.");
+	// Main thread only uploads, so it is left to render
+	textureLoader.startup(glm::max(WorkerPool::s_get_hardware_threads_count() - 1, 1));
 	Material defaultMaterial;
 	defaultMaterial.albedo			 = load_texture(TEXTURES_PATH + "Default/Albedo.png", "DefaultBaseColor", ETextureType::Albedo);
 	defaultMaterial.normal			 = load_texture(TEXTURES_PATH + "Default/Normal.png", "DefaultNormal", ETextureType::Normal);
@@ -32,72 +72,144 @@ SResourceManager& SResourceManager::get()
 	return instance;
 }
 
-void SResourceManager::load_gltf_asset(const std::string& filePath)
+std::vector<Handle<Model>> SResourceManager::load_gltf_asset(const std::string& filePath)
 {
-	load_gltf_asset(std::filesystem::path(filePath));
+	return load_gltf_asset(std::filesystem::path(filePath));
 }
 
-void SResourceManager::load_gltf_asset(const std::filesystem::path & filePath)
+std::vector<Handle<Model>> SResourceManager::load_gltf_asset(const std::filesystem::path & filePath)
 {
 	tinygltf::Model gltfModel;
 	std::string error;
 	std::string warning;
 
 	tinygltf::TinyGLTF loader;
+	// Images are decoded by texture loader from their files, tinygltf would decode every one of them again on this thread
+	loader.SetImageLoader([](tinygltf::Image*, const Int32, std::string*, std::string*, Int32, Int32, const UInt8*, Int32, void*)
+	{
+		return true;
+	}, nullptr);
 
 	if (!loader.LoadASCIIFromFile(&gltfModel, &error, &warning, filePath.string()) || !warning.empty() || !error.empty())
 	{
 		SPDLOG_ERROR("Failed to load gltf file: {} - {} - {}", filePath.string(), error, warning);
-		return;
+		return {};
 	}
 
+	std::vector<Handle<Model>> loadedModels;
 	for (tinygltf::Mesh& gltfMesh : gltfModel.meshes)
 	{
-		load_model(filePath, gltfMesh, gltfModel);
+		const Handle<Model> model = load_model(filePath, gltfMesh, gltfModel);
+		if (model != Handle<Model>::sNone)
+		{
+			loadedModels.emplace_back(model);
+		}
 	}
+	return loadedModels;
 }
 
-void SResourceManager::generate_opengl_texture(Texture& texture)
+void SResourceManager::generate_opengl_texture(Texture& texture, const TextureBake& bake)
 {
-	glGenTextures(1, &texture.gpuId);
-	glBindTexture(GL_TEXTURE_2D, texture.gpuId);
+	GLenum format = GL_RGBA;
+	switch (bake.get_format())
+	{
+		case ETextureFormat::RGB8:
+			format = GL_RGB;
+		break;
+		case ETextureFormat::BC1:
+			format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		break;
+		case ETextureFormat::BC3:
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+		default:
+		break;
+	}
 
-	if (texture.channels == 3)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 
-				     0, 
-					 GL_RGB, 
-					 texture.size.x, 
-					 texture.size.y,
-					 0, 
-					 GL_RGB,
-					 GL_UNSIGNED_BYTE,
-					 texture.data);
-	}
-	else if (texture.channels == 4)
-	{
-		glTexImage2D(GL_TEXTURE_2D,
-					 0,
-					 GL_RGBA,
-					 texture.size.x,
-					 texture.size.y,
-					 0,
-					 GL_RGBA,
-					 GL_UNSIGNED_BYTE,
-					 texture.data);
-	} else {
-		SPDLOG_WARN("Not supported count of channels: {}", texture.channels);
-		glDeleteTextures(1, &texture.gpuId);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	// Pixel buffer is orphaned by every upload, copy into texture doesn't wait for draws using previous one.
+	// Levels are stored one after another, so they are copied at once
+	const Int64 size = bake.get_bytes();
+	if (textureUploadBuffer == 0)
+	{
+		glGenBuffers(1, &textureUploadBuffer);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, textureUploadBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void *pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (!pixels)
+	{
+		SPDLOG_ERROR("Failed to map texture upload buffer.");
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 		return;
 	}
+	std::memcpy(pixels, bake.get_level_data(0), size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glGenTextures(1, &texture.gpuId);
+	glBindTexture(GL_TEXTURE_2D, texture.gpuId);
+	// Rows of RGB images aren't aligned to 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	Int64 offset = 0;
+	for (Int32 level = 0; level < bake.get_levels_count(); ++level)
+	{
+		const glm::ivec2 levelSize = bake.get_level_size(level);
+		if (format == GL_RGB || format == GL_RGBA)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, format, levelSize.x, levelSize.y, 0, format, GL_UNSIGNED_BYTE, (void*)offset);
+		} else {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, levelSize.x, levelSize.y, 0, GLsizei(bake.get_level_bytes(level)), (void*)offset);
+		}
+		offset += bake.get_level_bytes(level);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, bake.get_levels_count() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.size	 = bake.get_level_size(0);
+	texture.channels = format == GL_RGB || format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3 : 4;
+}
+
+void SResourceManager::upload_loaded_textures(Int64 budget)
+{
+	Int64 uploadedSize = 0;
+	TextureLoader::Image image;
+	while (uploadedSize < budget && textureLoader.take_image(image))
+	{
+		if (!image.bake)
+		{
+			SPDLOG_ERROR("Texture {} loading failed.", image.filePath);
+			continue;
+		}
+		Texture *texture = textures.get(image.texture);
+		if (!texture)
+		{
+			continue;
+		}
+		generate_opengl_texture(*texture, *image.bake);
+		uploadedSize += image.bake->get_bytes();
+		image.bake.reset();
+	}
+}
+
+Int32 SResourceManager::get_loading_textures_count() const
+{
+	return textureLoader.get_pending_count();
+}
+
+void SResourceManager::set_texture_compression(bool isEnabled)
+{
+	isTextureCompressed = isEnabled;
+}
+
+bool SResourceManager::is_texture_compressed() const
+{
+	return isTextureCompressed;
 }
 
 void SResourceManager::generate_opengl_model(Model& model)
@@ -113,27 +225,28 @@ void SResourceManager::generate_opengl_model(Model& model)
 		glBindVertexArray(mesh.gpuIds[0]);
 		glBindBuffer(GL_ARRAY_BUFFER, mesh.gpuIds[2]);
 
-		const Int64 positionsSize = mesh.positions.size() * sizeof(glm::vec3);
-		const Int64 normalsSize	  = mesh.normals.size() * sizeof(glm::vec3);
-		const Int64 uvsSize		  = mesh.uvs.size() * sizeof(glm::vec2);
-
-		glBufferData(GL_ARRAY_BUFFER, positionsSize + normalsSize + uvsSize, nullptr, GL_STATIC_DRAW);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, positionsSize, mesh.positions.data());
-		glBufferSubData(GL_ARRAY_BUFFER, positionsSize, normalsSize, mesh.normals.data());
-		glBufferSubData(GL_ARRAY_BUFFER, positionsSize + normalsSize, uvsSize, mesh.uvs.data());
+		// Interleaved, meshes without normals or uvs get zeros
+		std::vector<StaticVertex> vertices(mesh.positions.size());
+		for (Int64 i = 0; i < Int64(vertices.size()); ++i)
+		{
+			vertices[i].position = mesh.positions[i];
+			vertices[i].normal	 = i < Int64(mesh.normals.size()) ? mesh.normals[i] : glm::vec3(0.0f);
+			vertices[i].uv		 = i < Int64(mesh.uvs.size()) ? mesh.uvs[i] : glm::vec2(0.0f);
+		}
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(StaticVertex), vertices.data(), GL_STATIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.gpuIds[1]);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexes.size() * sizeof(UInt32), mesh.indexes.data(), GL_STATIC_DRAW);
 
 		// Position attribute
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, position));
 		// Normal attribute
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)positionsSize);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, normal));
 		// Texture position attribute
 		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(positionsSize + normalsSize));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, uv));
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -145,30 +258,176 @@ void SResourceManager::update_opengl_model(Model& model)
 {
 	for (const Handle<Mesh> &handle : model.meshes)
 	{
-		Mesh &mesh = get_mesh_by_handle(handle);
+		const Mesh &mesh = get_mesh_by_handle(handle);
+		update_opengl_mesh(mesh, mesh.positions.data(), mesh.normals.data());
+	}
+}
+
+void SResourceManager::update_opengl_mesh(const Mesh& mesh, const glm::vec3* positions, const glm::vec3* normals)
+{
+	const Int64 verticesCount = Int64(mesh.positions.size());
+	StreamingBuffer &streamingBuffer = get_streaming_buffer(mesh);
+	Int64 regionOffset = 0;
+	UInt8 *vertices = nullptr;
+	if (streamingBuffer.mapped)
+	{
+		// Draws reading last written region were issued since it was written, fence goes after them
+		Int32 &region = streamingBuffer.region;
+		streamingBuffer.fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % UPLOAD_REGIONS_COUNT;
+
+		if (streamingBuffer.fences[region])
+		{
+			GLsync fence = static_cast<GLsync>(streamingBuffer.fences[region]);
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				uploadWaits++;
+				do
+				{
+					result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+				} while (result == GL_TIMEOUT_EXPIRED);
+			}
+			glDeleteSync(fence);
+			streamingBuffer.fences[region] = nullptr;
+		}
+
+		// Mapping is coherent, written data is visible to draws issued after this without flush
+		regionOffset = region * streamingBuffer.regionSize;
+		vertices	 = streamingBuffer.mapped + regionOffset;
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.buffer);
+		vertices = static_cast<UInt8*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, streamingBuffer.regionSize,
+														GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	}
+
+	if (streamingBuffer.format == EVertexFormat::Packed)
+	{
+		PackedVertex *packedVertices = reinterpret_cast<PackedVertex*>(vertices);
+		for (Int64 i = 0; i < verticesCount; ++i)
+		{
+			packedVertices[i].position = positions[i];
+			packedVertices[i].normal   = pack_normal(normals[i]);
+		}
+	} else {
+		std::memcpy(vertices, positions, verticesCount * sizeof(glm::vec3));
+		std::memcpy(vertices + verticesCount * sizeof(glm::vec3), normals, verticesCount * sizeof(glm::vec3));
+	}
 
-		const Int64 positionsSize = mesh.positions.size() * sizeof(glm::vec3);
-		const Int64 normalsSize = mesh.normals.size() * sizeof(glm::vec3);
+	glBindVertexArray(mesh.gpuIds[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.buffer);
+	if (!streamingBuffer.mapped)
+	{
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	if (streamingBuffer.format == EVertexFormat::Packed)
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)(regionOffset + offsetof(PackedVertex, position)));
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)(regionOffset + offsetof(PackedVertex, normal)));
+	} else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)regionOffset);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)(regionOffset + verticesCount * sizeof(glm::vec3)));
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
+void SResourceManager::share_positions(const Mesh& mesh, UInt32 vertexArray)
+{
+	glBindVertexArray(vertexArray);
+	const auto found = streamingBuffers.find(mesh.gpuIds[0]);
+	if (found != streamingBuffers.end() && found->second.buffer)
+	{
+		const StreamingBuffer &streamingBuffer = found->second;
+		const Int64 regionOffset = streamingBuffer.mapped ? streamingBuffer.region * streamingBuffer.regionSize : 0;
+		const Int32 stride = streamingBuffer.format == EVertexFormat::Packed ? sizeof(PackedVertex) : sizeof(glm::vec3);
+		glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.buffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)regionOffset);
+	} else {
+		// Mesh wasn't uploaded yet, static buffer has its initial positions
 		glBindBuffer(GL_ARRAY_BUFFER, mesh.gpuIds[2]);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, positionsSize, mesh.positions.data());
-		glBufferSubData(GL_ARRAY_BUFFER, positionsSize, normalsSize, mesh.normals.data());
-		
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, position));
+	}
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+Int64 SResourceManager::get_upload_waits() const
+{
+	return uploadWaits;
+}
+
+void SResourceManager::set_vertex_format(EVertexFormat format)
+{
+	vertexFormat = format;
+}
+
+EVertexFormat SResourceManager::get_vertex_format() const
+{
+	return vertexFormat;
+}
+
+SResourceManager::StreamingBuffer& SResourceManager::get_streaming_buffer(const Mesh& mesh)
+{
+	const Int64 regionSize = mesh.positions.size() * get_vertex_size(vertexFormat);
+	StreamingBuffer &streamingBuffer = streamingBuffers[mesh.gpuIds[0]];
+	if (streamingBuffer.buffer && streamingBuffer.regionSize == regionSize && streamingBuffer.format == vertexFormat)
+	{
+		return streamingBuffer;
+	}
+
+	delete_streaming_buffer(streamingBuffer);
+	glGenBuffers(1, &streamingBuffer.buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.buffer);
+	if (GLAD_GL_VERSION_4_4)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, UPLOAD_REGIONS_COUNT * regionSize, nullptr, flags);
+		streamingBuffer.mapped = static_cast<UInt8*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, UPLOAD_REGIONS_COUNT * regionSize, flags));
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+	}
+	streamingBuffer.format	   = vertexFormat;
+	streamingBuffer.regionSize = regionSize;
+	streamingBuffer.region	   = UPLOAD_REGIONS_COUNT - 1;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return streamingBuffer;
+}
+
+void SResourceManager::delete_streaming_buffer(StreamingBuffer& streamingBuffer)
+{
+	for (void *&fence : streamingBuffer.fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+	}
+	if (streamingBuffer.mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
+	if (streamingBuffer.buffer)
+	{
+		glDeleteBuffers(1, &streamingBuffer.buffer);
+	}
+	streamingBuffer = StreamingBuffer();
 }
 
 Handle<Model> SResourceManager::load_model(const std::filesystem::path & filePath, tinygltf::Mesh &gltfMesh, tinygltf::Model &gltfModel)
 {
-	if (nameToIdModels.find(gltfMesh.name) != nameToIdModels.end())
+	const Handle<Model> modelHandle = models.add(gltfMesh.name);
+	if (modelHandle == Handle<Model>::sNone)
 	{
 		SPDLOG_ERROR("Model with name {} already exist!", gltfMesh.name);
 		return Handle<Model>::sNone;
 	}
-
-	models.emplace_back();
-	const Int64 modelId = models.size() - 1;
-	Model &model = models[modelId];
+	// Slots don't move, so reference stays valid while meshes and materials are loaded
+	Model &model = *models.get(modelHandle);
 
 	model.meshes.reserve(gltfMesh.primitives.size());
 	model.directory = filePath.string();
@@ -179,7 +438,7 @@ Handle<Model> SResourceManager::load_model(const std::filesystem::path & filePat
 		std::string meshName = gltfMesh.name + std::to_string(i);
 		Handle<Mesh> mesh = load_mesh(meshName, primitive, gltfModel);
 		model.meshes.push_back(mesh);
-		Handle<Material> material = get_material_handle_by_name("DefaultMaterial");
+		Handle<Material> material = materials.find("DefaultMaterial");
 		if (primitive.material >= 0)
 		{
 			material = load_material(filePath.parent_path(), 
@@ -189,23 +448,18 @@ Handle<Model> SResourceManager::load_model(const std::filesystem::path & filePat
 		model.materials.push_back(material);
 	}
 
-	Handle<Model> modelHandle{ Int32(modelId) };
-	nameToIdModels[gltfMesh.name] = modelHandle;
-
 	return modelHandle;
 }
 
 Handle<Mesh> SResourceManager::load_mesh(const std::string& meshName, tinygltf::Primitive& primitive, tinygltf::Model& gltfModel)
 {
-	if (nameToIdMeshes.find(meshName) != nameToIdMeshes.end())
+	const Handle<Mesh> meshHandle = meshes.add(meshName);
+	if (meshHandle == Handle<Mesh>::sNone)
 	{
 		SPDLOG_ERROR("Mesh with name {} already exist!", meshName);
 		return Handle<Mesh>::sNone;
 	}
-
-	meshes.emplace_back();
-	const Int64 meshId = meshes.size() - 1;
-	Mesh &mesh   = meshes[meshes.size() - 1];
+	Mesh &mesh = *meshes.get(meshHandle);
 
 	const tinygltf::Accessor& indexesAccessor = gltfModel.accessors[primitive.indices];
 	Int32 indexesType						  = indexesAccessor.componentType;
@@ -223,10 +477,15 @@ Handle<Mesh> SResourceManager::load_mesh(const std::string& meshName, tinygltf::
 			process_accessor<Int16>(gltfModel, indexesAccessor, mesh.indexes);
 			break;
 		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		{
+			process_accessor<UInt32>(gltfModel, indexesAccessor, mesh.indexes);
+			break;
+		}
 		default:
 		{
 			SPDLOG_ERROR("Mesh indexes not loaded, not supported type: GLTF_COMPONENT_TYPE {}; Name {}", indexesType, meshName);
-			meshes.pop_back();
+			meshes.remove(meshHandle);
 			return Handle<Mesh>::sNone;
 		}	
 	}
@@ -244,12 +503,12 @@ Handle<Mesh> SResourceManager::load_mesh(const std::string& meshName, tinygltf::
 			process_accessor<glm::vec3>(gltfModel, positionsAccessor, mesh.positions);
 		} else {
 			SPDLOG_ERROR("Mesh positions not loaded, not supported type: GLTF_COMPONENT_TYPE {}; Name {}", positionsType, meshName);
-			meshes.pop_back();
+			meshes.remove(meshHandle);
 			return Handle<Mesh>::sNone;
 		}
 	} else {
 		SPDLOG_ERROR("Mesh positions not loaded, not supported type: GLTF_TYPE {}; Name {}", positionsTypeCount, meshName);
-		meshes.pop_back();
+		meshes.remove(meshHandle);
 		return Handle<Mesh>::sNone;
 	}
 
@@ -266,12 +525,12 @@ Handle<Mesh> SResourceManager::load_mesh(const std::string& meshName, tinygltf::
 			process_accessor<glm::vec3>(gltfModel, normalsAccessor, mesh.normals);
 		} else {
 			SPDLOG_ERROR("Mesh normals not loaded, not supported type: GLTF_COMPONENT_TYPE {}; Name {}", normalsType, meshName);
-			meshes.pop_back();
+			meshes.remove(meshHandle);
 			return Handle<Mesh>::sNone;
 		}
 	} else {
 		SPDLOG_ERROR("Mesh normals not loaded, not supported type: GLTF_TYPE {}; Name {}", normalsTypeCount, meshName);
-		meshes.pop_back();
+		meshes.remove(meshHandle);
 		return Handle<Mesh>::sNone;
 	}
 
@@ -288,32 +547,27 @@ Handle<Mesh> SResourceManager::load_mesh(const std::string& meshName, tinygltf::
 			process_accessor<glm::vec2>(gltfModel, uvsAccessor, mesh.uvs);
 		} else {
 			SPDLOG_ERROR("Mesh uvs not loaded, not supported type: GLTF_COMPONENT_TYPE {}; Name {}", uvsType, meshName);
-			meshes.pop_back();
+			meshes.remove(meshHandle);
 			return Handle<Mesh>::sNone;
 		}
 	} else {
 		SPDLOG_ERROR("Mesh uvs not loaded, not supported type: GLTF_TYPE {}; Name {}", uvsTypeCount, meshName);
-		meshes.pop_back();
+		meshes.remove(meshHandle);
 		return Handle<Mesh>::sNone;
 	}
 
-	Handle<Mesh> meshHandle{ Int32(meshId) };
-	nameToIdMeshes[meshName] = meshHandle;
-
 	return meshHandle;
 }
 
 Handle<Material> SResourceManager::load_material(const std::filesystem::path& assetPath, tinygltf::Material& gltfMaterial, tinygltf::Model& gltfModel)
 {
-	if (nameToIdMaterials.find(gltfMaterial.name) != nameToIdMaterials.end())
+	const Handle<Material> materialHandle = materials.add(gltfMaterial.name);
+	if (materialHandle == Handle<Material>::sNone)
 	{
 		SPDLOG_ERROR("Material with name {} already exist!", gltfMaterial.name);
 		return Handle<Material>::sNone;
 	}
-
-	materials.emplace_back();
-	Int64 materialId   = materials.size() - 1;
-	Material& material = materials[materialId];
+	Material& material = *materials.get(materialHandle);
 
 	const Int32 albedoId			  = gltfMaterial.pbrMetallicRoughness.baseColorTexture.index;
 	const Int32 metallicRoughnessId	  = gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index;
@@ -362,145 +616,126 @@ Handle<Material> SResourceManager::load_material(const std::filesystem::path& as
 		material.emission = load_texture(assetPath / image.uri, textureName.stem().string(), ETextureType::Emission);
 	}
 
-	Handle<Material> materialHandle{ Int32(materialId) };
-	nameToIdMaterials[gltfMaterial.name] = materialHandle;
-
 	return materialHandle;
 }
 
 Handle<Texture> SResourceManager::load_texture(const std::filesystem::path& filePath, const std::string& textureName, ETextureType type)
 {
-	if (nameToIdTextures.find(textureName) != nameToIdTextures.end())
+	const Handle<Texture> textureHandle = textures.add(textureName);
+	if (textureHandle == Handle<Texture>::sNone)
 	{
 		SPDLOG_ERROR("Texture with name {} already exist!", textureName);
 		return Handle<Texture>::sNone;
 	}
+	Texture& texture = *textures.get(textureHandle);
 
-	textures.emplace_back();
-	Int64 textureId = textures.size() - 1;
-	Texture& texture = textures[textureId];
-
-	texture.data = stbi_load(filePath.string().c_str(), &texture.size.x, &texture.size.y, &texture.channels, 0);
 	texture.type = type;
-	if (!texture.data)
+	if (!std::filesystem::is_regular_file(filePath))
 	{
 		SPDLOG_ERROR("Texture {} loading failed.", filePath.string());
-		textures.pop_back();
+		textures.remove(textureHandle);
 		return Handle<Texture>::sNone;
 	}
-
-	Handle<Texture> textureHandle{ Int32(textureId) };
-	nameToIdTextures[textureName] = textureHandle;
+	// Block compression blurs directions of normal maps
+	textureLoader.load(textureHandle, filePath.string(), isTextureCompressed && type != ETextureType::Normal);
 
 	return textureHandle;
 }
 
 Handle<Material> SResourceManager::create_material(Material& material, const std::string& name)
 {
-	if (nameToIdMaterials.contains(name))
+	const Handle<Material> materialHandle = materials.add(name, material);
+	if (materialHandle == Handle<Material>::sNone)
 	{
 		SPDLOG_ERROR("Material with name {} is already exist.", name);
-		return Handle<Material>::sNone;
 	}
-	materials.emplace_back(material);
-	Handle<Material> materialHandle{ Int32(materials.size()) - 1 };
-	nameToIdMaterials[name] = materialHandle;
-
 	return materialHandle;
 }
 
 Handle<Model> SResourceManager::create_model(const Model &model, const std::string& name)
 {
-	if (nameToIdModels.contains(name))
+	const Handle<Model> modelHandle = models.add(name, model);
+	if (modelHandle == Handle<Model>::sNone)
 	{
 		SPDLOG_ERROR("Model with name {} is already exist.", name);
-		return Handle<Model>::sNone;
 	}
-	models.emplace_back(model);
-	Handle<Model> modelHandle{ Int32(models.size()) - 1 };
-	nameToIdModels[name] = modelHandle;
-
 	return modelHandle;
 }
 
 Handle<Mesh> SResourceManager::create_mesh(const std::string& name)
 {
-	if (nameToIdMeshes.contains(name))
+	const Handle<Mesh> meshHandle = meshes.add(name);
+	if (meshHandle == Handle<Mesh>::sNone)
 	{
 		SPDLOG_ERROR("Mesh with name {} is already exist.", name);
-		return Handle<Mesh>::sNone;
 	}
-	meshes.emplace_back();
-	Handle<Mesh> meshHandle{ Int32(meshes.size()) - 1 };
-	nameToIdMeshes[name] = meshHandle;
-
 	return meshHandle;
 }
 
-Model& SResourceManager::get_model_by_name(const std::string& name)
+Model& SResourceManager::get_model_by_name(ResourceName name)
 {
-	const auto& iterator = nameToIdModels.find(name);
-	if (iterator == nameToIdModels.end() || iterator->second.id < 0 || iterator->second.id >= models.size())
+	Model *model = models.get(models.find(name));
+	if (!model)
 	{
-		SPDLOG_WARN("Model {} not found, returned default.", name);
-		return models[0];
+		SPDLOG_WARN("Model with name hash {:#x} not found, returned default.", name.hash);
+		return models.get_first();
 	}
-
-	return models[iterator->second.id];
+	return *model;
 }
 
 Model& SResourceManager::get_model_by_handle(const Handle<Model> handle)
 {
-	if (handle.id >= models.size())
+	Model *model = models.get(handle);
+	if (!model)
 	{
 		SPDLOG_WARN("Model {} not found, returned default.", handle.id);
-		return models[0];
+		return models.get_first();
 	}
-	return models[handle.id];
+	return *model;
 }
 
-Mesh& SResourceManager::get_mesh_by_name(const std::string& name)
+Mesh& SResourceManager::get_mesh_by_name(ResourceName name)
 {
-	const auto& iterator = nameToIdMeshes.find(name);
-	if (iterator == nameToIdMeshes.end() || iterator->second.id < 0 || iterator->second.id >= meshes.size())
+	Mesh *mesh = meshes.get(meshes.find(name));
+	if (!mesh)
 	{
-		SPDLOG_WARN("Mesh {} not found, returned default.", name);
-		return meshes[0];
+		SPDLOG_WARN("Mesh with name hash {:#x} not found, returned default.", name.hash);
+		return meshes.get_first();
 	}
-
-	return meshes[iterator->second.id];
+	return *mesh;
 }
 
 Mesh& SResourceManager::get_mesh_by_handle(const Handle<Mesh> handle)
 {
-	if (handle.id >= meshes.size())
+	Mesh *mesh = meshes.get(handle);
+	if (!mesh)
 	{
 		SPDLOG_WARN("Mesh {} not found, returned default.", handle.id);
-		return meshes[0];
+		return meshes.get_first();
 	}
-	return meshes[handle.id];
+	return *mesh;
 }
 
-Material& SResourceManager::get_material_by_name(const std::string& name)
+Material& SResourceManager::get_material_by_name(ResourceName name)
 {
-	const auto& iterator = nameToIdMaterials.find(name);
-	if (iterator == nameToIdMaterials.end() || iterator->second.id < 0 || iterator->second.id >= materials.size())
+	Material *material = materials.get(materials.find(name));
+	if (!material)
 	{
-		SPDLOG_WARN("Material {} not found, returned default.", name);
-		return materials[0];
+		SPDLOG_WARN("Material with name hash {:#x} not found, returned default.", name.hash);
+		return materials.get_first();
 	}
-
-	return materials[iterator->second.id];
+	return *material;
 }
 
 Material& SResourceManager::get_material_by_handle(const Handle<Material> handle)
 {
-	if (handle.id >= materials.size())
+	Material *material = materials.get(handle);
+	if (!material)
 	{
 		SPDLOG_WARN("Material {} not found, returned default.", handle.id);
-		return materials[0];
+		return materials.get_first();
 	}
-	return materials[handle.id];
+	return *material;
 }
 
 Material& SResourceManager::get_default_material()
@@ -508,88 +743,84 @@ Material& SResourceManager::get_default_material()
 	return get_material_by_name("DefaultMaterial");
 }
 
-Texture& SResourceManager::get_texture_by_name(const std::string& name)
+Texture& SResourceManager::get_texture_by_name(ResourceName name)
 {
-	const auto& iterator = nameToIdTextures.find(name);
-	if (iterator == nameToIdTextures.end() || iterator->second.id < 0 || iterator->second.id >= textures.size())
+	Texture *texture = textures.get(textures.find(name));
+	if (!texture)
 	{
-		SPDLOG_WARN("Texture {} not found, returned default.", name);
-		return textures[0];
+		SPDLOG_WARN("Texture with name hash {:#x} not found, returned default.", name.hash);
+		return textures.get_first();
 	}
-
-	return textures[iterator->second.id];
+	return *texture;
 }
 
 Texture& SResourceManager::get_texture_by_handle(const Handle<Texture> handle)
 {
-	if (handle.id >= textures.size())
+	Texture *texture = textures.get(handle);
+	if (!texture)
 	{
 		SPDLOG_WARN("Texture {} not found, returned default.", handle.id);
-		return textures[0];
+		return textures.get_first();
 	}
-	return textures[handle.id];
+	return *texture;
 }
 
-const Handle<Model> &SResourceManager::get_model_handle_by_name(const std::string &name)
+Handle<Model> SResourceManager::get_model_handle_by_name(ResourceName name) const
 {
-	const auto &iterator = nameToIdModels.find(name);
-	if (iterator == nameToIdModels.end())
+	const Handle<Model> handle = models.find(name);
+	if (handle == Handle<Model>::sNone)
 	{
-		SPDLOG_WARN("Model handle {} not found, returned none.", name);
-		return Handle<Model>::sNone;
+		SPDLOG_WARN("Model handle with name hash {:#x} not found, returned none.", name.hash);
 	}
-	return iterator->second;
+	return handle;
 }
 
-const Handle<Mesh> &SResourceManager::get_mesh_handle_by_name(const std::string &name)
+Handle<Mesh> SResourceManager::get_mesh_handle_by_name(ResourceName name) const
 {
-	const auto &iterator = nameToIdMeshes.find(name);
-	if (iterator == nameToIdMeshes.end())
+	const Handle<Mesh> handle = meshes.find(name);
+	if (handle == Handle<Mesh>::sNone)
 	{
-		SPDLOG_WARN("Mesh handle {} not found, returned none.", name);
-		return Handle<Mesh>::sNone;
+		SPDLOG_WARN("Mesh handle with name hash {:#x} not found, returned none.", name.hash);
 	}
-	return iterator->second;
+	return handle;
 }
 
-const Handle<Material> &SResourceManager::get_material_handle_by_name(const std::string &name)
+Handle<Material> SResourceManager::get_material_handle_by_name(ResourceName name) const
 {
-	const auto &iterator = nameToIdMaterials.find(name);
-	if (iterator == nameToIdMaterials.end())
+	const Handle<Material> handle = materials.find(name);
+	if (handle == Handle<Material>::sNone)
 	{
-		SPDLOG_WARN("Material handle {} not found, returned none.", name);
-		return Handle<Material>::sNone;
+		SPDLOG_WARN("Material handle with name hash {:#x} not found, returned none.", name.hash);
 	}
-	return iterator->second;
+	return handle;
 }
 
-const Handle<Texture>& SResourceManager::get_texture_handle_by_name(const std::string& name)
+Handle<Texture> SResourceManager::get_texture_handle_by_name(ResourceName name) const
 {
-	const auto &iterator = nameToIdTextures.find(name);
-	if (iterator == nameToIdTextures.end())
+	const Handle<Texture> handle = textures.find(name);
+	if (handle == Handle<Texture>::sNone)
 	{
-		SPDLOG_WARN("Texture handle {} not found, returned none.", name);
-		return Handle<Texture>::sNone;
+		SPDLOG_WARN("Texture handle with name hash {:#x} not found, returned none.", name.hash);
 	}
-	return iterator->second;
+	return handle;
 }
 
-const std::vector<Model>& SResourceManager::get_models() const
+const ResourceRegistry<Model>& SResourceManager::get_models() const
 {
 	return models;
 }
 
-const std::vector<Mesh>& SResourceManager::get_meshes() const
+const ResourceRegistry<Mesh>& SResourceManager::get_meshes() const
 {
 	return meshes;
 }
 
-const std::vector<Material>& SResourceManager::get_materials() const
+const ResourceRegistry<Material>& SResourceManager::get_materials() const
 {
 	return materials;
 }
 
-const std::vector<Texture>& SResourceManager::get_textures() const
+const ResourceRegistry<Texture>& SResourceManager::get_textures() const
 {
 	return textures;
 }
@@ -597,24 +828,32 @@ const std::vector<Texture>& SResourceManager::get_textures() const
 void SResourceManager::shutdown()
 {
 	SPDLOG_INFO("Resource Manager shutdown.");
-	nameToIdTextures.clear();
-	for (Texture& texture : textures)
+	textureLoader.shutdown();
+	if (textureUploadBuffer)
+	{
+		glDeleteBuffers(1, &textureUploadBuffer);
+		textureUploadBuffer = 0;
+	}
+	textures.for_each([](Handle<Texture>, Texture& texture)
 	{
 		if (texture.gpuId)
 		{
 			glDeleteTextures(1, &texture.gpuId);
 			texture.gpuId = 0;
 		}
-		stbi_image_free(texture.data);
 		texture.type = ETextureType::None;
-	}
+	});
 	textures.clear();
 
-	nameToIdMaterials.clear();
 	materials.clear();
 
-	nameToIdMeshes.clear();
-	for (Mesh& mesh : meshes)
+	for (auto &[vertexArray, streamingBuffer] : streamingBuffers)
+	{
+		delete_streaming_buffer(streamingBuffer);
+	}
+	streamingBuffers.clear();
+
+	meshes.for_each([](Handle<Mesh>, Mesh& mesh)
 	{
 		if (mesh.gpuIds[0])
 		{
@@ -624,9 +863,8 @@ void SResourceManager::shutdown()
 			mesh.gpuIds[1] = 0;
 			mesh.gpuIds[2] = 0;
 		}
-	}
+	});
 	meshes.clear();
 
-	nameToIdModels.clear();
 	models.clear();
 }
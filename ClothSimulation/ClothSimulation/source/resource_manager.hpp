@@ -1,9 +1,8 @@
 #pragma once
 #include <tiny_gltf.h>
 
-template<typename Type>
-struct Handle;
-
+#include "Common/resource_registry.hpp"
+#include "Common/texture_loader.hpp"
 
 namespace std {
 	namespace filesystem {
@@ -17,51 +16,87 @@ struct Model;
 struct Mesh;
 enum class ETextureType : Int8;
 
+// Layout of dynamic vertex stream, uvs of dynamic meshes stay in static buffer and are never uploaded again
+enum class EVertexFormat : Int8
+{
+	Float,	// Positions and normals as vec3s, 24 bytes per vertex
+	Packed	// Positions as vec3s interleaved with normals in GL_INT_2_10_10_10_REV, 16 bytes per vertex
+};
+
 class SResourceManager
 {
 public:
 	const std::string TEXTURES_PATH = "Resources/Textures/";
 	const std::string ASSETS_PATH	= "Resources/Assets/";
+	// Regions of streaming buffer, GPU may still read two previous frames while third is written
+	static constexpr Int32 UPLOAD_REGIONS_COUNT = 3;
+	// Bytes of decoded textures uploaded per frame, at least one texture is uploaded every frame
+	static constexpr Int64 TEXTURE_UPLOAD_BUDGET = 16 * 1024 * 1024;
 
 	SResourceManager(SResourceManager&) = delete;
 
 	static SResourceManager& get();
 	void startup();
 
-	void load_gltf_asset(const std::string& filePath);
-
-	void generate_opengl_texture(Texture& texture);
+	// Returns handles of all models loaded from meshes of the asset
+	std::vector<Handle<Model>> load_gltf_asset(const std::string& filePath);
+
+	// Uploads all mip levels of bake through pixel buffer
+	void generate_opengl_texture(Texture& texture, const TextureBake& bake);
+	// Uploads textures decoded since last call until budget is used. Until then texture has no gpuId and materials
+	// are drawn with their colour only
+	void upload_loaded_textures(Int64 budget = TEXTURE_UPLOAD_BUDGET);
+	// Textures still decoding or waiting for upload
+	Int32 get_loading_textures_count() const;
+	// Applied to textures loaded after it, their bakes are made again if they were baked with other setting
+	void set_texture_compression(bool isEnabled);
+	bool is_texture_compressed() const;
 	void generate_opengl_model(Model& model);
 	void update_opengl_model(Model& model);
+	// Uploads positions and normals of mesh vertex count from any memory, e.g. mapped bake file. They are copied into
+	// persistently mapped ring of regions, so upload doesn't wait for GPU unless it is UPLOAD_REGIONS_COUNT frames behind
+	void update_opengl_mesh(const Mesh& mesh, const glm::vec3* positions, const glm::vec3* normals);
+	// Points position attribute of other vertex array at positions of mesh uploaded last, so it can draw them with its own
+	// indexes without copy. Has to be called again after every upload of mesh
+	void share_positions(const Mesh& mesh, UInt32 vertexArray);
+	// Times update_opengl_mesh had to wait for GPU to finish reading region
+	Int64 get_upload_waits() const;
+	// Applied by next update of every mesh
+	void set_vertex_format(EVertexFormat format);
+	EVertexFormat get_vertex_format() const;
 
 	Handle<Model>    load_model(const std::filesystem::path & filePath, tinygltf::Mesh& gltfMesh, tinygltf::Model& gltfModel);
 	Handle<Mesh>     load_mesh(const std::string& meshName, tinygltf::Primitive& primitive, tinygltf::Model& gltfModel);
 	Handle<Material> load_material(const std::filesystem::path& assetPath, tinygltf::Material& gltfMaterial, tinygltf::Model& gltfModel);
+	// Returns handle right away, image is loaded on background thread and uploaded by upload_loaded_textures. Textures
+	// other than normal maps are compressed while texture compression is enabled
 	Handle<Texture>  load_texture(const std::filesystem::path& filePath, const std::string& textureName, ETextureType type);
 
 	Handle<Material> create_material(Material& material, const std::string& name);
 	Handle<Model> create_model(const Model& model, const std::string& name);
 	Handle<Mesh> create_mesh(const std::string& name);
 
-	Model	 &get_model_by_name(const std::string& name);
+	// Lookups by name hash string literals at compile time. Handles are validated, so they can be cached and stale
+	// ones get default resource instead of reused slot. Returned references stay valid until resource is removed
+	Model	 &get_model_by_name(ResourceName name);
 	Model	 &get_model_by_handle(const Handle<Model> handle);
-	Mesh	 &get_mesh_by_name(const std::string& name);
+	Mesh	 &get_mesh_by_name(ResourceName name);
 	Mesh	 &get_mesh_by_handle(const Handle<Mesh> handle);
-	Material &get_material_by_name(const std::string& name);
+	Material &get_material_by_name(ResourceName name);
 	Material &get_material_by_handle(const Handle<Material> handle);
 	Material &get_default_material();
-	Texture	 &get_texture_by_name(const std::string& name);
+	Texture	 &get_texture_by_name(ResourceName name);
 	Texture	 &get_texture_by_handle(const Handle<Texture> handle);
 
-	const Handle<Model>    &get_model_handle_by_name(const std::string &name);
-	const Handle<Mesh>	   &get_mesh_handle_by_name(const std::string &name);
-	const Handle<Material> &get_material_handle_by_name(const std::string &name);
-	const Handle<Texture>  &get_texture_handle_by_name(const std::string &name);
+	Handle<Model>	 get_model_handle_by_name(ResourceName name) const;
+	Handle<Mesh>	 get_mesh_handle_by_name(ResourceName name) const;
+	Handle<Material> get_material_handle_by_name(ResourceName name) const;
+	Handle<Texture>	 get_texture_handle_by_name(ResourceName name) const;
 
-	const std::vector<Model>    &get_models()    const;
-	const std::vector<Mesh>     &get_meshes()    const;
-	const std::vector<Material> &get_materials() const;
-	const std::vector<Texture>  &get_textures()  const;
+	const ResourceRegistry<Model>	 &get_models()	  const;
+	const ResourceRegistry<Mesh>	 &get_meshes()	  const;
+	const ResourceRegistry<Material> &get_materials() const;
+	const ResourceRegistry<Texture>	 &get_textures()  const;
 
 	void shutdown();
 
@@ -90,19 +125,33 @@ protected:
 	}
 
 private:
-	void load_gltf_asset(const std::filesystem::path &filePath);
+	struct StreamingBuffer
+	{
+		UInt32 buffer	 = 0;
+		UInt8 *mapped	 = nullptr; // Null without GL 4.4, buffer is then orphaned by every upload
+		EVertexFormat format = EVertexFormat::Float;
+		Int64 regionSize = 0;
+		Int32 region	 = 0; // Last written
+		void *fences[UPLOAD_REGIONS_COUNT] = {}; // GLsync placed after draws reading region
+	};
+
+	std::vector<Handle<Model>> load_gltf_asset(const std::filesystem::path &filePath);
 	SResourceManager() = default;
 
-	std::unordered_map<std::string, Handle<Model>> nameToIdModels;
-	std::vector<Model> models;
+	StreamingBuffer& get_streaming_buffer(const Mesh& mesh);
+	void delete_streaming_buffer(StreamingBuffer& streamingBuffer);
 
-	std::unordered_map<std::string, Handle<Mesh>> nameToIdMeshes;
-	std::vector<Mesh> meshes;
+	ResourceRegistry<Model> models;
+	ResourceRegistry<Mesh> meshes;
+	ResourceRegistry<Material> materials;
+	ResourceRegistry<Texture> textures;
 
-	std::unordered_map<std::string, Handle<Material>> nameToIdMaterials;
-	std::vector<Material> materials;
+	TextureLoader textureLoader;
+	UInt32 textureUploadBuffer = 0; // Pixel unpack buffer, created by first upload
+	bool isTextureCompressed = true;
 
-	std::unordered_map<std::string, Handle<Texture>> nameToIdTextures;
-	std::vector<Texture> textures;
+	std::unordered_map<UInt32, StreamingBuffer> streamingBuffers; // By vertex array of mesh, created on first update
+	Int64 uploadWaits = 0;
+	EVertexFormat vertexFormat = EVertexFormat::Packed;
 };
 
@@ -2,6 +2,7 @@
 
 #include <imgui.h>
 #include <filesystem>
+#include <chrono>
 
 #include "resource_manager.hpp"
 #include "Common/mesh.hpp"
@@ -11,6 +12,9 @@
 #include "Common/model.hpp"
 #include "Common/texture.hpp"
 
+// Grid build is parallel and exact sized, so cloths of millions of mass points are built in milliseconds
+constexpr Int32 MAX_GRID_SIZE = 4096;
+
 SimulationManager& SimulationManager::get()
 {
 	static SimulationManager instance;
@@ -21,33 +25,51 @@ void SimulationManager::startup()
 {
 	SResourceManager &resourceManager = SResourceManager::get();
 
-	create_soft_mesh("Flag", gridSize, meshSize, clothMass, stiffness);
-
-	ClothData &clothData = cloths[cloths.size() - 1];
-
-
 	Material material;
 	material.albedo = resourceManager.load_texture(resourceManager.TEXTURES_PATH + "Silence/Albedo.png",
 												   "SilenceAlbedo", ETextureType::Albedo);
 	resourceManager.create_material(material, "Silence");
-	Texture &albedo = resourceManager.get_texture_by_handle(material.albedo);
-	resourceManager.generate_opengl_texture(albedo);
 
-	Model model;
-	model.meshes.emplace_back(clothData.simulatedMesh);
-	model.materials.emplace_back(resourceManager.get_material_handle_by_name("Silence"));
+	for (Int32 i = 0; i < clothsCount; ++i)
+	{
+		const std::string name = i == 0 ? "Flag" : "Flag" + std::to_string(i);
+		create_soft_mesh(name, gridSize, meshSize, clothMass, stiffness, get_cloth_origin(i));
+
+		ClothData &clothData = cloths[cloths.size() - 1];
+
+		Model model;
+		model.meshes.emplace_back(clothData.simulatedMesh);
+		model.materials.emplace_back(resourceManager.get_material_handle_by_name("Silence"));
+
+		clothData.simulatedModel = resourceManager.create_model(model, name);
+		resourceManager.generate_opengl_model(model);
+	}
 
-	resourceManager.create_model(model, "Flag");
-	resourceManager.generate_opengl_model(model);
+	const std::vector<Handle<Model>> colliderModels = resourceManager.load_gltf_asset(resourceManager.ASSETS_PATH + "Cube/Cube.gltf");
+	meshCollider = colliderModels.empty() ? Handle<Model>::sNone : colliderModels[0];
+	if (meshCollider != Handle<Model>::sNone)
+	{
+		resourceManager.generate_opengl_model(resourceManager.get_model_by_handle(meshCollider));
+	}
+	update_mesh_collider();
 
+	builtSettings = get_build_settings();
+	refresh_cloth_meshes();
+	initialSnapshot.capture(cloths, clothMeshes);
 	shouldReset = false;
 }
 
-void SimulationManager::update()
+void SimulationManager::update(Float32 frameTime)
 {
 	if (shouldReset)
 	{
-		shutdown();
+		reset();
+	}
+
+	if (bakePlayer.is_open())
+	{
+		play_frame(frameTime);
+		return;
 	}
 
 	if (!isSimulating)
@@ -56,48 +78,45 @@ void SimulationManager::update()
 	}
 
 	SResourceManager &resourceManager = SResourceManager::get();
-	ClothData &clothData = cloths[0];
-	Mesh &mesh = resourceManager.get_mesh_by_handle(clothData.simulatedMesh);
+	refresh_cloth_meshes();
 
-	compute_external_forces(clothData);
-	Float32 variation = 0.0f;
-	glm::vec3 current(0.0f), predicted(0.0f);
-
-	Int32 stableCounter = 0;
-	for (Int32 i = 0; i < mesh.positions.size(); ++i)
+	// All cloths go to solver at once, so it can batch small ones over threads
+	scheduler.begin_frame(frameTime, solver.settings.deltaTime);
+	while (scheduler.should_step())
 	{
-		if (!clothData.simulatedFlags[i])
+		solver.step(cloths, clothMeshes);
+		recordingTime += solver.settings.deltaTime;
+		if (bakeWriter.is_open() && isBakingSubsteps)
 		{
-			stableCounter++;
-			continue;
+			for (Int32 i = 0; i < cloths.size(); ++i)
+			{
+				solver.update_normals(cloths[i], *clothMeshes[i]);
+			}
+			bakeWriter.add_frame(recordingTime, clothMeshes);
 		}
-		predicted += mesh.positions[i];
 	}
-	predicted /= Float32(mesh.positions.size() - stableCounter);
+	scheduler.end_frame();
 
-	for (Int32 i = 0; i < minIterations || variation > variationThreshold; ++i) 
+	if (scheduler.get_statistics().substeps > 0)
 	{
-		current = predicted;
-		predicted = glm::vec3(0.0f);
-		compute_internal_forces(mesh, clothData);
-		stableCounter = 0;
-		for (Int32 j = 0; j < mesh.positions.size(); ++j)
+		for (Int32 i = 0; i < cloths.size(); ++i)
+		{
+			solver.update_normals(cloths[i], *clothMeshes[i]);
+			resourceManager.update_opengl_model(resourceManager.get_model_by_handle(cloths[i].simulatedModel));
+		}
+		if (bakeWriter.is_open() && !isBakingSubsteps)
+		{
+			bakeWriter.add_frame(recordingTime, clothMeshes);
+		}
+		if (gltfExporter.is_open())
 		{
-			if (!clothData.simulatedFlags[j])
+			gltfExporter.add_frame(recordingTime, clothMeshes);
+			if (gltfExporter.get_frames_count() >= gltfFramesCount)
 			{
-				stableCounter++;
-				continue;
+				gltfExporter.close();
 			}
-			clothData.accelerations[j] = (internalForces[j] + externalForces[j]) / clothData.masses[j];
-			clothData.velocities[j]   += clothData.accelerations[j] * deltaTime;
-			mesh.positions[j]		  += clothData.velocities[j] * deltaTime;
-			predicted += mesh.positions[j];
 		}
-		predicted /= Float32(mesh.positions.size() - stableCounter);
-		variation = glm::abs(glm::length(predicted) - glm::length(current));
 	}
-	update_normals(mesh);
-	resourceManager.update_opengl_model(resourceManager.get_model_by_name("Flag"));
 }
 
 const ClothData& SimulationManager::get_cloth_data(Int32 index) const
@@ -105,294 +124,498 @@ const ClothData& SimulationManager::get_cloth_data(Int32 index) const
 	if (index < 0 || index >= cloths.size())
 	{
 		SPDLOG_WARN("Invalid cloth data index.");
-		return ClothData();
+		static const ClothData sEmpty;
+		return sEmpty;
 	}
 	return cloths[index];
 }
 
+Int32 SimulationManager::get_cloths_count() const
+{
+	return Int32(cloths.size());
+}
+
 bool SimulationManager::is_debug_mode() const
 {
 	return isDebugMode;
 }
 
-void SimulationManager::create_soft_mesh(const std::string &name, const glm::ivec2 &gridSize,
-                                         const glm::vec2 &meshSize, Float32 clothMass, Float32 stiffness)
+Int64 SimulationManager::get_cloths_version() const
+{
+	return clothsVersion;
+}
+
+Handle<Model> SimulationManager::get_mesh_collider() const
+{
+	return isMeshCollider ? meshCollider : Handle<Model>::sNone;
+}
+
+glm::mat4 SimulationManager::get_mesh_collider_transform() const
+{
+	return glm::scale(glm::translate(glm::mat4(1.0f), meshColliderPosition), glm::vec3(meshColliderScale));
+}
+
+const std::vector<ColliderShape>& SimulationManager::get_collider_shapes() const
+{
+	return solver.colliders.shapes;
+}
+
+void SimulationManager::create_soft_mesh(const std::string &name, const glm::ivec2 &gridSize, const glm::vec2 &meshSize,
+										 Float32 clothMass, Float32 stiffness, const glm::vec3 &origin)
 {
 	SResourceManager &resourceManager = SResourceManager::get();
-	std::vector<Mesh> meshes = resourceManager.get_meshes();
 	cloths.emplace_back();
 	ClothData &clothData = cloths[cloths.size() - 1];
 	clothData.simulatedMesh = resourceManager.create_mesh(name);
 	Mesh &mesh = resourceManager.get_mesh_by_handle(clothData.simulatedMesh);
 
-	const glm::vec2 initialLengths = { meshSize.x / Float32(gridSize.x - 1), meshSize.y / Float32(gridSize.y - 1) };
-	const Int32 numberOfMasses = glm::max(gridSize.x * gridSize.y, 0);
-	const Int32 numberOfSprings = glm::max(6 * numberOfMasses - 5 * (gridSize.y + gridSize.x) + 2, 0);
-	const Int32 numberOfIndexes = glm::max((gridSize.x - 1) * (gridSize.y - 1) * 6, 0);
-	const Float32 massOfPoint = clothMass / Float32(numberOfMasses);
-
-	// Reserve mass points
-	clothData.gridSize = gridSize;
-	clothData.accelerations.resize(numberOfMasses, glm::vec3(0.0f));
-	clothData.velocities.resize(numberOfMasses, glm::vec3(0.0f));
-	clothData.masses.resize(numberOfMasses, massOfPoint);
-	clothData.simulatedFlags.resize(numberOfMasses, true);
-	// Reserve springs
-	clothData.restLengths.reserve(numberOfSprings);
-	clothData.stiffnesses.resize(numberOfSprings, stiffness);
-	clothData.springAttachments.reserve(numberOfSprings);
-	// Reserve mesh
-	mesh.positions.reserve(numberOfMasses);
-	mesh.normals.resize(numberOfMasses, glm::vec3(0.0f));
-	mesh.uvs.reserve(numberOfMasses);
-	mesh.indexes.reserve(numberOfIndexes);
-	// Reserve forces
-	internalForces.resize(numberOfMasses, glm::vec3(0.0f));
-	externalForces.resize(numberOfMasses, glm::vec3(0.0f));
-	// Init positions
-	calculate_positions(mesh, clothData, initialLengths);
-	calculate_indexes(mesh, clothData);
-	calculate_uvs(mesh, clothData);
-	update_normals(mesh);
-
-	clothData.simulatedFlags[0] = false;
-	clothData.simulatedFlags[gridSize.x * Int32(gridSize.y * 0.5f)] = false;
-	clothData.simulatedFlags[gridSize.x * (gridSize.y - 1)] = false;
-
-	calculate_springs(mesh, clothData);
+	solver.build_cloth(clothData, mesh, gridSize, meshSize, clothMass, stiffness, origin);
+	clothsVersion++;
 }
 
 void SimulationManager::show_gui()
 {
 	ImGui::Begin("Simulation settings");
 
-	ImGui::DragFloat3("Fluid Velocity", &fluidVelocity[0], 0.01f, -100.0f, 100.0f, "%.2f");
-	ImGui::DragFloat3("Gravity", &gravity[0], 0.01f, -30.0f, 30.0f, "%.2f");
-	ImGui::DragFloat("Stiffness", &stiffness, 0.1f, 1.0f, 1000.0f, "%.1f");
+	ClothSolver::Settings &settings = solver.settings;
+
+	ImGui::DragFloat3("Fluid Velocity", &settings.fluidVelocity[0], 0.01f, -100.0f, 100.0f, "%.2f");
+	ImGui::DragFloat3("Gravity", &settings.gravity[0], 0.01f, -30.0f, 30.0f, "%.2f");
+	ImGui::DragFloat("Stiffness", &stiffness, 1.0f, 1.0f, 100000.0f, "%.1f");
 	ImGui::DragFloat("Cloth mass", &clothMass, 0.1f, 1.0f, 1000.0f, "%.1f");
-	ImGui::DragFloat("Damping", &damping, 0.01f, 0.01f, 1.0f, "%.2f");
-	ImGui::DragFloat("Viscosity", &viscosity, 0.01f, 0.0f, 2.0f, "%.2f");
+	ImGui::DragFloat("Damping", &settings.damping, 0.01f, 0.01f, 1.0f, "%.2f");
+	ImGui::DragFloat("Viscosity", &settings.viscosity, 0.01f, 0.0f, 2.0f, "%.2f");
 	ImGui::DragFloat2("Mesh size", &meshSize[0], 0.1f, 0.1f, 200.0f, "%.1f");
-	ImGui::DragInt2("Grid Size", &gridSize[0], 1, 1, 30);
-	ImGui::DragFloat("Time step", &deltaTime, 0.0001f, 0.0f, 0.05f, "%.4f");
+	ImGui::DragInt2("Grid Size", &gridSize[0], 1, 2, MAX_GRID_SIZE);
+	ImGui::Checkbox("Presorted springs", &settings.presortedSprings);
+	Int32 pointOrder = Int32(settings.pointOrder);
+	if (ImGui::Combo("Point order", &pointOrder, "Grid\0Morton\0Hilbert\0"))
+	{
+		settings.pointOrder = EPointOrder(pointOrder);
+	}
+	ImGui::SliderInt("Cloths", &clothsCount, 1, 64);
+	ImGui::DragFloat("Time step", &settings.deltaTime, 0.0001f, 0.0f, 0.05f, "%.4f");
+	ImGui::Checkbox("Adaptive time step", &settings.adaptiveTimeStep);
+	if (settings.adaptiveTimeStep)
+	{
+		ImGui::DragFloat("Stability factor", &settings.stabilityFactor, 0.01f, 0.05f, 1.0f, "%.2f");
+		ImGui::DragFloat("Courant number", &settings.courantNumber, 0.01f, 0.05f, 1.0f, "%.2f");
+		ImGui::SliderInt("Max adaptive substeps", &settings.maxAdaptiveSubsteps, 1, 256);
+		ImGui::Text("Adaptive substeps: %d, dt: %.5f", solver.get_statistics().adaptiveSubsteps,
+					solver.get_statistics().adaptiveDeltaTime);
+	}
+	ImGui::Text("Unstable points: %d, total: %lld", solver.get_statistics().instabilities,
+				solver.get_statistics().totalInstabilities);
+	ImGui::SliderInt("Threads", &settings.threadsCount, 1, WorkerPool::s_get_hardware_threads_count());
+	Int32 simdLevel = Int32(settings.simdLevel);
+	if (ImGui::Combo("SIMD", &simdLevel, "Scalar\0SSE\0AVX2\0"))
+	{
+		settings.simdLevel = ESimdLevel(glm::min(simdLevel, Int32(ClothKernels::s_get_supported_level())));
+	}
+	Int32 integrator = Int32(settings.integrator);
+	if (ImGui::Combo("Integrator", &integrator, "Explicit\0Implicit\0XPBD\0"))
+	{
+		settings.integrator = EIntegrator(integrator);
+	}
+	if (settings.integrator == EIntegrator::Implicit)
+	{
+		ImGui::SliderInt("CG iterations", &settings.linearIterations, 1, 200);
+		ImGui::DragFloat("CG tolerance", &settings.linearTolerance, 0.0001f, 0.0001f, 0.1f, "%.4f");
+		ImGui::Text("Last CG iterations: %d", solver.get_statistics().solverIterations);
+	}
+	else if (settings.integrator == EIntegrator::Xpbd)
+	{
+		ImGui::SliderInt("XPBD iterations", &settings.constraintIterations, 1, 100);
+		Int32 xpbdMode = Int32(settings.xpbdMode);
+		if (ImGui::Combo("XPBD mode", &xpbdMode, "Gauss-Seidel\0Jacobi\0"))
+		{
+			settings.xpbdMode = EXpbdMode(xpbdMode);
+		}
+	}
+
+	ImGui::Checkbox("Self-collision", &settings.selfCollision);
+	if (settings.selfCollision)
+	{
+		ImGui::DragFloat("Collision thickness", &settings.collisionThickness, 0.01f, 0.01f, 0.5f, "%.2f");
+		ImGui::Text("Collision candidates: %d, contacts: %d", solver.get_statistics().collisionCandidates,
+					solver.get_statistics().collisionContacts);
+	}
+
+	collider_gui();
+	snapshot_gui();
+	bake_gui();
+	gltf_gui();
+
+	SubstepScheduler::Settings &schedulerSettings = scheduler.settings;
+	const SubstepScheduler::Statistics &schedulerStatistics = scheduler.get_statistics();
+	ImGui::SliderInt("Max substeps", &schedulerSettings.maxSubsteps, 1, 256);
+	ImGui::DragFloat("Substeps budget ms", &schedulerSettings.timeBudgetMs, 0.1f, 0.0f, 100.0f, "%.1f");
+	ImGui::DragFloat("Time scale", &schedulerSettings.timeScale, 0.01f, 0.0f, 4.0f, "%.2f");
+	ImGui::Text("Substeps: %d (%.2fms), extra: %d, dropped: %d", schedulerStatistics.substeps,
+				schedulerStatistics.substepsTimeMs, schedulerStatistics.extraSubsteps, schedulerStatistics.droppedSubsteps);
+	ImGui::Text("Total extra: %lld, total dropped: %lld", schedulerStatistics.totalExtraSubsteps,
+				schedulerStatistics.totalDroppedSubsteps);
+
+	const ClothSolver::Statistics &solverStatistics = solver.get_statistics();
+	ImGui::Text("Cloths on all threads: %d, on single thread: %d", solverStatistics.sharedCloths,
+				solverStatistics.spreadCloths);
 
 	shouldReset = ImGui::Button("Reset");
 	ImGui::Checkbox("Simulate", &isSimulating);
 	ImGui::Checkbox("Debug mode", &isDebugMode);
 	ImGui::Text("FPS: %.2f, %.2fms", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+	SResourceManager &resourceManager = SResourceManager::get();
+	Int32 vertexFormat = Int32(resourceManager.get_vertex_format());
+	if (ImGui::Combo("Vertex format", &vertexFormat, "Float\0Packed\0"))
+	{
+		resourceManager.set_vertex_format(EVertexFormat(vertexFormat));
+	}
+	ImGui::Text("Vertex upload waits: %lld", resourceManager.get_upload_waits());
+	ImGui::Text("Textures loading: %d", resourceManager.get_loading_textures_count());
+	bool isTextureCompressed = resourceManager.is_texture_compressed();
+	if (ImGui::Checkbox("Compress textures", &isTextureCompressed))
+	{
+		resourceManager.set_texture_compression(isTextureCompressed);
+	}
 	ImGui::End();
 }
 
-void SimulationManager::shutdown()
+void SimulationManager::update_mesh_collider()
 {
-	cloths.clear();
-	internalForces.clear();
-	externalForces.clear();
-	if (shouldReset)
+	solver.colliders.clear_meshes();
+	if (!isMeshCollider || meshCollider == Handle<Model>::sNone)
 	{
-		SResourceManager &resourceManager = SResourceManager::get();
-		resourceManager.shutdown();
-		resourceManager.startup();
-		startup();
+		return;
 	}
-}
 
+	SResourceManager &resourceManager = SResourceManager::get();
+	for (const Handle<Mesh> &handle : resourceManager.get_model_by_handle(meshCollider).meshes)
+	{
+		const Mesh &mesh = resourceManager.get_mesh_by_handle(handle);
+		solver.colliders.add_mesh(mesh.positions, mesh.indexes, get_mesh_collider_transform());
+	}
+}
 
-void SimulationManager::compute_internal_forces(const Mesh& mesh, const ClothData& clothData)
+void SimulationManager::collider_gui()
 {
-	for (glm::vec3 &force : internalForces)
+	ClothSolver::Settings &settings = solver.settings;
+	if (!ImGui::CollapsingHeader("Colliders"))
 	{
-		force = { 0.0f, 0.0f, 0.0f };
+		return;
 	}
 
-	for (Int32 i = 0; i < clothData.restLengths.size(); ++i)
+	// Hierarchy is rebuilt only when mesh collider was edited
+	bool isMeshChanged = ImGui::Checkbox("Cube collider", &isMeshCollider);
+	if (isMeshCollider)
 	{
-		const Int32 indexA = clothData.springAttachments[i].x;
-		const Int32 indexB = clothData.springAttachments[i].y;
+		isMeshChanged |= ImGui::DragFloat3("Cube position", &meshColliderPosition[0], 0.1f, -100.0f, 100.0f, "%.1f");
+		isMeshChanged |= ImGui::DragFloat("Cube scale", &meshColliderScale, 0.01f, 0.1f, 50.0f, "%.2f");
+	}
+	if (isMeshChanged)
+	{
+		update_mesh_collider();
+	}
 
-		const glm::vec3 &pointA = mesh.positions[indexA];
-		const glm::vec3 &pointB = mesh.positions[indexB];
-		const glm::vec3 l = pointB - pointA;
-		if (glm::length2(l) <= glm::epsilon<Float32>())
+	std::vector<ColliderShape> &shapes = solver.colliders.shapes;
+	for (Int32 i = 0; i < shapes.size(); ++i)
+	{
+		ImGui::PushID(i);
+		ColliderShape &shape = shapes[i];
+		Int32 type = Int32(shape.shape);
+		if (ImGui::Combo("Shape", &type, "Sphere\0Plane\0Capsule\0"))
 		{
-			continue;
+			shape.shape = EColliderShape(type);
 		}
-
-		const glm::vec3 force = clothData.stiffnesses[i] * (l - clothData.restLengths[i]  * glm::normalize(l));
-		internalForces[indexA] += force;
-		internalForces[indexB] -= force;
+		ImGui::DragFloat3("Position", &shape.position[0], 0.1f, -100.0f, 100.0f, "%.1f");
+		if (shape.shape != EColliderShape::Sphere)
+		{
+			ImGui::DragFloat3(shape.shape == EColliderShape::Plane ? "Normal" : "Axis", &shape.direction[0], 0.01f, -100.0f, 100.0f, "%.2f");
+			if (shape.shape == EColliderShape::Plane && glm::dot(shape.direction, shape.direction) == 0.0f)
+			{
+				shape.direction = { 0.0f, 1.0f, 0.0f };
+			}
+		}
+		if (shape.shape != EColliderShape::Plane)
+		{
+			ImGui::DragFloat("Radius", &shape.radius, 0.01f, 0.01f, 50.0f, "%.2f");
+		}
+		const bool isRemoved = ImGui::Button("Remove");
+		ImGui::PopID();
+		if (isRemoved)
+		{
+			shapes.erase(shapes.begin() + i);
+			--i;
+		}
+	}
+	if (ImGui::Button("Add collider"))
+	{
+		ColliderShape shape;
+		shape.position = { 0.5f * meshSize.x, -0.5f * meshSize.y, 0.25f * meshSize.x };
+		shape.radius   = 0.2f * meshSize.x;
+		shapes.emplace_back(shape);
 	}
+
+	ImGui::DragFloat("Collider thickness", &settings.colliderThickness, 0.01f, 0.0f, 5.0f, "%.2f");
+	ImGui::DragFloat("Collider friction", &settings.colliderFriction, 0.01f, 0.0f, 2.0f, "%.2f");
+	ImGui::Text("Collider triangles: %d, contacts: %d", solver.colliders.get_triangles_count(),
+				solver.get_statistics().colliderContacts);
 }
 
-void SimulationManager::compute_external_forces(const ClothData &clothData)
+void SimulationManager::shutdown()
 {
+	cloths.clear();
+	clothMeshes.clear();
+	solver.shutdown();
+	scheduler.reset();
+	initialSnapshot.clear();
+	checkpoint.clear();
+	bakeWriter.close();
+	bakePlayer.close();
+	gltfExporter.close();
+}
+
+void SimulationManager::reset()
+{
+	const auto resetBegin = std::chrono::high_resolution_clock::now();
+	shouldReset = false;
 
-	glm::vec3 normal(0.0f);
-	if (glm::length2(fluidVelocity) > 0.0f)
+	const BuildSettings settings = get_build_settings();
+	refresh_cloth_meshes();
+	if (settings == builtSettings && initialSnapshot.restore(cloths, clothMeshes))
+	{
+		on_state_replaced();
+	}
+	else if (settings.gridSize == builtSettings.gridSize && settings.clothsCount == builtSettings.clothsCount)
 	{
-		normal = -glm::normalize(fluidVelocity);
+		rebuild_cloths();
+	} else {
+		// Meshes of other size need new resources
+		shutdown();
+		SResourceManager &resourceManager = SResourceManager::get();
+		resourceManager.shutdown();
+		resourceManager.startup();
+		startup();
 	}
 
-	for (Int32 i = 0; i < clothData.masses.size(); ++i)
+	const auto resetEnd = std::chrono::high_resolution_clock::now();
+	lastResetMs = Float32(std::chrono::duration_cast<std::chrono::microseconds>(resetEnd - resetBegin).count()) * 1.0e-3f;
+}
+
+void SimulationManager::rebuild_cloths()
+{
+	// Vertex count is same, so meshes, their OpenGL buffers and memory of cloths are reused
+	for (Int32 i = 0; i < cloths.size(); ++i)
 	{
-		const glm::vec3 gravityForce = clothData.masses[i] * gravity;
-		const glm::vec3 dampingForce = -damping * clothData.velocities[i];
-		glm::vec3 fluidForce = viscosity
-							 * glm::dot(normal, fluidVelocity - clothData.velocities[i])
-							 * normal;
+		solver.build_cloth(cloths[i], *clothMeshes[i], gridSize, meshSize, clothMass, stiffness, get_cloth_origin(i));
+	}
 
-		externalForces[i] = gravityForce + dampingForce + fluidForce;
+	clothsVersion++;
+	builtSettings = get_build_settings();
+	initialSnapshot.capture(cloths, clothMeshes);
+	checkpoint.clear();
+	on_state_replaced();
+}
+
+void SimulationManager::refresh_cloth_meshes()
+{
+	SResourceManager &resourceManager = SResourceManager::get();
+	clothMeshes.clear();
+	for (const ClothData &clothData : cloths)
+	{
+		clothMeshes.emplace_back(&resourceManager.get_mesh_by_handle(clothData.simulatedMesh));
 	}
 }
 
-void SimulationManager::calculate_positions(Mesh& mesh, const ClothData &clothData, const glm::vec2& initialLengths)
+void SimulationManager::on_state_replaced()
 {
-	const glm::ivec2 &gridSize = clothData.gridSize;
-	for (Int32 y = 0; y < gridSize.y; ++y)
+	SResourceManager &resourceManager = SResourceManager::get();
+	solver.reset_state();
+	scheduler.reset();
+	for (const ClothData &clothData : cloths)
 	{
-		for (Int32 x = 0; x < gridSize.x; ++x)
-		{
-			mesh.positions.emplace_back(initialLengths.x * Float32(x),
-										initialLengths.y * Float32(-y),
-										0.0f);
-		}
+		resourceManager.update_opengl_model(resourceManager.get_model_by_handle(clothData.simulatedModel));
 	}
 }
 
-//		B
-//      *
-//     /|
-//    / |
-//   /  |A
-// C*---*---*C
-//      |  /
-//      | /
-//      |/
-//      *
-//		B
-void SimulationManager::calculate_indexes(Mesh& mesh, const ClothData& clothData)
+SimulationManager::BuildSettings SimulationManager::get_build_settings() const
+{
+	return { gridSize, meshSize, clothMass, stiffness, clothsCount, solver.settings.presortedSprings, solver.settings.pointOrder };
+}
+
+glm::vec3 SimulationManager::get_cloth_origin(Int32 index) const
+{
+	return { 1.5f * meshSize.x * Float32(index), 0.0f, 0.0f };
+}
+
+void SimulationManager::snapshot_gui()
 {
-	const glm::ivec2& gridSize = clothData.gridSize;
-	for (Int32 y = 0; y < gridSize.y; ++y)
+	if (!ImGui::CollapsingHeader("Snapshots"))
+	{
+		return;
+	}
+
+	if (ImGui::Button("Save checkpoint"))
 	{
-		for (Int32 x = 0; x < gridSize.x; ++x)
+		refresh_cloth_meshes();
+		checkpoint.capture(cloths, clothMeshes);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Rewind to checkpoint") && !checkpoint.is_empty())
+	{
+		refresh_cloth_meshes();
+		if (checkpoint.restore(cloths, clothMeshes))
 		{
-			const Int32 indexA = y * gridSize.x + x;
-			if (x - 1 >= 0 && y - 1 >= 0) // Upper triangle
-			{
-				const Int32 indexB = (y - 1) * gridSize.x + x;
-				const Int32 indexC = y * gridSize.x + x - 1;
-				mesh.indexes.emplace_back(indexA);
-				mesh.indexes.emplace_back(indexB);
-				mesh.indexes.emplace_back(indexC);
-			}
+			on_state_replaced();
+		}
+	}
 
-			if (x + 1 < gridSize.x && y + 1 < gridSize.y) // Lower triangle
-			{
-				const Int32 indexB = (y + 1) * gridSize.x + x;
-				const Int32 indexC = y * gridSize.x + x + 1;
-				mesh.indexes.emplace_back(indexA);
-				mesh.indexes.emplace_back(indexB);
-				mesh.indexes.emplace_back(indexC);
-			}
+	ImGui::InputText("Snapshot file", snapshotPath, sizeof(snapshotPath));
+	// File holds current state, it becomes checkpoint too
+	if (ImGui::Button("Save to file"))
+	{
+		refresh_cloth_meshes();
+		checkpoint.capture(cloths, clothMeshes);
+		checkpoint.save(snapshotPath);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Load from file") && checkpoint.load(snapshotPath))
+	{
+		refresh_cloth_meshes();
+		if (checkpoint.restore(cloths, clothMeshes))
+		{
+			on_state_replaced();
 		}
 	}
+	ImGui::Text("Checkpoint: %.2f MB, last reset: %.2fms", Float64(checkpoint.get_size()) / (1024.0 * 1024.0), lastResetMs);
 }
 
-void SimulationManager::update_normals(Mesh &mesh)
+bool SimulationManager::start_playback()
 {
-	for (Int32 i = 0; i < mesh.indexes.size(); i += 3)
+	if (!bakePlayer.open(bakePath))
 	{
-		const UInt32 indexA = mesh.indexes[i];
-		const UInt32 indexB = mesh.indexes[i + 1];
-		const UInt32 indexC = mesh.indexes[i + 2];
-		const glm::vec3 ba = mesh.positions[indexB] - mesh.positions[indexA];
-		const glm::vec3 ca = mesh.positions[indexC] - mesh.positions[indexA];
-		const glm::vec3 normal = glm::normalize(glm::cross(ba, ca));
-
-		mesh.normals[indexA] += normal;
-		mesh.normals[indexB] += normal;
-		mesh.normals[indexC] += normal;
+		return false;
 	}
 
-	for (glm::vec3& normal : mesh.normals)
+	// Recorded frames are uploaded into meshes of cloths, so they must have same vertex counts
+	refresh_cloth_meshes();
+	bool isMatching = bakePlayer.get_cloths_count() == clothMeshes.size();
+	for (Int32 i = 0; isMatching && i < clothMeshes.size(); ++i)
+	{
+		isMatching = bakePlayer.get_vertices_count(i) == Int64(clothMeshes[i]->positions.size());
+	}
+	if (!isMatching)
 	{
-		normal = glm::normalize(normal);
+		SPDLOG_ERROR("Bake {} was recorded with other cloths count or grid size.", bakePath);
+		bakePlayer.close();
+		return false;
 	}
+
+	playbackTime  = 0.0f;
+	playbackFrame = -1;
+	return true;
 }
 
-void SimulationManager::calculate_uvs(Mesh& mesh, const ClothData &clothData)
+void SimulationManager::play_frame(Float32 frameTime)
 {
-	const glm::ivec2 &gridSize = clothData.gridSize;
-	const glm::vec2 uvOffset = 1.0f / glm::vec2(gridSize - 1);
-	for (Int32 y = 0; y < gridSize.y; ++y)
+	const Int64 lastFrame = bakePlayer.get_frames_count() - 1;
+	playbackTime += glm::min(frameTime, scheduler.settings.maxFrameTime) * scheduler.settings.timeScale;
+	if (playbackTime > bakePlayer.get_frame_time(lastFrame))
+	{
+		playbackTime = 0.0f; // Loops
+	}
+
+	const Int64 frame = bakePlayer.find_frame(playbackTime);
+	if (frame == playbackFrame)
+	{
+		return;
+	}
+	playbackFrame = frame;
+
+	SResourceManager &resourceManager = SResourceManager::get();
+	refresh_cloth_meshes();
+	if (bakePlayer.is_quantized())
 	{
-		for (Int32 x = 0; x < gridSize.x; ++x)
+		bakePlayer.decode_frame(frame, clothMeshes);
+		for (const ClothData &clothData : cloths)
 		{
-			mesh.uvs.emplace_back(uvOffset.x * x, uvOffset.y * y);
+			resourceManager.update_opengl_model(resourceManager.get_model_by_handle(clothData.simulatedModel));
+		}
+	} else {
+		// Raw frames go to OpenGL straight from mapped file
+		for (Int32 i = 0; i < clothMeshes.size(); ++i)
+		{
+			resourceManager.update_opengl_mesh(*clothMeshes[i], bakePlayer.get_positions(frame, i), bakePlayer.get_normals(frame, i));
 		}
 	}
-
 }
 
-void SimulationManager::calculate_springs(const Mesh &mesh, ClothData &clothData)
+void SimulationManager::bake_gui()
 {
-	const glm::ivec2 &gridSize = clothData.gridSize;
-	for (Int32 y = 0; y < gridSize.y; ++y)
+	if (!ImGui::CollapsingHeader("Bake"))
 	{
-		for (Int32 x = 0; x < gridSize.x; ++x)
+		return;
+	}
+
+	ImGui::InputText("Bake file", bakePath, sizeof(bakePath));
+	if (!bakeWriter.is_open() && !bakePlayer.is_open())
+	{
+		ImGui::Checkbox("Quantized", &isBakeQuantized);
+		ImGui::SameLine();
+		ImGui::Checkbox("Every substep", &isBakingSubsteps);
+		if (ImGui::Button("Start bake"))
 		{
-			const Int32 indexA = x + y * gridSize.x;
-			Int32 indexB;
-			Float32 length;
-			
-			//flexion springs
-			if (x + 2 < gridSize.x)
-			{
-				indexB = indexA + 2;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
-			if (y + 2 < gridSize.y)
-			{
-				indexB = indexA + 2 * gridSize.x;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
+			refresh_cloth_meshes();
+			bakeWriter.open(bakePath, clothMeshes, isBakeQuantized);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Play bake"))
+		{
+			start_playback();
+		}
+	}
+	else if (bakeWriter.is_open())
+	{
+		const BakeWriter::Statistics &statistics = bakeWriter.get_statistics();
+		ImGui::Text("Baked frames: %lld, %.2f MB, writer stalls: %lld", statistics.frames,
+					Float64(statistics.bytes) / (1024.0 * 1024.0), statistics.stalls);
+		if (ImGui::Button("Stop bake"))
+		{
+			bakeWriter.close();
+		}
+	} else {
+		ImGui::Text("Playback frame: %lld / %lld", playbackFrame, bakePlayer.get_frames_count());
+		if (ImGui::Button("Stop playback"))
+		{
+			bakePlayer.close();
+			// Meshes show last played frame, simulation state is put back on them
+			shouldReset = true;
+		}
+	}
+}
 
-			//shear springs
-			if (x - 1 >= 0 && y + 1 < gridSize.y)
-			{
-				indexB = indexA + gridSize.x - 1;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
-			if (x + 1 < gridSize.x && y + 1 < gridSize.y)
-			{
-				indexB = indexA + gridSize.x + 1;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
+void SimulationManager::gltf_gui()
+{
+	if (!ImGui::CollapsingHeader("glTF export"))
+	{
+		return;
+	}
 
-			//structural springs
-			if (x + 1 < gridSize.x)
-			{
-				indexB = indexA + 1;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
-			if (y + 1 < gridSize.y)
-			{
-				indexB = indexA + gridSize.x;
-				length = glm::length(mesh.positions[indexA] - mesh.positions[indexB]);
-				clothData.restLengths.emplace_back(length);
-				clothData.springAttachments.emplace_back(indexA, indexB);
-			}
+	ImGui::InputText("glTF file", gltfPath, sizeof(gltfPath));
+	if (!gltfExporter.is_open())
+	{
+		ImGui::InputInt("Frames", &gltfFramesCount);
+		gltfFramesCount = glm::max(gltfFramesCount, 1);
+		if (ImGui::Button("Start export"))
+		{
+			refresh_cloth_meshes();
+			gltfExporter.open(gltfPath, clothMeshes);
+		}
+	} else {
+		ImGui::Text("Exported frames: %lld / %d, %.2f MB", gltfExporter.get_frames_count(), gltfFramesCount,
+					Float64(gltfExporter.get_bytes()) / (1024.0 * 1024.0));
+		if (ImGui::Button("Stop export"))
+		{
+			gltfExporter.close();
 		}
 	}
 }
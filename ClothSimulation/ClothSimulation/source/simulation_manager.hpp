@@ -1,8 +1,15 @@
 #pragma once
-template<typename Type>
-struct Handle;
+#include "Simulation/cloth_solver.hpp"
+#include "Simulation/substep_scheduler.hpp"
+#include "Simulation/cloth_snapshot.hpp"
+#include "Simulation/bake_writer.hpp"
+#include "Simulation/bake_player.hpp"
+#include "Simulation/gltf_exporter.hpp"
+#include "Common/handle.hpp"
+
 struct ClothData;
 struct Mesh;
+struct Model;
 
 class SimulationManager
 {
@@ -11,51 +18,101 @@ public:
 	static SimulationManager& get();
 
 	void startup();
-	void update();
+	// Frame time in seconds, simulation catches up with it in fixed substeps
+	void update(Float32 frameTime);
 
 	const ClothData& get_cloth_data(Int32 index) const;
+	Int32 get_cloths_count() const;
 	bool is_debug_mode() const;
-	void create_soft_mesh(const std::string& name, const glm::ivec2& gridSize,
-						  const glm::vec2& meshSize, Float32 clothMass, Float32 stiffness);
+	// Changes whenever cloths are built again, so data derived from their springs has to be rebuilt too
+	Int64 get_cloths_version() const;
+	// Invalid handle when mesh collider is disabled
+	Handle<Model> get_mesh_collider() const;
+	glm::mat4 get_mesh_collider_transform() const;
+	const std::vector<ColliderShape>& get_collider_shapes() const;
+	void create_soft_mesh(const std::string& name, const glm::ivec2& gridSize, const glm::vec2& meshSize,
+						  Float32 clothMass, Float32 stiffness, const glm::vec3& origin);
 	void show_gui();
 
 	void shutdown();
 
 
 private:
+	// Settings cloths were built with, reset can restore snapshot only while they don't change
+	struct BuildSettings
+	{
+		glm::ivec2 gridSize;
+		glm::vec2 meshSize;
+		Float32 clothMass;
+		Float32 stiffness;
+		Int32 clothsCount;
+		bool presortedSprings;
+		EPointOrder pointOrder;
+
+		bool operator==(const BuildSettings& other) const = default;
+	};
+
+	// Restores initial snapshot, rebuilds cloths in place or reloads everything, whichever is cheapest for changed settings
+	void reset();
+	void rebuild_cloths();
+	void refresh_cloth_meshes();
+	// After cloth state was replaced, uploads meshes and drops state carried between steps
+	void on_state_replaced();
+	BuildSettings get_build_settings() const;
+	glm::vec3 get_cloth_origin(Int32 index) const;
+	void snapshot_gui();
+	// Starts playback if bake file matches cloths layout
+	bool start_playback();
+	// Advances playback by frame time and uploads recorded frame, solver doesn't run
+	void play_frame(Float32 frameTime);
+	void bake_gui();
+	void gltf_gui();
+	// Hierarchy is rebuilt from current transform, shapes are read by solver directly
+	void update_mesh_collider();
+	void collider_gui();
+
 	SimulationManager() = default;
 	~SimulationManager() = default;
 	
 	std::vector<ClothData> cloths;
+	std::vector<Mesh*> clothMeshes; // Refreshed every update, resource manager may move meshes between frames
+	ClothSolver solver;
+	SubstepScheduler scheduler;
 
 	glm::ivec2 gridSize = { 10, 10 };
 	glm::ivec2 newGridSize = gridSize;
 
-	std::vector<glm::vec3>	internalForces;
-	std::vector<glm::vec3>	externalForces;
-	std::vector<glm::vec3>	predictedPositions;
-
-	int minIterations = 1;
-	float variationThreshold = 0.1f;
-	glm::vec3 gravity = { 0.0f, -9.81f, 0.0f };
-	glm::vec3 fluidVelocity = { 0.0f, 0.0f, 30.0f };
 	Float32 stiffness = 100.0f;
 	Float32 clothMass = 100.0f;
-	Float32 viscosity = 1.0f;
-	Float32 damping = 0.1f;
 	glm::vec2 meshSize = { 20.0f, 20.0f };
-	Float32 deltaTime = 0.016f;
+	Int32 clothsCount = 1; // Placed in a row along x, applied on reset
 	bool isSimulating = false;
 	bool shouldReset = false;
 	bool isDebugMode = false;
+	Int64 clothsVersion = 0;
 
-	
-	void compute_internal_forces(const Mesh &mesh, const ClothData &clothData);
-	void compute_external_forces(const ClothData &clothData);
-	void calculate_positions(Mesh& mesh, const ClothData &clothData, const glm::vec2& initialLengths);
-	void calculate_indexes(Mesh& mesh, const ClothData& clothData);
-	void calculate_uvs(Mesh &mesh, const ClothData &clothData);
-	void update_normals(Mesh& mesh);
-	void calculate_springs(const Mesh& mesh, ClothData &clothData);
+	BuildSettings builtSettings;
+	ClothSnapshot initialSnapshot; // Captured right after cloths are built
+	ClothSnapshot checkpoint;
+	char snapshotPath[256] = "Snapshot.bin";
+	Float32 lastResetMs = 0.0f;
+
+	BakeWriter bakeWriter;
+	BakePlayer bakePlayer; // Open while playback runs
+	char bakePath[256] = "Bake.clbk";
+	bool isBakeQuantized  = false;
+	bool isBakingSubsteps = false; // Every substep is frame of bake, otherwise only rendered frames
+	Float32 playbackTime = 0.0f;
+	Int64 playbackFrame	 = -1;
+
+	GltfExporter gltfExporter; // Adds every rendered frame while open
+	char gltfPath[256]	  = "Cloth.gltf";
+	Int32 gltfFramesCount = 240; // Export stops by itself after it
+	Float32 recordingTime = 0.0f; // Simulated time, bake and export frames are timed relative to their first frame
+
+	Handle<Model> meshCollider = Handle<Model>::sNone;
+	bool isMeshCollider = false;
+	glm::vec3 meshColliderPosition = { 10.0f, -12.0f, 4.0f };
+	Float32 meshColliderScale = 3.0f;
 };
 